@@ -1,6 +1,6 @@
 #version 330 core
 
-const int MAX_LIGHTS = 8;
+#include "lights.glsl"
 
 in vec3 vertCol;
 in vec2 vertTex;
@@ -9,13 +9,10 @@ in vec3 fragPos;
 
 out vec4 FragColor;
 
-uniform vec3  lightPos[MAX_LIGHTS];
-uniform vec3  lightCol[MAX_LIGHTS];
-uniform float lightInt[MAX_LIGHTS];
-
-uniform int lightCount;
 uniform vec3 camPos;
+#ifndef NO_TEXTURE
 uniform sampler2D tex0;
+#endif
 
 void main()
 {
@@ -47,5 +44,9 @@ void main()
   }
 
   vec3 finalColor = ambient + lightFactor;
+#ifdef NO_TEXTURE
+  FragColor = vec4(finalColor * vertCol, 1.f);
+#else
   FragColor = vec4(finalColor, 1.f) * texture(tex0, vertTex);
+#endif
 }
@@ -1,11 +1,6 @@
 #version 330 core
 
-const int MAX_LIGHTS = 8;
-
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aCol;
-layout (location = 2) in vec2 aTex;
-layout (location = 3) in vec3 aNorm;
+#include "vertex.glsl"
 
 out vec3 vertCol;
 out vec2 vertTex;
@@ -14,13 +9,20 @@ out vec3 fragPos;
 
 uniform mat4 cameraMatrix;
 uniform mat4 model;
-uniform vec3 lightCol[MAX_LIGHTS];
+#ifdef QUANTIZED_POSITIONS
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#else
+const vec3 positionOffset = vec3(0.f);
+const vec3 positionScale = vec3(1.f);
+#endif
 
 void main()
 {
-  vertCol = aCol;
+  vec3 position = decodePosition(positionOffset, positionScale);
+  vertCol = decodeColor();
   vertTex = aTex;
-  vertNorm = mat3(transpose(inverse(model))) * aNorm;
-  fragPos = vec3(model * vec4(aPos, 1.f));
-  gl_Position = cameraMatrix * model * vec4(aPos, 1.f);
+  vertNorm = mat3(transpose(inverse(model))) * decodeNormal();
+  fragPos = vec3(model * vec4(position, 1.f));
+  gl_Position = cameraMatrix * model * vec4(position, 1.f);
 }
@@ -0,0 +1,35 @@
+#version 430 core
+
+#include "vertex.glsl"
+
+layout (location = 4) in uint aDrawID;
+
+out vec3 vertCol;
+out vec2 vertTex;
+out vec3 vertNorm;
+out vec3 fragPos;
+
+struct DrawData
+{
+  mat4 model;
+  vec4 positionOffset;
+  vec4 positionScale;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer
+{
+  DrawData draws[];
+};
+
+uniform mat4 cameraMatrix;
+
+void main()
+{
+  DrawData draw = draws[aDrawID];
+  vec3 position = decodePosition(draw.positionOffset.xyz, draw.positionScale.xyz);
+  vertCol = decodeColor();
+  vertTex = aTex;
+  vertNorm = mat3(transpose(inverse(draw.model))) * decodeNormal();
+  fragPos = vec3(draw.model * vec4(position, 1.f));
+  gl_Position = cameraMatrix * draw.model * vec4(position, 1.f);
+}
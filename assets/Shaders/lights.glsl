@@ -0,0 +1,9 @@
+#ifndef MAX_LIGHTS
+#define MAX_LIGHTS 8
+#endif
+
+uniform vec3  lightPos[MAX_LIGHTS];
+uniform vec3  lightCol[MAX_LIGHTS];
+uniform float lightInt[MAX_LIGHTS];
+
+uniform int lightCount;
@@ -0,0 +1,43 @@
+// Solid vertex inputs, decoded according to the defines of kdr::Vertex::getDefines().
+
+layout (location = 0) in vec3 aPos;
+#ifndef NO_VERTEX_COLOR
+layout (location = 1) in vec3 aCol;
+#endif
+layout (location = 2) in vec2 aTex;
+#ifdef OCTAHEDRAL_NORMALS
+layout (location = 3) in vec2 aNorm;
+#else
+layout (location = 3) in vec3 aNorm;
+#endif
+
+vec3 decodePosition(vec3 offset, vec3 scale)
+{
+#ifdef QUANTIZED_POSITIONS
+  return offset + aPos * scale;
+#else
+  return aPos;
+#endif
+}
+
+vec3 decodeColor()
+{
+#ifdef NO_VERTEX_COLOR
+  return vec3(1.f);
+#else
+  return aCol;
+#endif
+}
+
+vec3 decodeNormal()
+{
+#ifdef OCTAHEDRAL_NORMALS
+  vec3 normal = vec3(aNorm, 1.f - abs(aNorm.x) - abs(aNorm.y));
+  float fold = max(-normal.z, 0.f);
+  normal.x += normal.x >= 0.f ? -fold : fold;
+  normal.y += normal.y >= 0.f ? -fold : fold;
+  return normalize(normal);
+#else
+  return aNorm;
+#endif
+}
@@ -85,6 +85,8 @@ class ExampleWindow : public kdr::Window
       this->useLights(this->lights);
 
       this->stove.rotateY(180.f);
+      this->addOccluder(this->wall);
+      this->setOcclusionQueries(true);
     }
 
     void onResize()
@@ -120,14 +122,14 @@ class ExampleWindow : public kdr::Window
     void render()
     {
       this->bindShader("default");
-      this->bindTexture("nathan");
-      this->renderSolid(nathan);
-      this->bindTexture("stove");
-      this->renderSolid(stove);
       this->bindTexture("tiles");
       this->renderSolid(wall);
       this->bindTexture("floor");
       this->renderSolid(plane);
+      this->bindTexture("nathan");
+      this->renderSolid(nathan);
+      this->bindTexture("stove");
+      this->renderSolid(stove);
       this->bindShader("gui");
       this->use2D();
       this->bindTexture("crosshair");
@@ -0,0 +1,280 @@
+#ifndef KDR_ARENA_HPP
+#define KDR_ARENA_HPP
+
+#include <GL/glew.h>
+#include <map>
+#include <iostream>
+#include <vector>
+
+namespace kdr
+{
+  /**
+   * @brief Class handing out ranges of a linear address space from a free list.
+   *
+   * Free ranges are kept sorted by offset and merged with their neighbours when released.
+   * Allocation takes the first free range that is large enough.
+   */
+  class RangeAllocator
+  {
+    public:
+      /**
+       * @brief Constructs an allocator managing the given number of units.
+       *
+       * @param capacity The number of units available.
+       */
+      RangeAllocator(const GLuint capacity = 0)
+      { this->reset(capacity, 0); }
+
+      /**
+       * @brief Allocates a range of units.
+       *
+       * @param size The number of units to allocate.
+       * @param oOffset Output parameter receiving the offset of the range.
+       * @return True if a large enough free range was found, false otherwise.
+       */
+      bool allocate(const GLuint size, GLuint& oOffset);
+      /**
+       * @brief Releases a range of units.
+       *
+       * @param offset The offset of the range.
+       * @param size The number of units in the range.
+       */
+      void release(const GLuint offset, const GLuint size);
+      /**
+       * @brief Adds units to the end of the address space.
+       *
+       * @param capacity The new number of units, at least the current one.
+       */
+      void grow(const GLuint capacity);
+      /**
+       * @brief Resets the allocator to a single used range at the start of the address space.
+       *
+       * @param capacity The number of units available.
+       * @param used The number of units in use, starting at offset zero.
+       */
+      void reset(const GLuint capacity, const GLuint used);
+
+      /**
+       * @brief Gets the number of units managed.
+       *
+       * @return The capacity in units.
+       */
+      GLuint getCapacity() const
+      { return this->capacity; }
+      /**
+       * @brief Gets the number of units in use.
+       *
+       * @return The used units.
+       */
+      GLuint getUsed() const
+      { return this->used; }
+      /**
+       * @brief Gets the size of the largest free range.
+       *
+       * @return The largest number of units a single allocation can currently get.
+       */
+      GLuint getLargestFree() const;
+
+    private:
+      std::map<GLuint, GLuint> freeRanges;
+      GLuint                   capacity {0};
+      GLuint                   used     {0};
+  };
+
+  /**
+   * @brief Class storing the vertices and indices of many meshes in one pair of GPU buffers.
+   *
+   * All meshes share a vertex layout and one vertex array object, so drawing different meshes
+   * needs no buffer or VAO changes. Indices are stored relative to the first vertex of their
+   * mesh and drawn with glDrawElementsBaseVertex. Buffers grow when full, and compact() moves
+   * the meshes together to remove holes left by removed meshes.
+   */
+  class MeshArena
+  {
+    public:
+      /**
+       * @brief Struct describing a vertex attribute of the layout.
+       */
+      struct Attribute
+      {
+        GLuint    layout     {0};
+        GLint     size       {0};
+        GLenum    type       {GL_FLOAT};
+        GLboolean normalized {GL_FALSE};
+        GLuint    offset     {0};
+      };
+      /**
+       * @brief Struct describing where a mesh lives in the arena.
+       */
+      struct Range
+      {
+        GLuint  firstVertex {0};
+        GLuint  vertexCount {0};
+        GLuint  firstIndex  {0};
+        GLsizei indexCount  {0};
+        bool    used        {false};
+      };
+
+      static constexpr GLuint INVALID_MESH {0xFFFFFFFF};
+
+      /**
+       * @brief Constructs an arena for a vertex layout. Buffers are created on first use.
+       *
+       * @param vertexStride The number of bytes per vertex.
+       * @param attributes The attributes of the vertex layout, with offsets in bytes.
+       * @param vertexCapacity The initial number of vertices the arena can hold.
+       * @param indexCapacity The initial number of indices the arena can hold.
+       */
+      MeshArena(const GLuint vertexStride, const std::vector<Attribute>& attributes, const GLuint vertexCapacity = 65536, const GLuint indexCapacity = 196608)
+      : vertexStride(vertexStride), attributes(attributes), vertices(vertexCapacity), indices(indexCapacity)
+      {}
+      /**
+       * @brief Destructor deleting the buffers.
+       */
+      ~MeshArena()
+      { this->Delete(); }
+
+      MeshArena(const MeshArena&) = delete;
+      MeshArena& operator=(const MeshArena&) = delete;
+
+      /**
+       * @brief Gets the arena shared by all solids, using the layout of kdr::Vertex::getSolidFormat().
+       *
+       * @return The solid arena.
+       */
+      static kdr::MeshArena& getSolidArena();
+
+      /**
+       * @brief Changes the vertex layout. Only possible while the arena holds no meshes.
+       *
+       * @param vertexStride The number of bytes per vertex.
+       * @param attributes The attributes of the vertex layout, with offsets in bytes.
+       * @return True if the layout was changed, false if meshes were already added.
+       */
+      bool setLayout(const GLuint vertexStride, const std::vector<Attribute>& attributes);
+
+      /**
+       * @brief Uploads a mesh into the arena, growing the buffers if needed.
+       *
+       * @param vertices The vertex data, vertexStride bytes per vertex.
+       * @param vertexCount The number of vertices.
+       * @param indices The index data, relative to the first vertex of the mesh.
+       * @param indexCount The number of indices.
+       * @return The handle of the mesh, or INVALID_MESH if it could not be added.
+       */
+      GLuint add(const void* vertices, const GLuint vertexCount, const GLuint* indices, const GLsizei indexCount);
+      /**
+       * @brief Releases the ranges of a mesh. Does not touch the GPU.
+       *
+       * @param mesh The handle of the mesh.
+       */
+      void remove(const GLuint mesh);
+      /**
+       * @brief Gets the location of a mesh in the arena.
+       *
+       * @param mesh The handle of the mesh.
+       * @return The range of the mesh.
+       */
+      const Range& getRange(const GLuint mesh) const
+      { return this->meshes[mesh]; }
+      /**
+       * @brief Draws a mesh as triangles, binding the shared VAO.
+       *
+       * @param mesh The handle of the mesh.
+       */
+      void draw(const GLuint mesh) const;
+      /**
+       * @brief Draws part of the indices of a mesh as triangles, binding the shared VAO.
+       *
+       * @param mesh The handle of the mesh.
+       * @param firstIndex The first index to draw, relative to the first index of the mesh.
+       * @param indexCount The number of indices to draw.
+       */
+      void draw(const GLuint mesh, const GLuint firstIndex, const GLsizei indexCount) const;
+      /**
+       * @brief Moves all meshes to the start of the buffers, removing holes.
+       */
+      void compact();
+
+      /**
+       * @brief Binds the shared vertex array object.
+       */
+      void Bind() const
+      { glBindVertexArray(this->vertexArray); }
+      /**
+       * @brief Unbinds the shared vertex array object.
+       */
+      void Unbind() const
+      { glBindVertexArray(0); }
+      /**
+       * @brief Deletes the buffers and forgets all meshes.
+       */
+      void Delete();
+
+      /**
+       * @brief Gets the ID of the vertex buffer.
+       *
+       * @return The vertex buffer ID.
+       */
+      GLuint getVertexBufferID() const
+      { return this->vertexBuffer; }
+      /**
+       * @brief Gets the ID of the index buffer.
+       *
+       * @return The index buffer ID.
+       */
+      GLuint getIndexBufferID() const
+      { return this->indexBuffer; }
+      /**
+       * @brief Gets the number of bytes per vertex.
+       *
+       * @return The vertex stride.
+       */
+      GLuint getVertexStride() const
+      { return this->vertexStride; }
+      /**
+       * @brief Gets the number of vertices in use.
+       *
+       * @return The used vertices.
+       */
+      GLuint getUsedVertices() const
+      { return this->vertices.getUsed(); }
+      /**
+       * @brief Gets the number of indices in use.
+       *
+       * @return The used indices.
+       */
+      GLuint getUsedIndices() const
+      { return this->indices.getUsed(); }
+      /**
+       * @brief Gets the share of free vertex space that cannot be used by a single allocation.
+       *
+       * @return The fragmentation between 0 (none) and 1.
+       */
+      float getFragmentation() const;
+
+    private:
+      GLuint                 vertexStride {0};
+      std::vector<Attribute> attributes;
+
+      GLuint vertexArray  {0};
+      GLuint vertexBuffer {0};
+      GLuint indexBuffer  {0};
+
+      kdr::RangeAllocator vertices;
+      kdr::RangeAllocator indices;
+      std::vector<Range>  meshes;
+      std::vector<GLuint> freeMeshes;
+
+      /**
+       * @brief Replaces the buffers with new ones, copying the live meshes over.
+       *
+       * @param vertexCapacity The number of vertices of the new vertex buffer.
+       * @param indexCapacity The number of indices of the new index buffer.
+       * @param pack True to move the meshes together, false to keep their offsets.
+       */
+      void _reallocate(const GLuint vertexCapacity, const GLuint indexCapacity, const bool pack);
+  };
+}
+
+#endif // KDR_ARENA_HPP
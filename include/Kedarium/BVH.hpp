@@ -0,0 +1,213 @@
+#ifndef KDR_BVH_HPP
+#define KDR_BVH_HPP
+
+#include <functional>
+#include <vector>
+
+#include "Bounds.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Class representing a dynamic bounding volume hierarchy over world-space boxes.
+   *
+   * Leaves store a box enlarged by a margin, so objects moving by small amounts do not
+   * change the tree. Insertions choose their sibling with the surface area heuristic and
+   * keep the tree balanced with rotations, while rebuild() constructs a binned SAH tree
+   * from scratch for static or heavily changed scenes.
+   */
+  class BVH
+  {
+    public:
+      /**
+       * @brief Index returned for missing nodes and proxies.
+       */
+      static constexpr int NULL_NODE {-1};
+
+      /**
+       * @brief Constructs an empty hierarchy.
+       *
+       * @param margin The distance by which leaf boxes are enlarged on each side.
+       */
+      BVH(const float margin = 0.1f)
+      : margin(margin)
+      {}
+
+      /**
+       * @brief Inserts a box into the hierarchy.
+       *
+       * @param box The world-space box of the object.
+       * @param userData The pointer returned by queries for this object.
+       * @return The proxy identifying the object in the hierarchy.
+       */
+      int insert(const kdr::Bounds::AABB& box, void* userData);
+      /**
+       * @brief Removes an object from the hierarchy.
+       *
+       * @param proxy The proxy returned by insert().
+       */
+      void remove(const int proxy);
+      /**
+       * @brief Moves an object, reinserting it only if it left its enlarged box.
+       *
+       * @param proxy The proxy returned by insert().
+       * @param box The new world-space box of the object.
+       * @return True if the object was reinserted, false if the tree was left unchanged.
+       */
+      bool update(const int proxy, const kdr::Bounds::AABB& box);
+      /**
+       * @brief Replaces the box of an object without restructuring the tree.
+       *
+       * Ancestors are only corrected by the next call to refit().
+       *
+       * @param proxy The proxy returned by insert().
+       * @param box The new world-space box of the object.
+       */
+      void setBounds(const int proxy, const kdr::Bounds::AABB& box);
+      /**
+       * @brief Recomputes the boxes of all internal nodes from their children.
+       */
+      void refit();
+      /**
+       * @brief Rebuilds the whole tree top-down with the binned surface area heuristic.
+       *
+       * Proxies stay valid across the rebuild.
+       */
+      void rebuild();
+      /**
+       * @brief Removes all objects from the hierarchy.
+       */
+      void clear();
+
+      /**
+       * @brief Gets the user data of an object.
+       *
+       * @param proxy The proxy returned by insert().
+       * @return The user data passed to insert().
+       */
+      void* getUserData(const int proxy) const
+      { return this->nodes[proxy].userData; }
+      /**
+       * @brief Gets the enlarged box stored for an object.
+       *
+       * @param proxy The proxy returned by insert().
+       * @return The enlarged box of the object.
+       */
+      const kdr::Bounds::AABB& getFatBounds(const int proxy) const
+      { return this->nodes[proxy].box; }
+      /**
+       * @brief Gets the number of objects in the hierarchy.
+       *
+       * @return The number of objects.
+       */
+      size_t getProxyCount() const
+      { return this->proxyCount; }
+      /**
+       * @brief Gets the height of the tree.
+       *
+       * @return The height of the root node, zero for an empty tree or a single leaf.
+       */
+      int getHeight() const
+      { return this->root == NULL_NODE ? 0 : this->nodes[this->root].height; }
+
+      /**
+       * @brief Collects the user data of all objects intersecting a frustum.
+       *
+       * @param frustum The frustum to test against.
+       * @param oResults Vector receiving the user data of the visible objects.
+       */
+      void queryFrustum(const kdr::Bounds::Frustum& frustum, std::vector<void*>& oResults) const;
+      /**
+       * @brief Collects the user data of all objects overlapping a box.
+       *
+       * @param box The box to test against.
+       * @param oResults Vector receiving the user data of the overlapping objects.
+       */
+      void queryOverlap(const kdr::Bounds::AABB& box, std::vector<void*>& oResults) const;
+      /**
+       * @brief Visits the objects whose boxes are hit by a ray, nearest boxes first.
+       *
+       * The callback performs the exact test for an object and returns the distance of its
+       * hit, or the current maximum distance if it was missed. Returning a smaller distance
+       * shortens the ray for the remaining traversal.
+       *
+       * @param ray The ray to cast.
+       * @param maxDistance The maximum distance along the ray.
+       * @param callback Function receiving the user data, the ray and the current maximum distance.
+       * @return The distance of the closest hit, or maxDistance if nothing was hit.
+       */
+      float queryRay(const kdr::Bounds::Ray& ray, const float maxDistance, const std::function<float(void*, const kdr::Bounds::Ray&, float)>& callback) const;
+
+    private:
+      /**
+       * @brief Struct representing a node of the tree.
+       */
+      struct Node
+      {
+        kdr::Bounds::AABB box;
+        void*             userData {NULL};
+        int               parent   {NULL_NODE};
+        int               child1   {NULL_NODE};
+        int               child2   {NULL_NODE};
+        int               height   {-1};
+
+        bool isLeaf() const
+        { return this->child1 == NULL_NODE; }
+      };
+
+      std::vector<Node> nodes;
+      int               root       {NULL_NODE};
+      int               freeList   {NULL_NODE};
+      size_t            proxyCount {0};
+      float             margin     {0.1f};
+
+      /**
+       * @brief Takes a node from the free list, growing the node pool if needed.
+       *
+       * @return The index of the allocated node.
+       */
+      int allocateNode();
+      /**
+       * @brief Returns a node to the free list.
+       *
+       * @param index The index of the node to free.
+       */
+      void freeNode(const int index);
+      /**
+       * @brief Links a leaf into the tree next to the cheapest sibling.
+       *
+       * @param leaf The index of the leaf to insert.
+       */
+      void insertLeaf(const int leaf);
+      /**
+       * @brief Unlinks a leaf from the tree, freeing its parent.
+       *
+       * @param leaf The index of the leaf to remove.
+       */
+      void removeLeaf(const int leaf);
+      /**
+       * @brief Walks from a node to the root, rebalancing and refitting each ancestor.
+       *
+       * @param index The index of the first node to fix.
+       */
+      void fixUpwards(int index);
+      /**
+       * @brief Performs a left or right rotation if the subtree at a node is unbalanced.
+       *
+       * @param index The index of the node to balance.
+       * @return The index of the node that replaced it as the subtree root.
+       */
+      int balance(const int index);
+      /**
+       * @brief Recursively builds a subtree over a range of leaves.
+       *
+       * @param leaves The leaf indices, reordered in place.
+       * @param begin The first leaf of the range.
+       * @param end One past the last leaf of the range.
+       * @return The index of the subtree root.
+       */
+      int buildRange(std::vector<int>& leaves, const size_t begin, const size_t end);
+  };
+}
+
+#endif // KDR_BVH_HPP
@@ -0,0 +1,363 @@
+#ifndef KDR_BOUNDS_HPP
+#define KDR_BOUNDS_HPP
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+#include "Space.hpp"
+#include "SIMD.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Namespace containing bounding volumes and visibility tests.
+   */
+  namespace Bounds
+  {
+    /**
+     * @brief Class representing an axis-aligned bounding box.
+     */
+    class AABB
+    {
+      public:
+        /**
+         * @brief Default constructor. Creates an empty (inverted) box.
+         */
+        AABB()
+        {}
+        /**
+         * @brief Constructs a box from its minimum and maximum corners.
+         *
+         * @param min The minimum corner.
+         * @param max The maximum corner.
+         */
+        AABB(const kdr::Space::Vec3& min, const kdr::Space::Vec3& max)
+        : min(min), max(max)
+        {}
+
+        /**
+         * @brief Gets the center of the box.
+         *
+         * @return The center of the box.
+         */
+        kdr::Space::Vec3 getCenter() const
+        {
+          return kdr::Space::Vec3 {
+            (this->min.x + this->max.x) * 0.5f,
+            (this->min.y + this->max.y) * 0.5f,
+            (this->min.z + this->max.z) * 0.5f
+          };
+        }
+        /**
+         * @brief Gets the half-size of the box along each axis.
+         *
+         * @return The extents of the box.
+         */
+        kdr::Space::Vec3 getExtents() const
+        {
+          return kdr::Space::Vec3 {
+            (this->max.x - this->min.x) * 0.5f,
+            (this->max.y - this->min.y) * 0.5f,
+            (this->max.z - this->min.z) * 0.5f
+          };
+        }
+        /**
+         * @brief Checks whether the box contains at least one point.
+         *
+         * @return True if the box is not empty, false otherwise.
+         */
+        bool isValid() const
+        { return this->min.x <= this->max.x && this->min.y <= this->max.y && this->min.z <= this->max.z; }
+
+        /**
+         * @brief Grows the box to contain the given point.
+         *
+         * @param point The point to include.
+         */
+        void expand(const kdr::Space::Vec3& point)
+        {
+          this->min = {fminf(this->min.x, point.x), fminf(this->min.y, point.y), fminf(this->min.z, point.z)};
+          this->max = {fmaxf(this->max.x, point.x), fmaxf(this->max.y, point.y), fmaxf(this->max.z, point.z)};
+        }
+        /**
+         * @brief Grows the box to contain another box.
+         *
+         * @param box The box to include.
+         */
+        void expand(const kdr::Bounds::AABB& box)
+        {
+          this->min = {fminf(this->min.x, box.min.x), fminf(this->min.y, box.min.y), fminf(this->min.z, box.min.z)};
+          this->max = {fmaxf(this->max.x, box.max.x), fmaxf(this->max.y, box.max.y), fmaxf(this->max.z, box.max.z)};
+        }
+        /**
+         * @brief Gets the surface area of the box.
+         *
+         * @return The surface area, or zero for an empty box.
+         */
+        float getSurfaceArea() const
+        {
+          if (!this->isValid()) return 0.f;
+          const float x = this->max.x - this->min.x;
+          const float y = this->max.y - this->min.y;
+          const float z = this->max.z - this->min.z;
+          return 2.f * (x * y + y * z + z * x);
+        }
+        /**
+         * @brief Checks whether this box fully contains another box.
+         *
+         * @param box The box to check.
+         * @return True if the other box is inside this one, false otherwise.
+         */
+        bool contains(const kdr::Bounds::AABB& box) const
+        {
+          return
+            this->min.x <= box.min.x && this->min.y <= box.min.y && this->min.z <= box.min.z &&
+            this->max.x >= box.max.x && this->max.y >= box.max.y && this->max.z >= box.max.z;
+        }
+        /**
+         * @brief Checks whether this box overlaps another box.
+         *
+         * @param box The box to check.
+         * @return True if the boxes overlap, false otherwise.
+         */
+        bool overlaps(const kdr::Bounds::AABB& box) const
+        {
+          return
+            this->min.x <= box.max.x && this->max.x >= box.min.x &&
+            this->min.y <= box.max.y && this->max.y >= box.min.y &&
+            this->min.z <= box.max.z && this->max.z >= box.min.z;
+        }
+
+        kdr::Space::Vec3 min { FLT_MAX};
+        kdr::Space::Vec3 max {-FLT_MAX};
+    };
+
+    /**
+     * @brief Class representing a bounding sphere.
+     */
+    class Sphere
+    {
+      public:
+        /**
+         * @brief Default constructor. Creates a zero-sized sphere at the origin.
+         */
+        Sphere()
+        {}
+        /**
+         * @brief Constructs a sphere from its center and radius.
+         *
+         * @param center The center of the sphere.
+         * @param radius The radius of the sphere.
+         */
+        Sphere(const kdr::Space::Vec3& center, const float radius)
+        : center(center), radius(radius)
+        {}
+
+        kdr::Space::Vec3 center {0.f};
+        float            radius {0.f};
+    };
+
+    /**
+     * @brief Class representing a ray with a precomputed inverse direction.
+     */
+    class Ray
+    {
+      public:
+        /**
+         * @brief Default constructor. Creates a ray pointing down the negative Z-axis.
+         */
+        Ray()
+        : Ray({0.f, 0.f, 0.f}, {0.f, 0.f, -1.f})
+        {}
+        /**
+         * @brief Constructs a ray from its origin and direction.
+         *
+         * @param origin The origin of the ray.
+         * @param direction The direction of the ray, normalized by the constructor.
+         */
+        Ray(const kdr::Space::Vec3& origin, const kdr::Space::Vec3& direction)
+        : origin(origin), direction(kdr::Space::normalize(direction))
+        {
+          this->inverseDirection = {
+            1.f / this->direction.x,
+            1.f / this->direction.y,
+            1.f / this->direction.z
+          };
+        }
+
+        kdr::Space::Vec3 origin           {0.f};
+        kdr::Space::Vec3 direction        {0.f, 0.f, -1.f};
+        kdr::Space::Vec3 inverseDirection {0.f};
+    };
+
+    /**
+     * @brief Class representing the six planes of a view frustum.
+     *
+     * Each plane is stored as (a, b, c, d) with a normalized normal pointing inwards,
+     * so a point p is inside the plane when a * p.x + b * p.y + c * p.z + d >= 0.
+     */
+    class Frustum
+    {
+      public:
+        float planes[6][4] {};
+    };
+
+    /**
+     * @brief Stack used by hierarchy traversals, keeping shallow trees off the heap.
+     *
+     * @tparam T The type of the stack entries.
+     */
+    template <typename T>
+    class TraversalStack
+    {
+      public:
+        /**
+         * @brief Pushes an entry onto the stack.
+         *
+         * @param item The entry to push.
+         */
+        void push(const T& item)
+        {
+          if (this->size < LOCAL_SIZE)
+          {
+            this->local[this->size++] = item;
+            return;
+          }
+          this->overflow.push_back(item);
+          this->size++;
+        }
+        /**
+         * @brief Pops the most recently pushed entry.
+         *
+         * @return The popped entry.
+         */
+        T pop()
+        {
+          this->size--;
+          if (this->size < LOCAL_SIZE) return this->local[this->size];
+          T item = this->overflow.back();
+          this->overflow.pop_back();
+          return item;
+        }
+        /**
+         * @brief Checks if the stack is empty.
+         *
+         * @return True if the stack holds no entries, false otherwise.
+         */
+        bool empty() const
+        { return this->size == 0; }
+
+      private:
+        static constexpr size_t LOCAL_SIZE {64};
+
+        T              local[LOCAL_SIZE];
+        std::vector<T> overflow;
+        size_t         size {0};
+    };
+
+    /**
+     * @brief Computes the bounding box of interleaved vertex positions.
+     *
+     * @param vertices The interleaved vertex data, starting with the position of the first vertex.
+     * @param vertexCount The number of vertices.
+     * @param stride The number of floats between consecutive vertices.
+     * @return The bounding box of the positions.
+     */
+    kdr::Bounds::AABB fromVertices(const float* vertices, const size_t vertexCount, const size_t stride);
+    /**
+     * @brief Computes a bounding sphere of interleaved vertex positions centered on their bounding box.
+     *
+     * @param vertices The interleaved vertex data, starting with the position of the first vertex.
+     * @param vertexCount The number of vertices.
+     * @param stride The number of floats between consecutive vertices.
+     * @param box The bounding box of the positions.
+     * @return The bounding sphere of the positions.
+     */
+    kdr::Bounds::Sphere sphereFromVertices(const float* vertices, const size_t vertexCount, const size_t stride, const kdr::Bounds::AABB& box);
+    /**
+     * @brief Transforms a box by a matrix and returns the box enclosing the result.
+     *
+     * @param box The box to transform.
+     * @param mat The transformation matrix.
+     * @return The transformed bounding box.
+     */
+    kdr::Bounds::AABB transform(const kdr::Bounds::AABB& box, const kdr::Space::Mat4& mat);
+    /**
+     * @brief Transforms a sphere by a matrix, scaling its radius by the largest axis scale.
+     *
+     * @param sphere The sphere to transform.
+     * @param mat The transformation matrix.
+     * @return The transformed bounding sphere.
+     */
+    kdr::Bounds::Sphere transform(const kdr::Bounds::Sphere& sphere, const kdr::Space::Mat4& mat);
+
+    /**
+     * @brief Extracts the frustum planes from a view-projection matrix.
+     *
+     * @param mat The combined projection and view matrix.
+     * @return The normalized frustum planes.
+     */
+    kdr::Bounds::Frustum extractFrustum(const kdr::Space::Mat4& mat);
+    /**
+     * @brief Moves frustum planes from world space into the model space of a matrix.
+     *
+     * @param frustum The world-space frustum.
+     * @param model The model matrix mapping model space to world space.
+     * @return The model-space frustum with normalized planes.
+     */
+    kdr::Bounds::Frustum toModelSpace(const kdr::Bounds::Frustum& frustum, const kdr::Space::Mat4& model);
+    /**
+     * @brief Tests whether a box intersects a frustum.
+     *
+     * @param frustum The frustum to test against.
+     * @param box The box to test.
+     * @return True if the box is at least partially inside, false otherwise.
+     */
+    bool testAABB(const kdr::Bounds::Frustum& frustum, const kdr::Bounds::AABB& box);
+    /**
+     * @brief Tests whether a sphere intersects a frustum.
+     *
+     * @param frustum The frustum to test against.
+     * @param sphere The sphere to test.
+     * @return True if the sphere is at least partially inside, false otherwise.
+     */
+    bool testSphere(const kdr::Bounds::Frustum& frustum, const kdr::Bounds::Sphere& sphere);
+    /**
+     * @brief Classifies a box against the frustum planes selected by a mask.
+     *
+     * Planes the box is entirely inside of are cleared from the mask, so hierarchical
+     * traversals can skip them for all children of the box.
+     *
+     * @param frustum The frustum to test against.
+     * @param box The box to test.
+     * @param ioPlaneMask Bit mask of the planes to test, updated on return.
+     * @return -1 if the box is outside, 1 if it is fully inside, 0 if it intersects the frustum.
+     */
+    int classifyAABB(const kdr::Bounds::Frustum& frustum, const kdr::Bounds::AABB& box, unsigned int& ioPlaneMask);
+    /**
+     * @brief Intersects a ray with a box using the slab method.
+     *
+     * @param ray The ray to intersect.
+     * @param box The box to intersect.
+     * @param maxDistance The maximum distance along the ray.
+     * @param oDistance Output parameter receiving the entry distance, zero if the origin is inside.
+     * @return True if the ray hits the box within the maximum distance, false otherwise.
+     */
+    bool intersectRay(const kdr::Bounds::Ray& ray, const kdr::Bounds::AABB& box, const float maxDistance, float& oDistance);
+    /**
+     * @brief Tests a batch of boxes against a frustum.
+     *
+     * Boxes are tested four at a time with SSE when available.
+     *
+     * @param frustum The frustum to test against.
+     * @param boxes The boxes to test.
+     * @param count The number of boxes.
+     * @param oVisible Output array receiving 1 for each visible box and 0 otherwise.
+     * @return The number of visible boxes.
+     */
+    size_t cullAABBs(const kdr::Bounds::Frustum& frustum, const kdr::Bounds::AABB* boxes, const size_t count, unsigned char* oVisible);
+  }
+}
+
+#endif // KDR_BOUNDS_HPP
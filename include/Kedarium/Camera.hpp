@@ -4,8 +4,10 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <string>
+#include <vector>
 
 #include "Space.hpp"
+#include "Bounds.hpp"
 #include "Keys.hpp"
 
 namespace kdr
@@ -44,6 +46,20 @@ namespace kdr
        */
       kdr::Space::Vec3 getPosition() const
       { return this->position; }
+      /**
+       * @brief Gets the direction the camera is facing.
+       * 
+       * @return The normalized front vector of the camera.
+       */
+      kdr::Space::Vec3 getFront() const
+      { return this->front; }
+      /**
+       * @brief Gets the ray from the camera position along its view direction.
+       * 
+       * @return The ray through the center of the screen.
+       */
+      kdr::Bounds::Ray getViewRay() const
+      { return kdr::Bounds::Ray {this->position, this->front}; }
       /**
        * @brief Gets the field of view angle of the camera.
        * 
@@ -100,6 +116,34 @@ namespace kdr
        */
       bool getLocked() const
       { return this->locked; }
+      /**
+       * @brief Gets the yaw angle of the camera.
+       * 
+       * @return The yaw angle in degrees.
+       */
+      float getYaw() const
+      { return this->yaw; }
+      /**
+       * @brief Gets the pitch angle of the camera.
+       * 
+       * @return The pitch angle in degrees.
+       */
+      float getPitch() const
+      { return this->pitch; }
+      /**
+       * @brief Gets the view frustum extracted from the last 3D camera matrix.
+       * 
+       * @return The view frustum of the camera.
+       */
+      const kdr::Bounds::Frustum& getFrustum() const
+      { return this->frustum; }
+      /**
+       * @brief Gets the camera matrix, projection times view, from the last update.
+       * 
+       * @return The camera matrix.
+       */
+      const kdr::Space::Mat4& getMatrix() const
+      { return this->matrix; }
 
       /**
        * @brief Sets the position of the camera.
@@ -164,6 +208,20 @@ namespace kdr
        */
       void setLocked(const bool locked)
       { this->locked = locked; }
+      /**
+       * @brief Sets the yaw angle of the camera.
+       * 
+       * @param yaw The new yaw angle in degrees.
+       */
+      void setYaw(const float yaw)
+      { this->yaw = yaw; }
+      /**
+       * @brief Sets the pitch angle of the camera.
+       * 
+       * @param pitch The new pitch angle in degrees, clamped to [-89, 89].
+       */
+      void setPitch(const float pitch)
+      { this->pitch = pitch > 89.f ? 89.f : (pitch < -89.f ? -89.f : pitch); }
 
       /**
        * @brief Handles keyboard input for camera movement.
@@ -187,7 +245,7 @@ namespace kdr
        */
       void updateMatrix2D();
       /**
-       * @brief Updates the transformation matrix for 3D rendering.
+       * @brief Updates the transformation matrix and view frustum for 3D rendering.
        */
       void updateMatrix3D();
       /**
@@ -213,11 +271,65 @@ namespace kdr
       kdr::Space::Vec3 up       {0.f, 1.f,  0.f};
       kdr::Space::Mat4 matrix   {1.f};
 
+      kdr::Bounds::Frustum frustum;
+
       float yaw   {-90.f};
       float pitch {0.f};
 
       bool locked {false};
   };
+
+  /**
+   * @brief Class representing a scripted camera path through timed keyframes.
+   *
+   * Positions and angles are interpolated linearly between keyframes, so replaying the
+   * same times always produces the same views.
+   */
+  class CameraPath
+  {
+    public:
+      /**
+       * @brief Adds a keyframe to the path. Keyframes must be added in increasing time.
+       * 
+       * @param time The time of the keyframe in seconds.
+       * @param position The camera position at the keyframe.
+       * @param yaw The yaw angle in degrees at the keyframe.
+       * @param pitch The pitch angle in degrees at the keyframe.
+       */
+      void addKeyframe(const float time, const kdr::Space::Vec3& position, const float yaw, const float pitch)
+      { this->keyframes.push_back({time, position, yaw, pitch}); }
+      /**
+       * @brief Moves a camera to its place on the path.
+       * 
+       * Times before the first or after the last keyframe hold the nearest keyframe.
+       * 
+       * @param camera The camera to move.
+       * @param time The time along the path in seconds.
+       */
+      void apply(kdr::Camera& camera, const float time) const;
+
+      /**
+       * @brief Gets the duration of the path.
+       * 
+       * @return The time of the last keyframe, or zero for an empty path.
+       */
+      float getDuration() const
+      { return this->keyframes.empty() ? 0.f : this->keyframes.back().time; }
+
+    private:
+      /**
+       * @brief Struct representing a camera pose at a point in time.
+       */
+      struct Keyframe
+      {
+        float            time;
+        kdr::Space::Vec3 position;
+        float            yaw;
+        float            pitch;
+      };
+
+      std::vector<Keyframe> keyframes;
+  };
 }
 
 #endif // KDR_CAMERA_HPP
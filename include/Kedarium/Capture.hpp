@@ -0,0 +1,161 @@
+#ifndef KDR_CAPTURE_HPP
+#define KDR_CAPTURE_HPP
+
+#include <GL/glew.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include "Image.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Class capturing rendered frames to numbered PNG files without stalling rendering.
+   *
+   * Each frame is read into one of a ring of pixel buffer objects and mapped only once its
+   * fence has signalled, usually a few frames later. The mapped pixels are copied into a
+   * pooled buffer and encoded by background threads.
+   *
+   * At most a few frames wait for the encoders. Once the queue is full, finished frames stay
+   * in the ring, and capturing blocks only when the ring wraps around, so no frame is lost
+   * and memory stays bounded when encoding is slower than rendering.
+   */
+  class FrameCapture
+  {
+    public:
+      /**
+       * @brief Default constructor.
+       */
+      FrameCapture()
+      {}
+      /**
+       * @brief Destructor. Call stop() while the context is still current to finish pending frames.
+       */
+      ~FrameCapture()
+      { this->_stopEncoders(); }
+
+      FrameCapture(const FrameCapture&) = delete;
+      FrameCapture& operator=(const FrameCapture&) = delete;
+
+      /**
+       * @brief Starts capturing frames.
+       *
+       * Frames are written to pathPrefix followed by a six digit frame number and ".png".
+       *
+       * @param pathPrefix The prefix of the written file paths.
+       * @param width The width of the captured region.
+       * @param height The height of the captured region.
+       * @param ringSize The number of pixel buffer objects frames are read into.
+       * @param queueSize The number of frames that may wait for the encoders.
+       * @return True if capturing started, false otherwise.
+       */
+      bool start(const std::string& pathPrefix, const int width, const int height, const unsigned int ringSize = 3, const unsigned int queueSize = 4);
+      /**
+       * @brief Reads back the current frame. Call after rendering and before swapping buffers.
+       *
+       * @param readBuffer The color buffer to read from.
+       */
+      void capture(const GLenum readBuffer);
+      /**
+       * @brief Stops capturing, waiting for all pending frames to be read back and encoded.
+       */
+      void stop();
+
+      /**
+       * @brief Checks if frames are being captured.
+       *
+       * @return True if capturing, false otherwise.
+       */
+      bool getActive() const
+      { return this->active; }
+      /**
+       * @brief Gets the number of frames read back so far.
+       *
+       * @return The number of captured frames.
+       */
+      unsigned int getFrameCount() const
+      { return this->frameCount; }
+      /**
+       * @brief Gets the number of times reading back had to wait for the GPU.
+       *
+       * A non-zero count means the ring is too small for the GPU latency.
+       *
+       * @return The number of stalls.
+       */
+      unsigned int getStallCount() const
+      { return this->stallCount; }
+      /**
+       * @brief Gets the number of times reading back had to wait for the encoders.
+       *
+       * A non-zero count means encoding is slower than rendering, and capturing throttled the frame rate.
+       *
+       * @return The number of stalls.
+       */
+      unsigned int getQueueStallCount() const
+      { return this->queueStallCount; }
+
+    private:
+      /**
+       * @brief Struct representing a pixel buffer object of the ring.
+       */
+      struct Slot
+      {
+        GLuint       PBO     {0};
+        GLsync       fence   {NULL};
+        unsigned int frame   {0};
+        bool         pending {false};
+      };
+      /**
+       * @brief Struct representing a frame waiting to be encoded.
+       */
+      struct Job
+      {
+        unsigned int         frame {0};
+        std::vector<GLubyte> pixels;
+      };
+
+      std::string       pathPrefix;
+      int               width      {0};
+      int               height     {0};
+      bool              active     {false};
+      unsigned int      frameCount {0};
+      unsigned int      stallCount {0};
+      std::vector<Slot> slots;
+      size_t            nextSlot   {0};
+
+      size_t       queueSize       {4};
+      unsigned int queueStallCount {0};
+
+      std::vector<std::thread>          encoders;
+      std::mutex                        mutex;
+      std::condition_variable           condition;
+      std::condition_variable           queueSpace;
+      std::deque<Job>                   jobs;
+      std::vector<std::vector<GLubyte>> bufferPool;
+      bool                              stopping {false};
+
+      /**
+       * @brief Maps a pending slot and queues its pixels for encoding.
+       *
+       * @param slot The slot to read.
+       * @param wait True to wait for the fence and the encoders, false to skip the slot if it has not signalled or the queue is full.
+       * @return True if the slot was read, false otherwise.
+       */
+      bool _readSlot(Slot& slot, const bool wait);
+      /**
+       * @brief Encodes queued frames until stopped.
+       */
+      void _encode();
+      /**
+       * @brief Signals the encoder threads to finish the queue and joins them.
+       */
+      void _stopEncoders();
+  };
+}
+
+#endif // KDR_CAPTURE_HPP
@@ -31,9 +31,13 @@ namespace kdr
     /**
      * @brief Initializes GLFW.
      *
+     * In headless mode windows are created hidden. Without a display server, GLFW's null
+     * platform with an EGL context is used so rendering works on servers with Mesa.
+     *
+     * @param headless True to prepare for offscreen windows, false for visible ones.
      * @return True if GLFW initialization is successful, false otherwise.
      */
-    bool initializeGlfw();
+    bool initializeGlfw(const bool headless = false);
     /**
      * @brief Initializes GLEW.
      *
@@ -58,11 +62,11 @@ namespace kdr
          * @brief Adds an item to the manager.
          * 
          * @param key The key associated with the item.
-         * @param item The item to add.
+         * @param item The item to add, moved into the manager.
          */
-        void add(std::string key, const T& item)
+        void add(std::string key, T&& item)
         {
-          this->items[key] = std::make_unique<T>(item);
+          this->items[key] = std::make_unique<T>(std::move(item));
         }
         /**
          * @brief Gets an item from the manager.
@@ -89,6 +93,19 @@ namespace kdr
         {
           this->items.erase(key);
         }
+        /**
+         * @brief Calls a function for every item in the manager, in key order.
+         * 
+         * @param function The function receiving the key and a reference to each item.
+         */
+        template <typename F>
+        void forEach(F function)
+        {
+          for (auto& item : this->items)
+          {
+            function(item.first, *item.second);
+          }
+        }
         /**
          * @brief Clears all items from the manager.
          */
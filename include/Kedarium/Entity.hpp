@@ -0,0 +1,31 @@
+#ifndef KDR_ENTITY_HPP
+#define KDR_ENTITY_HPP
+
+#include <cstdint>
+
+namespace kdr
+{
+  /**
+   * @brief Identifier of an entity, with its slot in the low bits and a generation in the high bits.
+   *
+   * The generation changes whenever a slot is reused, so the identifier of a destroyed
+   * entity is detected as stale until its slot has been reused 256 times, when the 8 bit
+   * generation wraps around.
+   */
+  using Entity = uint32_t;
+
+  /**
+   * @brief The identifier that never refers to an entity.
+   */
+  constexpr kdr::Entity NULL_ENTITY {UINT32_MAX};
+  /**
+   * @brief The number of low bits of an entity holding its slot.
+   */
+  constexpr uint32_t ENTITY_SLOT_BITS {24};
+  /**
+   * @brief The mask extracting the slot of an entity.
+   */
+  constexpr uint32_t ENTITY_SLOT_MASK {(1u << ENTITY_SLOT_BITS) - 1};
+}
+
+#endif // KDR_ENTITY_HPP
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 #include <string>
 
 namespace kdr
@@ -20,6 +21,23 @@ namespace kdr
      * @return The contents of the file as a string, or an empty string if the file cannot be loaded.
      */
     std::string getContents(const std::string& path);
+    /**
+     * @brief Reads the contents of a binary file.
+     *
+     * @param path The path to the file.
+     * @param oData Output parameter receiving the bytes of the file.
+     * @return True if the file was read successfully, false otherwise.
+     */
+    bool readBinary(const std::string& path, std::vector<char>& oData);
+    /**
+     * @brief Writes bytes to a binary file, creating missing parent directories.
+     *
+     * @param path The path to the file.
+     * @param data The bytes to write.
+     * @param size The number of bytes to write.
+     * @return True if the file was written successfully, false otherwise.
+     */
+    bool writeBinary(const std::string& path, const void* data, const size_t size);
   }
 }
 
@@ -28,15 +28,7 @@ namespace kdr
          * @brief Destructor for Element objects.
          */
         virtual ~Element()
-        {
-          this->VAO->Delete();
-          this->VBO->Delete();
-          this->EBO->Delete();
-
-          delete this->VAO;
-          delete this->VBO;
-          delete this->EBO;
-        }
+        {}
 
         /**
          * @brief Sets the position of the element.
@@ -64,9 +56,9 @@ namespace kdr
         virtual void render() const;
 
       private:
-        kdr::Graphics::VAO* VAO;
-        kdr::Graphics::VBO* VBO;
-        kdr::Graphics::EBO* EBO;
+        kdr::Graphics::VAO VAO;
+        kdr::Graphics::VBO VBO;
+        kdr::Graphics::EBO EBO;
 
         kdr::Space::Vec2 position {0.f};
     };
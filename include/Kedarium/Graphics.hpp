@@ -2,7 +2,14 @@
 #define KDR_GRAPHICS_HPP
 
 #include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
 #include <string>
 
 #include "File.hpp"
@@ -32,6 +39,35 @@ namespace kdr
     inline void useFillMode()
     { glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); }
 
+    /**
+     * @brief Sets the directory where linked shader program binaries are cached.
+     *
+     * Binaries are keyed by a hash of the shader sources and the driver's vendor, renderer
+     * and version strings, so a driver update invalidates them automatically.
+     *
+     * @param directory The cache directory, or an empty string to disable the cache.
+     */
+    void setShaderCacheDirectory(const std::string& directory);
+    /**
+     * @brief Gets the directory where linked shader program binaries are cached.
+     *
+     * @return The cache directory, or an empty string if the cache is disabled.
+     */
+    const std::string& getShaderCacheDirectory();
+    /**
+     * @brief Loads a shader source, resolving includes and injecting defines.
+     *
+     * Lines of the form #include "file" are replaced by the contents of the file, relative to
+     * the including file; every file is included at most once. Each define is inserted as a
+     * #define line right after the #version directive, as "NAME" or "NAME VALUE".
+     *
+     * @param path The file path to the shader source code.
+     * @param defines The preprocessor definitions to inject.
+     * @param oDependencies Optional output parameter receiving the canonical paths of all files read.
+     * @return The preprocessed source, or an empty string if a file could not be loaded.
+     */
+    std::string preprocessShader(const std::string& path, const std::vector<std::string>& defines, std::vector<std::string>* oDependencies = NULL);
+
     /**
      * @brief Class representing a shader program.
      */
@@ -41,10 +77,51 @@ namespace kdr
         /**
          * @brief Constructs a Shader object by loading and compiling vertex and fragment shaders.
          *
+         * If a shader cache directory is set, a matching program binary is loaded instead of
+         * compiling, and newly linked programs are added to the cache.
+         *
+         * A deferred shader only issues the compile and link commands, letting the driver work
+         * on several programs at once; its status is checked by finalize().
+         *
          * @param vertexPath The file path to the vertex shader source code.
          * @param fragmentPath The file path to the fragment shader source code.
+         * @param defines The preprocessor definitions injected into both stages.
+         * @param deferred True to return before the program has finished linking.
+         */
+        Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {}, const bool deferred = false);
+        /**
+         * @brief Creates a shader program from already preprocessed sources.
+         *
+         * @param vertexSource The vertex shader source code.
+         * @param fragmentSource The fragment shader source code.
+         * @param vertexPath The vertex shader path used in error messages.
+         * @param fragmentPath The fragment shader path used in error messages.
+         * @param deferred True to return before the program has finished linking.
+         * @return The shader program.
          */
-        Shader(const std::string& vertexPath, const std::string& fragmentPath);
+        static kdr::Graphics::Shader fromSources(const std::string& vertexSource, const std::string& fragmentSource, const std::string& vertexPath, const std::string& fragmentPath, const bool deferred = false);
+        /**
+         * @brief Destructor deleting the shader program.
+         */
+        ~Shader()
+        { this->Delete(); }
+
+        Shader(const Shader&) = delete;
+        Shader& operator=(const Shader&) = delete;
+        /**
+         * @brief Move constructor taking over the program of another shader.
+         *
+         * @param other The shader to move from, left empty.
+         */
+        Shader(Shader&& other) noexcept
+        { *this = std::move(other); }
+        /**
+         * @brief Move assignment deleting the current program and taking over another.
+         *
+         * @param other The shader to move from, left empty.
+         * @return A reference to this shader.
+         */
+        Shader& operator=(Shader&& other) noexcept;
 
         /**
          * @brief Gets the ID of the shader program.
@@ -53,6 +130,34 @@ namespace kdr
          */
         GLuint getID() const
         { return this->ID; }
+        /**
+         * @brief Gets the time it took to create the shader program.
+         * 
+         * @return The load time in milliseconds, including reading the sources.
+         */
+        double getLoadMilliseconds() const
+        { return this->loadMilliseconds; }
+        /**
+         * @brief Checks if the shader program was loaded from the binary cache.
+         * 
+         * @return True if the program binary was loaded from the cache, false if it was compiled.
+         */
+        bool getFromCache() const
+        { return this->fromCache; }
+        /**
+         * @brief Checks if the driver has finished compiling and linking the program.
+         * 
+         * Without KHR_parallel_shader_compile this always returns true, and finalize() blocks.
+         * 
+         * @return True if finalize() will not wait for the driver, false otherwise.
+         */
+        bool isReady() const;
+        /**
+         * @brief Waits for a deferred compile, reporting errors and updating the binary cache.
+         * 
+         * @return True if the program linked successfully, false otherwise.
+         */
+        bool finalize();
 
         /**
          * @brief Sets an integer uniform in the shader.
@@ -83,13 +188,113 @@ namespace kdr
         void Use() const
         { glUseProgram(this->ID); }
         /**
-         * @brief Deletes the shader program.
+         * @brief Deletes the shader program and any unfinished stages, leaving the shader empty.
          */
-        void Delete() const
-        { glDeleteProgram(this->ID); }
+        void Delete();
 
       private:
-        GLuint ID;
+        GLuint ID               {0};
+        double loadMilliseconds {0.0};
+        bool   fromCache        {false};
+        bool   linked           {false};
+
+        GLuint      vertexShader   {0};
+        GLuint      fragmentShader {0};
+        bool        pending        {false};
+        std::string vertexPath;
+        std::string fragmentPath;
+        std::string cachePath;
+
+        std::chrono::steady_clock::time_point loadStart;
+
+        /**
+         * @brief Constructs an empty shader program filled in by fromSources().
+         */
+        Shader()
+        {}
+
+        /**
+         * @brief Loads the program from the binary cache or starts compiling it.
+         *
+         * @param vertexSource The vertex shader source code.
+         * @param fragmentSource The fragment shader source code.
+         * @param deferred True to return before the program has finished linking.
+         */
+        void _load(const std::string& vertexSource, const std::string& fragmentSource, const bool deferred);
+        /**
+         * @brief Issues the compile and link commands without waiting for their results.
+         *
+         * @param vertexSource The vertex shader source code.
+         * @param fragmentSource The fragment shader source code.
+         */
+        void _compile(const std::string& vertexSource, const std::string& fragmentSource);
+        /**
+         * @brief Loads the program from a cached binary.
+         *
+         * @param cachePath The path of the cached binary.
+         * @return True if the binary was accepted by the driver, false otherwise.
+         */
+        bool _loadBinary(const std::string& cachePath);
+        /**
+         * @brief Writes the linked program binary to the cache.
+         *
+         * @param cachePath The path of the cached binary.
+         */
+        void _saveBinary(const std::string& cachePath) const;
+    };
+
+    /**
+     * @brief Class caching shader variants by their sources and define sets.
+     *
+     * Variants are compiled on first use. prepare() issues the compiles of several variants
+     * up front so the driver can build them in parallel.
+     */
+    class ShaderVariants
+    {
+      public:
+        /**
+         * @brief Starts compiling variants that are not in the cache yet.
+         *
+         * @param vertexPath The file path to the vertex shader source code.
+         * @param fragmentPath The file path to the fragment shader source code.
+         * @param defineSets The define sets of the variants to compile.
+         */
+        void prepare(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::vector<std::string>>& defineSets);
+        /**
+         * @brief Gets a variant, compiling it if needed.
+         *
+         * The order of the defines does not matter.
+         *
+         * @param vertexPath The file path to the vertex shader source code.
+         * @param fragmentPath The file path to the fragment shader source code.
+         * @param defines The preprocessor definitions of the variant.
+         * @return A pointer to the linked variant.
+         */
+        kdr::Graphics::Shader* get(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines);
+        /**
+         * @brief Gets the number of cached variants.
+         *
+         * @return The number of variants.
+         */
+        size_t getVariantCount() const
+        { return this->variants.size(); }
+        /**
+         * @brief Deletes all cached variants.
+         */
+        void Delete();
+
+      private:
+        std::map<std::string, std::unique_ptr<kdr::Graphics::Shader>> variants;
+
+        /**
+         * @brief Builds the cache key of a variant.
+         *
+         * @param vertexPath The file path to the vertex shader source code.
+         * @param fragmentPath The file path to the fragment shader source code.
+         * @param defines The preprocessor definitions of the variant.
+         * @return The key identifying the variant.
+         */
+        static std::string makeKey(const std::string& vertexPath, const std::string& fragmentPath, std::vector<std::string> defines);
     };
 
     /**
@@ -105,6 +310,42 @@ namespace kdr
          * @param size The size of the vertex data array in bytes.
          */
         VBO(GLfloat vertices[], GLsizeiptr size);
+        /**
+         * @brief Constructs an empty VBO object that owns no buffer.
+         */
+        VBO()
+        {}
+        /**
+         * @brief Destructor deleting the buffer.
+         */
+        ~VBO()
+        { this->Delete(); }
+
+        VBO(const VBO&) = delete;
+        VBO& operator=(const VBO&) = delete;
+        /**
+         * @brief Move constructor taking over the buffer of another object.
+         *
+         * @param other The object to move from, left empty.
+         */
+        VBO(VBO&& other) noexcept
+        : ID(std::exchange(other.ID, 0))
+        {}
+        /**
+         * @brief Move assignment deleting the current buffer and taking over another.
+         *
+         * @param other The object to move from, left empty.
+         * @return A reference to this object.
+         */
+        VBO& operator=(VBO&& other) noexcept
+        {
+          if (this != &other)
+          {
+            this->Delete();
+            this->ID = std::exchange(other.ID, 0);
+          }
+          return *this;
+        }
 
         /**
          * @brief Gets the ID of the vertex buffer object.
@@ -125,13 +366,16 @@ namespace kdr
         void Unbind() const
         { glBindBuffer(GL_ARRAY_BUFFER, 0); }
         /**
-         * @brief Deletes the VBO.
+         * @brief Deletes the VBO, leaving the object empty.
          */
-        void Delete() const
-        { glDeleteBuffers(1, &this->ID); }
+        void Delete()
+        {
+          if (this->ID != 0) glDeleteBuffers(1, &this->ID);
+          this->ID = 0;
+        }
 
       private:
-        GLuint ID;
+        GLuint ID {0};
     };
 
     /**
@@ -147,6 +391,42 @@ namespace kdr
          * @param size The size of the index data array in bytes.
          */
         EBO(GLuint indices[], GLsizeiptr size);
+        /**
+         * @brief Constructs an empty EBO object that owns no buffer.
+         */
+        EBO()
+        {}
+        /**
+         * @brief Destructor deleting the buffer.
+         */
+        ~EBO()
+        { this->Delete(); }
+
+        EBO(const EBO&) = delete;
+        EBO& operator=(const EBO&) = delete;
+        /**
+         * @brief Move constructor taking over the buffer of another object.
+         *
+         * @param other The object to move from, left empty.
+         */
+        EBO(EBO&& other) noexcept
+        : ID(std::exchange(other.ID, 0))
+        {}
+        /**
+         * @brief Move assignment deleting the current buffer and taking over another.
+         *
+         * @param other The object to move from, left empty.
+         * @return A reference to this object.
+         */
+        EBO& operator=(EBO&& other) noexcept
+        {
+          if (this != &other)
+          {
+            this->Delete();
+            this->ID = std::exchange(other.ID, 0);
+          }
+          return *this;
+        }
 
         /**
          * @brief Gets the ID of the element buffer object.
@@ -167,13 +447,16 @@ namespace kdr
         void Unbind() const
         { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); }
         /**
-         * @brief Deletes the EBO.
+         * @brief Deletes the EBO, leaving the object empty.
          */
-        void Delete() const
-        { glDeleteBuffers(1, &this->ID); }
+        void Delete()
+        {
+          if (this->ID != 0) glDeleteBuffers(1, &this->ID);
+          this->ID = 0;
+        }
 
       private:
-        GLuint ID;
+        GLuint ID {0};
     };
 
     /**
@@ -189,6 +472,37 @@ namespace kdr
          */
         VAO()
         { glGenVertexArrays(1, &this->ID); }
+        /**
+         * @brief Destructor deleting the vertex array.
+         */
+        ~VAO()
+        { this->Delete(); }
+
+        VAO(const VAO&) = delete;
+        VAO& operator=(const VAO&) = delete;
+        /**
+         * @brief Move constructor taking over the vertex array of another object.
+         *
+         * @param other The object to move from, left empty.
+         */
+        VAO(VAO&& other) noexcept
+        : ID(std::exchange(other.ID, 0))
+        {}
+        /**
+         * @brief Move assignment deleting the current vertex array and taking over another.
+         *
+         * @param other The object to move from, left empty.
+         * @return A reference to this object.
+         */
+        VAO& operator=(VAO&& other) noexcept
+        {
+          if (this != &other)
+          {
+            this->Delete();
+            this->ID = std::exchange(other.ID, 0);
+          }
+          return *this;
+        }
 
          /**
          * @brief Gets the ID of the vertex array object.
@@ -209,10 +523,13 @@ namespace kdr
         void Unbind() const
         { glBindVertexArray(0); }
         /**
-         * @brief Deletes the VAO.
+         * @brief Deletes the VAO, leaving the object empty.
          */
-        void Delete() const
-        { glDeleteVertexArrays(1, &this->ID); }
+        void Delete()
+        {
+          if (this->ID != 0) glDeleteVertexArrays(1, &this->ID);
+          this->ID = 0;
+        }
         /**
          * @brief Links a vertex buffer object (VBO) to a layout in the VAO.
          *
@@ -226,7 +543,7 @@ namespace kdr
         void LinkAttrib(const kdr::Graphics::VBO& VBO, GLuint layout, GLuint size, GLenum type, GLsizeiptr stride, const void* offset) const;
 
       private:
-        GLuint ID;
+        GLuint ID {0};
     };
 
     /**
@@ -244,6 +561,58 @@ namespace kdr
          * @param pixelType The pixel type of the texture.
          */
         Texture(const std::string& pngPath, GLenum type, GLenum slot, GLenum pixelType);
+        /**
+         * @brief Constructs a Texture object from decoded image data.
+         * 
+         * @param data The 8-bit RGB or RGBA image data, bottom row first.
+         * @param width The width of the image.
+         * @param height The height of the image.
+         * @param hasAlpha True if the data has an alpha channel, false otherwise.
+         * @param type The type of the texture.
+         * @param slot The texture slot.
+         * @param pixelType The pixel type of the texture.
+         */
+        Texture(const GLubyte* data, const int width, const int height, const bool hasAlpha, GLenum type, GLenum slot, GLenum pixelType);
+        /**
+         * @brief Destructor deleting the texture.
+         */
+        ~Texture()
+        { this->Delete(); }
+
+        Texture(const Texture&) = delete;
+        Texture& operator=(const Texture&) = delete;
+        /**
+         * @brief Move constructor taking over the texture of another object.
+         *
+         * @param other The object to move from, left empty.
+         */
+        Texture(Texture&& other) noexcept
+        : ID(std::exchange(other.ID, 0)), type(other.type)
+        {}
+        /**
+         * @brief Move assignment deleting the current texture and taking over another.
+         *
+         * @param other The object to move from, left empty.
+         * @return A reference to this object.
+         */
+        Texture& operator=(Texture&& other) noexcept
+        {
+          if (this != &other)
+          {
+            this->Delete();
+            this->ID = std::exchange(other.ID, 0);
+            this->type = other.type;
+          }
+          return *this;
+        }
+
+        /**
+         * @brief Gets the type of the texture.
+         * 
+         * @return The texture target, such as GL_TEXTURE_2D.
+         */
+        GLenum getType() const
+        { return this->type; }
 
         /**
          * @brief Binds the texture.
@@ -256,10 +625,13 @@ namespace kdr
         void Unbind() const
         { glBindTexture(this->type, 0); }
         /**
-         * @brief Deletes the texture.
+         * @brief Deletes the texture, leaving the object empty.
          */
-        void Delete() const
-        { glDeleteTextures(1, &this->ID); }
+        void Delete()
+        {
+          if (this->ID != 0) glDeleteTextures(1, &this->ID);
+          this->ID = 0;
+        }
         /**
          * @brief Sets the texture unit in the shader.
          * 
@@ -274,8 +646,20 @@ namespace kdr
         }
 
       private:
-        GLuint ID;
-        GLenum type;
+        GLuint ID   {0};
+        GLenum type {GL_TEXTURE_2D};
+
+        /**
+         * @brief Creates the texture object and uploads image data with mipmaps.
+         * 
+         * @param data The 8-bit RGB or RGBA image data.
+         * @param width The width of the image.
+         * @param height The height of the image.
+         * @param hasAlpha True if the data has an alpha channel, false otherwise.
+         * @param slot The texture slot.
+         * @param pixelType The pixel type of the texture.
+         */
+        void _upload(const GLubyte* data, const int width, const int height, const bool hasAlpha, GLenum slot, GLenum pixelType);
     };
   }
 }
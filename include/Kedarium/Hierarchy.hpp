@@ -0,0 +1,159 @@
+#ifndef KDR_HIERARCHY_HPP
+#define KDR_HIERARCHY_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Entity.hpp"
+#include "Space.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Class holding a forest of transforms in flat arrays sorted breadth-first.
+   *
+   * Nodes are identified by the entity they belong to. Every node precedes its children,
+   * the children of a node are contiguous, and the nodes of one depth form a contiguous
+   * level. Setting the local matrix of a node marks its whole subtree dirty, and update()
+   * recomputes only the dirty world matrices, one level after another. The nodes of a level
+   * only depend on the level above, so large levels are split into jobs.
+   *
+   * Structural changes re-sort the arrays lazily, on the next update() or setLocal(), so
+   * node indices are only valid until the structure changes.
+   */
+  class Hierarchy
+  {
+    public:
+      /**
+       * @brief The index returned for entities without a node.
+       */
+      static constexpr uint32_t INVALID_NODE {UINT32_MAX};
+
+      /**
+       * @brief Default constructor. Creates an empty hierarchy.
+       */
+      Hierarchy()
+      {}
+
+      /**
+       * @brief Attaches an entity to a parent, adding nodes for entities not in the hierarchy.
+       *
+       * The subtree of the entity moves along with it and is marked dirty.
+       *
+       * @param entity The entity.
+       * @param parent The new parent, or kdr::NULL_ENTITY to make the entity a root.
+       * @return True if attached, false if the parent is the entity or one of its descendants.
+       */
+      bool attach(const kdr::Entity entity, const kdr::Entity parent);
+      /**
+       * @brief Removes the node of an entity, attaching its children to its parent.
+       *
+       * @param entity The entity.
+       */
+      void remove(const kdr::Entity entity);
+      /**
+       * @brief Removes all nodes.
+       */
+      void clear();
+
+      /**
+       * @brief Finds the node of an entity.
+       *
+       * @param entity The entity.
+       * @return The index of its node, or INVALID_NODE if the entity is not in the hierarchy.
+       */
+      uint32_t find(const kdr::Entity entity) const;
+      /**
+       * @brief Gets the parent of an entity.
+       *
+       * @param entity The entity.
+       * @return The parent entity, or kdr::NULL_ENTITY for roots and entities without a node.
+       */
+      kdr::Entity getParent(const kdr::Entity entity) const;
+
+      /**
+       * @brief Sets the local matrix of the node of an entity and marks its subtree dirty.
+       *
+       * @param entity The entity, which must be in the hierarchy.
+       * @param local The matrix relative to the parent.
+       */
+      void setLocal(const kdr::Entity entity, const kdr::Space::Mat4& local);
+      /**
+       * @brief Recomputes the dirty world matrices, parents before children.
+       *
+       * @return The number of recomputed world matrices.
+       */
+      size_t update();
+
+      /**
+       * @brief Gets the number of nodes.
+       *
+       * @return The node count.
+       */
+      size_t getCount() const
+      { return this->entities.size(); }
+      /**
+       * @brief Gets the entity of a node.
+       *
+       * @param node The node index.
+       * @return The entity.
+       */
+      kdr::Entity getEntity(const uint32_t node) const
+      { return this->entities[node]; }
+      /**
+       * @brief Gets the world matrix of a node as of the last update().
+       *
+       * @param node The node index.
+       * @return The world matrix.
+       */
+      const kdr::Space::Mat4& getWorld(const uint32_t node) const
+      { return this->worlds[node]; }
+      /**
+       * @brief Checks if the last update() recomputed the world matrix of a node.
+       *
+       * @param node The node index.
+       * @return True if the world matrix changed, false otherwise.
+       */
+      bool wasUpdated(const uint32_t node) const
+      { return this->updated[node] != 0; }
+
+    private:
+      static constexpr size_t PARALLEL_GRAIN {4096};
+
+      std::vector<kdr::Entity>      entities;
+      std::vector<uint32_t>         parents;
+      std::vector<uint32_t>         firstChildren;
+      std::vector<uint32_t>         childCounts;
+      std::vector<kdr::Space::Mat4> locals;
+      std::vector<kdr::Space::Mat4> worlds;
+      std::vector<unsigned char>    dirty;
+      std::vector<unsigned char>    updated;
+      std::vector<uint32_t>         levelStarts;
+      std::vector<uint32_t>         sparse;
+      bool                          sorted {true};
+
+      /**
+       * @brief Adds a root node for an entity if it has none.
+       *
+       * @param entity The entity.
+       * @return The index of its node.
+       */
+      uint32_t _add(const kdr::Entity entity);
+      /**
+       * @brief Sorts the nodes breadth-first and rebuilds the child ranges and levels.
+       *
+       * Dirty nodes mark their subtrees dirty on the way.
+       */
+      void _sort();
+      /**
+       * @brief Recomputes the dirty world matrices of a range of nodes of one level.
+       *
+       * @param begin The first node of the range.
+       * @param end The node after the range.
+       * @return The number of recomputed world matrices.
+       */
+      size_t _updateRange(const uint32_t begin, const uint32_t end);
+  };
+}
+
+#endif // KDR_HIERARCHY_HPP
@@ -0,0 +1,156 @@
+#ifndef KDR_HOT_RELOAD_HPP
+#define KDR_HOT_RELOAD_HPP
+
+#include <GL/glew.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include "Core.hpp"
+#include "Graphics.hpp"
+#include "Image.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Class reloading shaders and textures when their files change on disk.
+   *
+   * A background thread watches a directory tree with inotify, and re-reads shader sources
+   * or decodes PNG files of affected assets. The GPU objects are created on the main thread
+   * by apply() and replace the old ones in place; if a reload fails, the old object is kept.
+   * Only available on Linux.
+   */
+  class HotReloader
+  {
+    public:
+      /**
+       * @brief Default constructor.
+       */
+      HotReloader()
+      {}
+      /**
+       * @brief Destructor stopping the watcher thread.
+       */
+      ~HotReloader()
+      { this->stop(); }
+
+      HotReloader(const HotReloader&) = delete;
+      HotReloader& operator=(const HotReloader&) = delete;
+
+      /**
+       * @brief Starts watching a directory and all of its subdirectories.
+       *
+       * @param directory The directory to watch.
+       * @return True if watching started, false otherwise.
+       */
+      bool start(const std::string& directory);
+      /**
+       * @brief Stops watching for changes.
+       */
+      void stop();
+      /**
+       * @brief Checks if the reloader is watching for changes.
+       *
+       * @return True if watching, false otherwise.
+       */
+      bool getActive() const
+      { return this->thread.joinable(); }
+
+      /**
+       * @brief Registers a shader to reload when its sources or includes change.
+       *
+       * @param name The name of the shader in the shader manager.
+       * @param vertexPath The file path to the vertex shader source code.
+       * @param fragmentPath The file path to the fragment shader source code.
+       * @param defines The preprocessor definitions of the shader.
+       */
+      void watchShader(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines);
+      /**
+       * @brief Registers a texture to reload when its PNG file changes.
+       *
+       * @param name The name of the texture in the texture manager.
+       * @param pngPath The path to the PNG file of the texture.
+       */
+      void watchTexture(const std::string& name, const std::string& pngPath);
+
+      /**
+       * @brief Swaps reloaded objects into the managers. Call on the main thread between frames.
+       *
+       * Recompiled shaders are only swapped in once the driver has finished linking them.
+       *
+       * @param shaders The shader manager holding the registered shaders.
+       * @param textures The texture manager holding the registered textures.
+       * @return The number of objects that were replaced.
+       */
+      size_t apply(kdr::Core::Manager<kdr::Graphics::Shader>& shaders, kdr::Core::Manager<kdr::Graphics::Texture>& textures);
+
+    private:
+      /**
+       * @brief Struct describing a watched shader.
+       */
+      struct ShaderEntry
+      {
+        std::string              vertexPath;
+        std::string              fragmentPath;
+        std::vector<std::string> defines;
+        std::vector<std::string> dependencies;
+      };
+      /**
+       * @brief Struct holding the result of reading a changed asset on the watcher thread.
+       */
+      struct Result
+      {
+        std::string name;
+        bool        shader         {false};
+        std::string vertexSource;
+        std::string fragmentSource;
+        GLubyte*    pixels         {NULL};
+        int         width          {0};
+        int         height         {0};
+        bool        hasAlpha       {false};
+      };
+      /**
+       * @brief Struct representing a recompiled shader waiting for the driver.
+       */
+      struct PendingShader
+      {
+        std::string           name;
+        kdr::Graphics::Shader shader;
+      };
+
+      int                         inotifyFD {-1};
+      int                         wakeFD    {-1};
+      std::map<int, std::string>  watches;
+      std::thread                 thread;
+
+      std::mutex                                 mutex;
+      std::map<std::string, ShaderEntry>         shaderEntries;
+      std::map<std::string, std::string>         textureEntries;
+      std::vector<Result>                        results;
+      std::vector<PendingShader>                 pendingShaders;
+
+      /**
+       * @brief Adds inotify watches for a directory and its subdirectories.
+       *
+       * @param directory The directory to watch.
+       */
+      void _addWatches(const std::string& directory);
+      /**
+       * @brief Reads file events until stopped, reloading the affected assets.
+       */
+      void _run();
+      /**
+       * @brief Reads the assets depending on changed files and queues the results.
+       *
+       * @param changed The canonical paths of the changed files.
+       */
+      void _reload(const std::set<std::string>& changed);
+  };
+}
+
+#endif // KDR_HOT_RELOAD_HPP
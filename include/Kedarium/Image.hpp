@@ -26,6 +26,20 @@ namespace kdr
      * @return True if the image is loaded successfully, false otherwise.
      */
     bool loadFromPNG(const std::string& path, GLubyte** oData, int& oWidth, int& oHeight, bool& oHasAlpha);
+    /**
+     * @brief Saves image data to a PNG file.
+     * 
+     * Rows are expected bottom row first, as returned by loadFromPNG and glReadPixels.
+     * 
+     * @param path The file path to write the PNG image to.
+     * @param data The 8-bit RGB or RGBA image data.
+     * @param width The width of the image.
+     * @param height The height of the image.
+     * @param hasAlpha True if the data has an alpha channel, false otherwise.
+     * @param compressionLevel The zlib compression level from 0 to 9, or -1 for the default.
+     * @return True if the image is saved successfully, false otherwise.
+     */
+    bool saveToPNG(const std::string& path, const GLubyte* data, const int width, const int height, const bool hasAlpha, const int compressionLevel = -1);
   }
 }
 
@@ -0,0 +1,242 @@
+#ifndef KDR_JOBS_HPP
+#define KDR_JOBS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace kdr
+{
+  namespace Core
+  {
+    /**
+     * @brief Record of a scheduled job, defined by the job system.
+     */
+    struct Job;
+
+    /**
+     * @brief Class counting the unfinished jobs of a group.
+     *
+     * A counter is passed to kdr::Core::JobSystem::run() to join the jobs it starts, and as a
+     * dependency to start jobs only once the group is finished. It must outlive its jobs and
+     * any wait() on it.
+     */
+    class JobCounter
+    {
+      public:
+        /**
+         * @brief Default constructor. Creates a counter without jobs.
+         */
+        JobCounter()
+        {}
+
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        /**
+         * @brief Checks if all jobs of the group are finished.
+         *
+         * @return True if no job is pending, false otherwise.
+         */
+        bool isDone() const
+        { return this->pending.load(std::memory_order_acquire) == 0; }
+
+      private:
+        friend class JobSystem;
+
+        std::atomic<int>             pending {0};
+        std::mutex                   mutex;
+        std::vector<kdr::Core::Job*> continuations;
+    };
+
+    /**
+     * @brief Class running jobs on a pool of worker threads that steal work from each other.
+     *
+     * Every worker, and the thread that created the system, owns a lock-free Chase-Lev deque.
+     * A thread pushes and pops its own jobs at the bottom, most recent first, while idle
+     * workers steal the oldest jobs from the top of the others. Workers sleep when no job is
+     * queued anywhere. Waiting on a counter runs other jobs instead of blocking.
+     *
+     * Jobs started by threads outside the system, or when the deque or job storage of a
+     * thread is full, run immediately on the calling thread.
+     */
+    class JobSystem
+    {
+      public:
+        /**
+         * @brief Constructs a job system owned by the calling thread.
+         *
+         * @param workerCount The number of worker threads, by default one less than the hardware threads.
+         */
+        explicit JobSystem(const unsigned int workerCount = JobSystem::getDefaultWorkerCount());
+        /**
+         * @brief Destructor stopping and joining the workers. Jobs must be finished first.
+         */
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        /**
+         * @brief Gets the default number of worker threads.
+         *
+         * @return One less than the number of hardware threads.
+         */
+        static unsigned int getDefaultWorkerCount()
+        { return std::max(1u, std::thread::hardware_concurrency()) - 1; }
+
+        /**
+         * @brief Starts a job.
+         *
+         * @param function The function to run.
+         * @param counter The counter to add the job to, or NULL.
+         * @param dependency A counter whose jobs must finish before this one starts, or NULL.
+         */
+        void run(std::function<void()> function, kdr::Core::JobCounter* counter = NULL, kdr::Core::JobCounter* dependency = NULL);
+        /**
+         * @brief Starts a long job that only an idle worker thread picks up.
+         *
+         * The job goes to a shared queue instead of a deque, so waits on the calling thread,
+         * including those inside parallelFor(), never run it in their place. Without worker
+         * threads it runs immediately on the calling thread.
+         *
+         * @param function The function to run.
+         * @param counter The counter to add the job to, or NULL.
+         */
+        void runOnWorker(std::function<void()> function, kdr::Core::JobCounter* counter = NULL);
+        /**
+         * @brief Runs jobs until all jobs of a counter are finished.
+         *
+         * @param counter The counter to wait for.
+         */
+        void wait(kdr::Core::JobCounter& counter);
+        /**
+         * @brief Splits a range into chunks run as jobs and waits for all of them.
+         *
+         * The calling thread runs the first chunk itself. Chunks share no state, so results
+         * have to be written per index or combined atomically.
+         *
+         * @tparam F The function type, callable with the begin and end of a chunk.
+         * @param count The size of the range.
+         * @param grain The size of each chunk, except possibly the last.
+         * @param function The function run on each chunk.
+         */
+        template <typename F>
+        void parallelFor(const size_t count, const size_t grain, const F& function)
+        {
+          const size_t chunkCount = grain == 0 ? 1 : (count + grain - 1) / grain;
+          if (chunkCount < 2 || this->workers.size() < 2)
+          {
+            function((size_t)0, count);
+            return;
+          }
+
+          // Jobs capture only the chunk and this closure, so they fit in std::function inline.
+          const auto runChunk = [&function, count, grain](const size_t chunk)
+          {
+            function(chunk * grain, std::min(count, (chunk + 1) * grain));
+          };
+          kdr::Core::JobCounter counter;
+          for (size_t chunk = chunkCount - 1; chunk > 0; chunk--)
+          {
+            this->run([&runChunk, chunk]() { runChunk(chunk); }, &counter);
+          }
+          runChunk(0);
+          this->wait(counter);
+        }
+
+        /**
+         * @brief Gets the number of worker threads.
+         *
+         * @return The worker count, not counting the owning thread.
+         */
+        unsigned int getWorkerCount() const
+        { return this->workers.size() - 1; }
+
+      private:
+        struct Worker;
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<int>                     queuedCount   {0};
+        std::atomic<int>                     sleepingCount {0};
+        std::atomic<bool>                    stopping      {false};
+        std::mutex                           sleepMutex;
+        std::condition_variable              wakeUp;
+
+        std::mutex                                                           workerJobsMutex;
+        std::deque<std::pair<std::function<void()>, kdr::Core::JobCounter*>> workerJobs;
+
+        /**
+         * @brief Gets the worker of the calling thread.
+         *
+         * @return A pointer to the worker, or NULL for threads outside the system.
+         */
+        Worker* _getCurrentWorker();
+        /**
+         * @brief Queues a job on a worker, or runs it if the worker is NULL or its deque is full.
+         *
+         * @param worker The worker of the calling thread, or NULL.
+         * @param job The job.
+         */
+        void _schedule(Worker* worker, kdr::Core::Job* job);
+        /**
+         * @brief Wakes a sleeping worker after a job was queued.
+         */
+        void _wakeWorker();
+        /**
+         * @brief Runs a job of the shared queue started by runOnWorker(), if there is one.
+         *
+         * @param worker The worker of the calling thread.
+         * @return True if a job was run, false if the queue was empty.
+         */
+        bool _runWorkerJob(Worker* worker);
+        /**
+         * @brief Takes a queued job, popping the worker's own deque before stealing from the others.
+         *
+         * @param worker The worker of the calling thread, or NULL to only steal.
+         * @return A pointer to the job, or NULL if none was found.
+         */
+        kdr::Core::Job* _findJob(Worker* worker);
+        /**
+         * @brief Runs a job, frees its storage and finishes it on its counter.
+         *
+         * @param worker The worker of the calling thread, or NULL.
+         * @param job The job.
+         */
+        void _execute(Worker* worker, kdr::Core::Job* job);
+        /**
+         * @brief Removes a finished job from a counter, scheduling the jobs waiting on it once it reaches zero.
+         *
+         * @param worker The worker of the calling thread, or NULL.
+         * @param counter The counter, or NULL.
+         */
+        void _finish(Worker* worker, kdr::Core::JobCounter* counter);
+        /**
+         * @brief Runs the loop of a worker thread.
+         *
+         * @param index The index of the worker.
+         */
+        void _work(const unsigned int index);
+    };
+
+    /**
+     * @brief Gets the job system shared by the engine.
+     *
+     * It is created by the first call, and owned by the thread making it, which should be
+     * the main thread.
+     *
+     * @return A reference to the job system.
+     */
+    kdr::Core::JobSystem& getJobSystem();
+  }
+}
+
+#endif // KDR_JOBS_HPP
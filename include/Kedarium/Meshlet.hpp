@@ -0,0 +1,157 @@
+#ifndef KDR_MESHLET_HPP
+#define KDR_MESHLET_HPP
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "SIMD.hpp"
+#include "Space.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Namespace containing the decomposition of meshes into small clusters of triangles.
+   */
+  namespace Meshlet
+  {
+    /**
+     * @brief The largest number of vertices referenced by a cluster.
+     */
+    constexpr GLuint MAX_VERTICES {64};
+    /**
+     * @brief The largest number of triangles in a cluster.
+     */
+    constexpr GLuint MAX_TRIANGLES {124};
+
+    /**
+     * @brief Struct describing a cluster as a range of a triangle list, in model space.
+     *
+     * The normal cone bounds the triangle normals. A cone cutoff of one disables back-face
+     * rejection, for clusters whose normals spread over more than a hemisphere.
+     */
+    struct Cluster
+    {
+      GLuint              firstIndex {0};
+      GLuint              indexCount {0};
+      kdr::Bounds::Sphere sphere;
+      kdr::Space::Vec3    coneAxis   {0.f};
+      float               coneCutoff {1.f};
+    };
+
+    /**
+     * @brief Splits a triangle list into clusters and reorders it so each cluster is a range.
+     *
+     * Clusters grow over neighbouring triangles, preferring those that add the fewest
+     * vertices and lie closest to the cluster, so they are compact with narrow normal cones.
+     *
+     * @param vertices The vertices, with the position in the first three floats.
+     * @param stride The number of floats per vertex.
+     * @param ioIndices The triangle list, reordered in place.
+     * @param indexCount The number of indices.
+     * @return The clusters, with index ranges relative to the start of the list.
+     */
+    std::vector<kdr::Meshlet::Cluster> build(const GLfloat* vertices, const size_t stride, GLuint* ioIndices, const size_t indexCount);
+
+    /**
+     * @brief Class holding the clusters of a mesh and culling them against a view.
+     *
+     * The bounds are kept as structures of arrays so four clusters are tested at a time with
+     * SSE, and large sets are split into jobs.
+     */
+    class ClusterSet
+    {
+      public:
+        /**
+         * @brief Default constructor. Creates an empty set.
+         */
+        ClusterSet()
+        {}
+
+        /**
+         * @brief Builds the clusters of a triangle list and keeps a copy of its indices.
+         *
+         * @param vertices The vertices, with the position in the first three floats.
+         * @param stride The number of floats per vertex.
+         * @param ioIndices The triangle list, reordered in place into cluster order.
+         * @param indexCount The number of indices.
+         */
+        void build(const GLfloat* vertices, const size_t stride, GLuint* ioIndices, const size_t indexCount);
+        /**
+         * @brief Removes all clusters.
+         */
+        void clear();
+
+        /**
+         * @brief Tests every cluster against a frustum and its normal cone against the camera.
+         *
+         * @param frustum The frustum in the model space of the clusters.
+         * @param cameraPosition The camera position in the model space of the clusters.
+         * @param oVisible Output array receiving 1 for every visible cluster and 0 otherwise.
+         * @return The number of visible clusters.
+         */
+        size_t cull(const kdr::Bounds::Frustum& frustum, const kdr::Space::Vec3& cameraPosition, unsigned char* oVisible) const;
+        /**
+         * @brief Writes the indices of the visible clusters one after another.
+         *
+         * Neighbouring visible clusters are copied with a single copy.
+         *
+         * @param visible The visibility of every cluster, as written by cull().
+         * @param oIndices Output array with room for all indices of the visible clusters.
+         * @return The number of indices written.
+         */
+        size_t compact(const unsigned char* visible, GLuint* oIndices) const;
+        /**
+         * @brief Counts the indices of the visible clusters.
+         *
+         * @param visible The visibility of every cluster, as written by cull().
+         * @return The number of indices compact() will write.
+         */
+        size_t countIndices(const unsigned char* visible) const;
+
+        /**
+         * @brief Gets the number of clusters.
+         *
+         * @return The cluster count.
+         */
+        size_t getCount() const
+        { return this->clusters.size(); }
+        /**
+         * @brief Gets the clusters.
+         *
+         * @return The clusters, in the order of the triangle list.
+         */
+        const std::vector<kdr::Meshlet::Cluster>& getClusters() const
+        { return this->clusters; }
+
+      private:
+        static constexpr size_t PARALLEL_GRAIN {2048};
+
+        std::vector<kdr::Meshlet::Cluster> clusters;
+        std::vector<GLuint>                indices;
+
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> radius;
+        std::vector<float> axisX;
+        std::vector<float> axisY;
+        std::vector<float> axisZ;
+        std::vector<float> cutoff;
+
+        /**
+         * @brief Culls a range of clusters.
+         *
+         * @param frustum The frustum in model space.
+         * @param cameraPosition The camera position in model space.
+         * @param begin The first cluster of the range.
+         * @param end The cluster after the range.
+         * @param oVisible Output array receiving the visibility of all clusters.
+         * @return The number of visible clusters in the range.
+         */
+        size_t _cullRange(const kdr::Bounds::Frustum& frustum, const kdr::Space::Vec3& cameraPosition, const size_t begin, const size_t end, unsigned char* oVisible) const;
+    };
+  }
+}
+
+#endif // KDR_MESHLET_HPP
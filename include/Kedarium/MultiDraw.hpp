@@ -0,0 +1,121 @@
+#ifndef KDR_MULTI_DRAW_HPP
+#define KDR_MULTI_DRAW_HPP
+
+#include <GL/glew.h>
+#include <iostream>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Solids.hpp"
+#include "Stream.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Struct matching the layout of an indirect indexed draw command.
+   */
+  struct DrawElementsIndirectCommand
+  {
+    GLuint count         {0};
+    GLuint instanceCount {0};
+    GLuint firstIndex    {0};
+    GLint  baseVertex    {0};
+    GLuint baseInstance  {0};
+  };
+
+  /**
+   * @brief Class drawing many solids of the solid arena with a single indirect draw call.
+   *
+   * Every added solid becomes one indirect draw command and one entry of a shader storage
+   * block holding its model matrix and position decoding, both written into the per-frame
+   * stream buffer. Each command draws one instance whose base instance is the index of its
+   * entry, and an instanced attribute at location 4 turns it into the draw ID, so the vertex
+   * shader reads draws[aDrawID] (see indirect.vert).
+   * Requires OpenGL 4.3 or the equivalent extensions.
+   */
+  class MultiDraw
+  {
+    public:
+      /**
+       * @brief Default constructor.
+       */
+      MultiDraw()
+      {}
+      /**
+       * @brief Destructor deleting the draw ID buffer.
+       */
+      ~MultiDraw()
+      { this->Delete(); }
+
+      MultiDraw(const MultiDraw&) = delete;
+      MultiDraw& operator=(const MultiDraw&) = delete;
+
+      /**
+       * @brief Checks if the context supports indirect multi-draws with storage buffers.
+       *
+       * @return True if supported, false otherwise.
+       */
+      static bool isSupported();
+
+      /**
+       * @brief Queues a solid for the next submit.
+       *
+       * @param solid The solid to draw.
+       */
+      void add(const kdr::Solids::Solid& solid);
+      /**
+       * @brief Queues a range of a mesh of the solid arena for the next submit.
+       *
+       * @param mesh The mesh in the solid arena.
+       * @param firstIndex The first index of the range, relative to the mesh.
+       * @param indexCount The number of indices to draw.
+       * @param model The model matrix.
+       * @param positionOffset The offset added to decoded positions.
+       * @param positionScale The scale applied to decoded positions.
+       */
+      void add(const GLuint mesh, const GLuint firstIndex, const GLuint indexCount, const kdr::Space::Mat4& model, const kdr::Space::Vec3& positionOffset, const kdr::Space::Vec3& positionScale);
+      /**
+       * @brief Writes the queued draws and issues them with one glMultiDrawElementsIndirect.
+       *
+       * The queue is cleared afterwards. The bound shader must read its model matrices from
+       * the storage buffer at binding 0.
+       *
+       * @param stream The stream buffer of the current frame.
+       * @return The number of draws issued.
+       */
+      size_t submit(kdr::StreamBuffer& stream);
+      /**
+       * @brief Gets the number of queued draws.
+       *
+       * @return The number of draws.
+       */
+      size_t getDrawCount() const
+      { return this->commands.size(); }
+      /**
+       * @brief Deletes the draw ID buffer.
+       */
+      void Delete();
+
+    private:
+      /**
+       * @brief Struct matching the std430 layout of an entry in the draw buffer.
+       */
+      struct DrawData
+      {
+        GLfloat model[16];
+        GLfloat positionOffset[4];
+        GLfloat positionScale[4];
+      };
+
+      static constexpr GLuint DRAW_ID_LOCATION    {4};
+      static constexpr GLuint DRAW_BUFFER_BINDING {0};
+
+      std::vector<kdr::DrawElementsIndirectCommand> commands;
+      std::vector<DrawData>                         draws;
+
+      GLuint drawIDBuffer {0};
+      GLuint drawIDCount  {0};
+  };
+}
+
+#endif // KDR_MULTI_DRAW_HPP
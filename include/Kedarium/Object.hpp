@@ -17,9 +17,20 @@ namespace kdr
    */
   namespace Object
   {
+    /**
+     * @brief Struct describing a level of detail of a mesh as a range of its indices.
+     */
+    struct Lod
+    {
+      GLuint firstIndex {0};
+      GLuint indexCount {0};
+      float  error      {0.f}; ///< Estimated distance to the full mesh in model units.
+    };
+
     /**
      * @brief Loads vertex and index data from an OBJ file.
-     * 
+     *
+     * Face corners with the same position, texture coordinates and normal share a vertex.
      * @param objPath The path to the OBJ file to load.
      * @param oVertices Vector to store the loaded vertex data.
      * @param oVerticesSize Variable to store the size of the loaded vertex data in bytes.
@@ -29,6 +40,38 @@ namespace kdr
      * @return True if the loading is successful, false otherwise.
      */
     bool loadFromObj(const std::string& objPath, std::vector<GLfloat>& oVertices, GLsizeiptr& oVerticesSize, std::vector<GLuint>& oIndices, GLsizeiptr& oIndicesSize, const kdr::Space::Vec3& dimensions = {0.f, 0.f, 0.f});
+    /**
+     * @brief Loads an OBJ file, optimizes it and generates its levels of detail.
+     *
+     * The full mesh is optimized for the vertex cache, overdraw and vertex fetch, then
+     * simplified to half its triangles per level while that keeps working. Each level has a
+     * strictly larger error than the one before, a coarser level with the same error replacing
+     * the finer one. All levels share the vertices, and their indices follow each other in
+     * oIndices, full detail first.
+     * If a mesh cache directory is set, the result is stored there as a binary .kmesh file
+     * keyed by the OBJ contents and dimensions, and later loads read it directly.
+     *
+     * @param objPath The path to the OBJ file to load.
+     * @param oVertices Vector to store the vertex data, 11 floats per vertex.
+     * @param oIndices Vector to store the index data of all levels.
+     * @param oLods Vector to store the levels of detail, from full detail to coarsest.
+     * @param dimensions The dimensions of the mesh in 3D space, extracted from the OBJ file if not provided.
+     * @return True if the loading is successful, false otherwise.
+     */
+    bool loadMesh(const std::string& objPath, std::vector<GLfloat>& oVertices, std::vector<GLuint>& oIndices, std::vector<kdr::Object::Lod>& oLods, const kdr::Space::Vec3& dimensions = {0.f, 0.f, 0.f});
+
+    /**
+     * @brief Sets the directory optimized meshes are cached in. Empty disables the cache.
+     *
+     * @param directory The cache directory.
+     */
+    void setMeshCacheDirectory(const std::string& directory);
+    /**
+     * @brief Gets the directory optimized meshes are cached in.
+     *
+     * @return The cache directory, or an empty string if disabled.
+     */
+    const std::string& getMeshCacheDirectory();
   }
 }
 
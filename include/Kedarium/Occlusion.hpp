@@ -0,0 +1,258 @@
+#ifndef KDR_OCCLUSION_HPP
+#define KDR_OCCLUSION_HPP
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "Camera.hpp"
+#include "Graphics.hpp"
+#include "SIMD.hpp"
+#include "Space.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Class rasterizing occluders into a low resolution depth buffer on the CPU.
+   *
+   * Occluder triangles are transformed and binned into screen tiles, then every tile is
+   * rasterized four pixels at a time with SSE, one job per tile for large occluder sets.
+   * Each tile also keeps the farthest depth of its 8x8 pixel blocks, and bounding boxes
+   * are tested against those blocks, so occluded solids are skipped without reading back
+   * anything from the GPU.
+   *
+   * Coverage is sampled at pixel centers, so an object peeking past the silhouette of an
+   * occluder by less than a buffer pixel may be reported as occluded.
+   */
+  class OcclusionBuffer
+  {
+    public:
+      /**
+       * @brief The width of the depth buffer in pixels.
+       */
+      static constexpr int WIDTH {256};
+      /**
+       * @brief The height of the depth buffer in pixels.
+       */
+      static constexpr int HEIGHT {128};
+      /**
+       * @brief The width and height of the blocks of the hierarchical depth buffer.
+       */
+      static constexpr int BLOCK_SIZE {8};
+
+      /**
+       * @brief Default constructor. Creates a buffer with no occluders.
+       */
+      OcclusionBuffer();
+
+      /**
+       * @brief Removes all occluders and sets the view of the next frame.
+       *
+       * @param viewProjection The camera matrix, projection times view.
+       */
+      void clear(const kdr::Space::Mat4& viewProjection);
+      /**
+       * @brief Transforms the triangles of an occluder and bins them into tiles.
+       *
+       * Back-facing triangles and triangles crossing the near plane are dropped, which only
+       * makes the buffer less occluding.
+       *
+       * @param positions The positions of the occluder, three floats per vertex in model space.
+       * @param vertexCount The number of vertices.
+       * @param indices The triangle list of the occluder.
+       * @param indexCount The number of indices.
+       * @param model The model matrix of the occluder.
+       */
+      void addOccluder(const GLfloat* positions, const size_t vertexCount, const GLuint* indices, const size_t indexCount, const kdr::Space::Mat4& model);
+      /**
+       * @brief Rasterizes the binned occluders and builds the hierarchical depth buffer.
+       */
+      void render();
+
+      /**
+       * @brief Tests whether a box may be visible past the rendered occluders.
+       *
+       * Boxes crossing the near plane or outside the screen are always reported visible.
+       *
+       * @param box The box in world space.
+       * @return True if the box may be visible, false if it is fully occluded.
+       */
+      bool testAABB(const kdr::Bounds::AABB& box) const;
+
+      /**
+       * @brief Gets the number of occluder triangles binned since the last clear.
+       *
+       * @return The triangle count.
+       */
+      size_t getTriangleCount() const
+      { return this->triangles.size(); }
+      /**
+       * @brief Gets the depth buffer, row by row from the bottom of the screen.
+       *
+       * @return The depths, from zero at the near plane to one at the far plane.
+       */
+      const float* getDepth() const
+      { return this->depth.data(); }
+
+    private:
+      static constexpr int    TILE_WIDTH         {64};
+      static constexpr int    TILE_HEIGHT        {32};
+      static constexpr int    TILES_X            {WIDTH / TILE_WIDTH};
+      static constexpr int    TILES_Y            {HEIGHT / TILE_HEIGHT};
+      static constexpr int    BLOCKS_X           {WIDTH / BLOCK_SIZE};
+      static constexpr int    BLOCKS_Y           {HEIGHT / BLOCK_SIZE};
+      static constexpr size_t PARALLEL_THRESHOLD {256};
+
+      /**
+       * @brief Struct holding a triangle set up for rasterization.
+       *
+       * Each edge function is edgeA * x + edgeB * y + edgeC, positive inside, and the depth is
+       * the plane depthA * x + depthB * y + depthC, raised to its farthest value in a pixel.
+       */
+      struct Triangle
+      {
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        float depthA;
+        float depthB;
+        float depthC;
+        int   minX;
+        int   minY;
+        int   maxX;
+        int   maxY;
+      };
+
+      kdr::Space::Mat4 viewProjection {1.f};
+
+      std::vector<float>                 clipVertices;
+      std::vector<Triangle>              triangles;
+      std::vector<std::vector<uint32_t>> bins;
+      std::vector<float>                 depth;
+      std::vector<float>                 blockDepth;
+
+      /**
+       * @brief Rasterizes the triangles binned into a tile and updates the depth of its blocks.
+       *
+       * @param tile The index of the tile, row by row.
+       */
+      void _renderTile(const int tile);
+  };
+
+  /**
+   * @brief Class testing the bounding boxes of expensive solids with GPU occlusion queries.
+   *
+   * Before a solid is drawn, its world bounding box is rasterized without color or depth
+   * writes inside an any-samples-passed query (the conservative variant when supported),
+   * and the solid is drawn inside a conditional render on that query. Each solid owns a
+   * ring of queries, and results are read a few frames late once the driver reports them
+   * available, so the CPU never waits. A solid whose last result was occluded makes the GPU
+   * wait for its new box query, and is skipped without popping when it stays occluded;
+   * other solids are drawn unless the result happens to be ready in time.
+   */
+  class OcclusionQueries
+  {
+    public:
+      /**
+       * @brief The number of triangles from which a draw is worth a query.
+       */
+      static constexpr GLuint MIN_TRIANGLES {1024};
+
+      /**
+       * @brief Default constructor. The GL objects are created on first use.
+       */
+      OcclusionQueries()
+      {}
+      /**
+       * @brief Destructor deleting the GL objects.
+       */
+      ~OcclusionQueries()
+      { this->Delete(); }
+
+      OcclusionQueries(const OcclusionQueries&) = delete;
+      OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+      /**
+       * @brief Starts a frame, resetting the counters and releasing queries of solids no longer drawn.
+       */
+      void beginFrame();
+      /**
+       * @brief Issues the box query of a solid and begins a conditional render on it.
+       *
+       * Binds its own program, so the caller must bind its shader again before drawing.
+       * No query is issued when the camera is inside the box, since the box could be clipped
+       * by the near plane.
+       *
+       * @param key The identifier of the drawn object, never reused by another, such as kdr::Solids::Solid::getSerial().
+       * @param box The bounding box in world space.
+       * @param camera The camera, with its matrix updated for the frame.
+       * @return True if a conditional render was begun and end() must follow the draw, false otherwise.
+       */
+      bool begin(const uint64_t key, const kdr::Bounds::AABB& box, const kdr::Camera& camera);
+      /**
+       * @brief Ends the conditional render begun by begin().
+       */
+      void end()
+      { glEndConditionalRender(); }
+
+      /**
+       * @brief Gets the number of queries issued this frame.
+       *
+       * @return The query count.
+       */
+      size_t getQueryCount() const
+      { return this->queryCount; }
+      /**
+       * @brief Gets the number of queried draws this frame whose last known result was occluded.
+       *
+       * @return The number of draws expected to be skipped by the GPU.
+       */
+      size_t getOccludedCount() const
+      { return this->occludedCount; }
+      /**
+       * @brief Deletes the queries, the box geometry and its program.
+       */
+      void Delete();
+
+    private:
+      static constexpr size_t FRAME_COUNT   {3};
+      static constexpr size_t UNUSED_FRAMES {60};
+
+      /**
+       * @brief Struct holding the query ring of one solid.
+       */
+      struct Entry
+      {
+        GLuint queries[FRAME_COUNT] {};
+        bool   pending[FRAME_COUNT] {};
+        bool   occluded  {false};
+        size_t lastFrame {0};
+      };
+
+      std::unordered_map<uint64_t, Entry> entries;
+      size_t                              frame         {0};
+      size_t                              queryCount    {0};
+      size_t                              occludedCount {0};
+
+      std::unique_ptr<kdr::Graphics::Shader> boxShader;
+      GLuint                                 boxVertexArray  {0};
+      GLuint                                 boxVertexBuffer {0};
+      GLuint                                 boxIndexBuffer  {0};
+      GLenum                                 target          {GL_ANY_SAMPLES_PASSED};
+      GLint                                  cameraLocation  {-1};
+      GLint                                  boxMinLocation  {-1};
+      GLint                                  boxMaxLocation  {-1};
+
+      /**
+       * @brief Creates the box geometry and program if they do not exist yet.
+       *
+       * @return True if the box program is usable, false otherwise.
+       */
+      bool _initialize();
+  };
+}
+
+#endif // KDR_OCCLUSION_HPP
@@ -0,0 +1,104 @@
+#ifndef KDR_OPTIMIZE_HPP
+#define KDR_OPTIMIZE_HPP
+
+#include <GL/glew.h>
+#include <vector>
+
+namespace kdr
+{
+  /**
+   * @brief Namespace containing offline optimizations of indexed triangle meshes.
+   *
+   * The passes are meant to run in order: vertex cache, overdraw, then vertex fetch.
+   * optimizeMesh() runs all three, and simplify() builds levels of detail. Vertices are
+   * arrays of floats with the position in the first three.
+   */
+  namespace Optimize
+  {
+    /**
+     * @brief Struct holding the post-transform vertex cache efficiency of an index buffer.
+     */
+    struct CacheStats
+    {
+      float acmr {0.f}; ///< Average cache miss ratio, vertex shader invocations per triangle. At best about 0.5.
+      float atvr {0.f}; ///< Average transform to vertex ratio, invocations per referenced vertex. At best 1.
+    };
+
+    /**
+     * @brief The FIFO cache size used when simulating the post-transform cache.
+     */
+    constexpr unsigned int SIMULATED_CACHE_SIZE {16};
+
+    /**
+     * @brief Simulates a FIFO post-transform cache over an index buffer.
+     *
+     * @param indices The triangle list.
+     * @param vertexCount The number of vertices the indices refer to.
+     * @param cacheSize The number of cache entries.
+     * @return The cache efficiency.
+     */
+    kdr::Optimize::CacheStats analyzeVertexCache(const std::vector<GLuint>& indices, const size_t vertexCount, const unsigned int cacheSize = SIMULATED_CACHE_SIZE);
+
+    /**
+     * @brief Reorders triangles for the post-transform vertex cache with Forsyth's algorithm.
+     *
+     * Triangles are scored by the cache position and remaining valence of their vertices, and
+     * the best triangle touching the simulated cache is emitted next.
+     *
+     * @param ioIndices The triangle list, reordered in place.
+     * @param vertexCount The number of vertices the indices refer to.
+     */
+    void optimizeVertexCache(std::vector<GLuint>& ioIndices, const size_t vertexCount);
+    /**
+     * @brief Reorders clusters of a cache-optimized triangle list to reduce overdraw.
+     *
+     * The list is split where the cache would be cold anyway, and where splitting raises the
+     * ACMR of a cluster by at most the threshold. Clusters facing away from the mesh center
+     * are drawn first, since they tend to occlude the rest.
+     *
+     * @param ioIndices The triangle list, reordered in place.
+     * @param vertices The vertices, with the position in the first three floats.
+     * @param vertexCount The number of vertices.
+     * @param stride The number of floats per vertex.
+     * @param threshold The allowed ACMR increase, such as 1.05 for 5%.
+     */
+    void optimizeOverdraw(std::vector<GLuint>& ioIndices, const GLfloat* vertices, const size_t vertexCount, const size_t stride, const float threshold = 1.05f);
+    /**
+     * @brief Reorders vertices in the order the indices first use them, and drops unused ones.
+     *
+     * @param ioVertices The vertices, reordered in place.
+     * @param stride The number of floats per vertex.
+     * @param ioIndices The triangle list, remapped in place.
+     */
+    void optimizeVertexFetch(std::vector<GLfloat>& ioVertices, const size_t stride, std::vector<GLuint>& ioIndices);
+
+    /**
+     * @brief Simplifies a triangle list with quadric error metric edge collapses.
+     *
+     * Vertices are only collapsed onto existing vertices, so the result indexes the same
+     * vertex buffer. Vertices sharing a position are collapsed together, which keeps texture
+     * and normal seams intact, and open borders only collapse along themselves.
+     *
+     * @param vertices The vertices, with the position in the first three floats.
+     * @param vertexCount The number of vertices.
+     * @param stride The number of floats per vertex.
+     * @param indices The triangle list to simplify.
+     * @param targetIndexCount The number of indices to reduce to.
+     * @param maxError The largest error allowed, in model units.
+     * @param oIndices Output parameter receiving the simplified triangle list.
+     * @return The error of the result, an estimate of its distance to the source in model units.
+     */
+    float simplify(const GLfloat* vertices, const size_t vertexCount, const size_t stride, const std::vector<GLuint>& indices, const size_t targetIndexCount, const float maxError, std::vector<GLuint>& oIndices);
+
+    /**
+     * @brief Runs the vertex cache, overdraw and vertex fetch passes in order.
+     *
+     * @param ioVertices The vertices, reordered in place.
+     * @param stride The number of floats per vertex.
+     * @param ioIndices The triangle list, reordered in place.
+     */
+    void optimizeMesh(std::vector<GLfloat>& ioVertices, const size_t stride, std::vector<GLuint>& ioIndices);
+  }
+}
+
+#endif // KDR_OPTIMIZE_HPP
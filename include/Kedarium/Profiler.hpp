@@ -0,0 +1,258 @@
+#ifndef KDR_PROFILER_HPP
+#define KDR_PROFILER_HPP
+
+#include <GL/glew.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <string>
+
+namespace kdr
+{
+  /**
+   * @brief Struct holding rolling frame time statistics in milliseconds.
+   */
+  struct FrameStats
+  {
+    size_t frameCount {0};
+    double average    {0.0};
+    double minimum    {0.0};
+    double maximum    {0.0};
+    double p50        {0.0};
+    double p95        {0.0};
+    double p99        {0.0};
+  };
+
+  /**
+   * @brief Class measuring frame times and named CPU and GPU scopes.
+   *
+   * GPU scopes use pairs of GL_TIMESTAMP queries from a ring of frames, so their results
+   * are read a few frames later without waiting on the GPU, and scopes may be nested.
+   *
+   * The profiler is not thread-safe. Scopes begun on other threads than the one that
+   * created it are ignored, so jobs may use them without racing the frame.
+   */
+  class Profiler
+  {
+    public:
+      /**
+       * @brief Class timing a CPU (and optionally GPU) scope for its lifetime.
+       */
+      class Scope
+      {
+        public:
+          /**
+           * @brief Begins a scope.
+           *
+           * @param profiler The profiler recording the scope.
+           * @param name The name of the scope.
+           * @param gpu True to also time the GPU work issued inside the scope.
+           */
+          Scope(kdr::Profiler& profiler, const std::string& name, const bool gpu = false)
+          : profiler(profiler), gpu(gpu)
+          {
+            this->profiler.beginScope(name);
+            if (this->gpu) this->profiler.beginGpuScope(name);
+          }
+          /**
+           * @brief Ends the scope.
+           */
+          ~Scope()
+          {
+            if (this->gpu) this->profiler.endGpuScope();
+            this->profiler.endScope();
+          }
+
+          Scope(const Scope&) = delete;
+          Scope& operator=(const Scope&) = delete;
+
+        private:
+          kdr::Profiler& profiler;
+          bool           gpu;
+      };
+
+      /**
+       * @brief Constructs a profiler.
+       *
+       * @param historySize The number of frames kept for the rolling statistics.
+       */
+      Profiler(const size_t historySize = 300)
+      : historySize(historySize), epoch(std::chrono::steady_clock::now()), ownerThread(std::this_thread::get_id())
+      {}
+
+      /**
+       * @brief Marks the start of a frame.
+       */
+      void beginFrame();
+      /**
+       * @brief Marks the end of a frame and records its duration.
+       */
+      void endFrame();
+      /**
+       * @brief Begins a named CPU scope.
+       *
+       * @param name The name of the scope.
+       */
+      void beginScope(const std::string& name);
+      /**
+       * @brief Ends the most recently begun CPU scope.
+       */
+      void endScope();
+      /**
+       * @brief Begins a named GPU scope, nested in the GPU scopes already active.
+       *
+       * @param name The name of the scope.
+       */
+      void beginGpuScope(const std::string& name);
+      /**
+       * @brief Ends the most recently begun GPU scope.
+       */
+      void endGpuScope();
+
+      /**
+       * @brief Discards the recorded frame times.
+       */
+      void reset()
+      {
+        this->frameTimes.clear();
+        this->frameCursor = 0;
+      }
+
+      /**
+       * @brief Gets the rolling frame time statistics.
+       *
+       * @return The statistics over the recorded frame history.
+       */
+      kdr::FrameStats getFrameStats() const;
+      /**
+       * @brief Gets the CPU duration of a scope in the last completed frame.
+       *
+       * @param name The name of the scope.
+       * @return The duration in milliseconds, or zero if the scope was not recorded.
+       */
+      double getScopeMilliseconds(const std::string& name) const;
+      /**
+       * @brief Gets the latest resolved GPU duration of a scope.
+       *
+       * @param name The name of the scope.
+       * @return The duration in milliseconds, or zero if no result is available yet.
+       */
+      double getGpuScopeMilliseconds(const std::string& name) const;
+
+      /**
+       * @brief Enables or disables recording of scopes for trace export.
+       *
+       * @param capturing True to record every scope, false to stop recording.
+       */
+      void setCapturing(const bool capturing)
+      { this->capturing = capturing; }
+      /**
+       * @brief Checks if scopes are being recorded for trace export.
+       *
+       * @return True if capturing, false otherwise.
+       */
+      bool getCapturing() const
+      { return this->capturing; }
+      /**
+       * @brief Discards all recorded trace events.
+       */
+      void clearCapture()
+      { this->events.clear(); }
+      /**
+       * @brief Writes the recorded scopes as a Chrome trace-event JSON file.
+       *
+       * CPU scopes appear on thread 0 and GPU scopes on thread 1, placed at the CPU time
+       * their commands were issued.
+       *
+       * @param path The path of the JSON file to write.
+       * @return True if the file was written successfully, false otherwise.
+       */
+      bool exportChromeTrace(const std::string& path) const;
+
+      /**
+       * @brief Deletes the GPU query objects. Must be called while the context is current.
+       */
+      void Delete();
+
+    private:
+      /**
+       * @brief Struct representing a timed scope.
+       */
+      struct Event
+      {
+        std::string name;
+        double      start    {0.0};
+        double      duration {0.0};
+        int         depth    {0};
+        bool        gpu      {false};
+      };
+      /**
+       * @brief Struct representing a pending pair of GPU timestamp queries.
+       */
+      struct GpuQuery
+      {
+        GLuint      beginID {0};
+        GLuint      endID   {0};
+        std::string name;
+        double      start   {0.0};
+        int         depth   {0};
+        bool        ended   {false};
+      };
+      /**
+       * @brief Struct holding the GPU queries issued during one frame.
+       */
+      struct GpuFrame
+      {
+        std::vector<GpuQuery> queries;
+        size_t                used   {0};
+        GLuint                lastID {0};
+      };
+
+      static constexpr size_t GPU_FRAME_COUNT {4};
+
+      size_t                                historySize {300};
+      std::chrono::steady_clock::time_point epoch;
+      std::thread::id                       ownerThread;
+
+      std::vector<double> frameTimes;
+      size_t              frameCursor {0};
+      double              frameStart  {0.0};
+
+      std::vector<Event>  openScopes;
+      std::vector<Event>  frameScopes;
+      std::vector<Event>  lastFrameScopes;
+      std::vector<Event>  gpuResults;
+      std::vector<Event>  events;
+      bool                capturing {false};
+
+      GpuFrame gpuFrames[GPU_FRAME_COUNT];
+      size_t   gpuFrameIndex {0};
+
+      std::vector<size_t> openGpuScopes;
+
+      /**
+       * @brief Gets the time since the profiler was created.
+       *
+       * @return The elapsed time in microseconds.
+       */
+      double now() const
+      { return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - this->epoch).count(); }
+      /**
+       * @brief Reads the results of a ring slot's queries if they are all available.
+       *
+       * @param frame The ring slot to resolve.
+       */
+      void resolveGpuFrame(GpuFrame& frame);
+      /**
+       * @brief Checks if the calling thread is the one that created the profiler.
+       *
+       * @return True if scopes from the calling thread are recorded, false otherwise.
+       */
+      bool isOwnerThread() const
+      { return std::this_thread::get_id() == this->ownerThread; }
+  };
+}
+
+#endif // KDR_PROFILER_HPP
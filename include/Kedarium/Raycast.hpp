@@ -0,0 +1,159 @@
+#ifndef KDR_RAYCAST_HPP
+#define KDR_RAYCAST_HPP
+
+#include <vector>
+
+#include "Bounds.hpp"
+#include "BVH.hpp"
+#include "SIMD.hpp"
+
+namespace kdr
+{
+  namespace Solids
+  {
+    class Solid;
+  }
+
+  /**
+   * @brief Namespace containing ray queries against triangle meshes and scenes.
+   */
+  namespace Raycast
+  {
+    /**
+     * @brief Struct describing the closest hit of a ray query.
+     */
+    struct Hit
+    {
+      const kdr::Solids::Solid* solid    {NULL};
+      unsigned int              triangle {0};
+      float                     distance {FLT_MAX};
+    };
+
+    /**
+     * @brief Class representing a static bounding volume hierarchy over the triangles of a mesh.
+     *
+     * Leaves hold up to four triangles stored as a structure of arrays, so a ray is tested
+     * against a whole leaf at once with SSE when available.
+     */
+    class TriangleBVH
+    {
+      public:
+        /**
+         * @brief Builds the hierarchy from indexed triangles.
+         *
+         * @param vertices The interleaved vertex data, starting with the position of the first vertex.
+         * @param stride The number of floats between consecutive vertices.
+         * @param indices The triangle indices, three per triangle.
+         * @param indexCount The number of indices.
+         */
+        void build(const float* vertices, const size_t stride, const unsigned int* indices, const size_t indexCount);
+        /**
+         * @brief Finds the closest triangle hit by a ray.
+         *
+         * @param ray The ray in the mesh's model space.
+         * @param maxDistance The maximum distance along the ray.
+         * @param oDistance Output parameter receiving the distance of the hit.
+         * @param oTriangle Output parameter receiving the index of the hit triangle.
+         * @return True if a triangle was hit within the maximum distance, false otherwise.
+         */
+        bool intersect(const kdr::Bounds::Ray& ray, const float maxDistance, float& oDistance, unsigned int& oTriangle) const;
+
+        /**
+         * @brief Gets the number of triangles in the hierarchy.
+         *
+         * @return The number of triangles.
+         */
+        size_t getTriangleCount() const
+        { return this->triangleCount; }
+        /**
+         * @brief Gets the number of nodes in the hierarchy.
+         *
+         * @return The number of nodes.
+         */
+        size_t getNodeCount() const
+        { return this->nodes.size(); }
+
+      private:
+        /**
+         * @brief Struct representing a node; leaves reference one packet, inner nodes two adjacent children.
+         */
+        struct Node
+        {
+          kdr::Bounds::AABB box;
+          unsigned int      first {0};
+          bool              leaf  {false};
+        };
+        /**
+         * @brief Struct holding up to four triangles as one vertex and two edges per lane.
+         */
+        struct alignas(16) Packet
+        {
+          float        v0[3][kdr::SIMD::WIDTH];
+          float        edge1[3][kdr::SIMD::WIDTH];
+          float        edge2[3][kdr::SIMD::WIDTH];
+          unsigned int triangles[kdr::SIMD::WIDTH];
+        };
+        /**
+         * @brief Struct holding the build-time data of one triangle.
+         */
+        struct Reference
+        {
+          kdr::Bounds::AABB box;
+          kdr::Space::Vec3  centroid;
+          unsigned int      triangle;
+        };
+
+        std::vector<Node>   nodes;
+        std::vector<Packet> packets;
+        size_t              triangleCount {0};
+
+        /**
+         * @brief Recursively builds the subtree over a range of triangle references.
+         *
+         * @param nodeIndex The index of the already allocated node to fill.
+         * @param references The triangle references, reordered in place.
+         * @param begin The first reference of the range.
+         * @param end One past the last reference of the range.
+         * @param vertices The interleaved vertex data.
+         * @param stride The number of floats between consecutive vertices.
+         * @param indices The triangle indices.
+         */
+        void buildNode(const unsigned int nodeIndex, std::vector<Reference>& references, const size_t begin, const size_t end, const float* vertices, const size_t stride, const unsigned int* indices);
+        /**
+         * @brief Tests a ray against the triangles of a packet.
+         *
+         * @param packet The packet to test.
+         * @param ray The ray to test.
+         * @param ioDistance The current maximum distance, shortened on a closer hit.
+         * @param oTriangle Output parameter receiving the index of the closer triangle.
+         * @return True if a closer triangle was hit, false otherwise.
+         */
+        static bool intersectPacket(const Packet& packet, const kdr::Bounds::Ray& ray, float& ioDistance, unsigned int& oTriangle);
+    };
+
+    /**
+     * @brief Casts a ray against the solids stored in a hierarchy.
+     *
+     * The user data of every object in the hierarchy must point to a kdr::Solids::Solid.
+     *
+     * @param scene The hierarchy containing the solids.
+     * @param ray The ray in world space.
+     * @param maxDistance The maximum distance along the ray.
+     * @param oHit Output parameter receiving the closest hit.
+     * @return True if a solid was hit, false otherwise.
+     */
+    bool castRay(const kdr::BVH& scene, const kdr::Bounds::Ray& ray, const float maxDistance, kdr::Raycast::Hit& oHit);
+    /**
+     * @brief Casts a ray against a list of solids.
+     *
+     * @param solids The solids to test.
+     * @param ray The ray in world space.
+     * @param maxDistance The maximum distance along the ray.
+     * @param oHit Output parameter receiving the closest hit.
+     * @return True if a solid was hit, false otherwise.
+     */
+    bool castRay(const std::vector<const kdr::Solids::Solid*>& solids, const kdr::Bounds::Ray& ray, const float maxDistance, kdr::Raycast::Hit& oHit);
+  }
+}
+
+#endif // KDR_RAYCAST_HPP
@@ -0,0 +1,29 @@
+#ifndef KDR_SIMD_HPP
+#define KDR_SIMD_HPP
+
+/**
+ * @brief Defined when SSE intrinsics are available for the target.
+ *
+ * Every SSE code path in the engine has a scalar fallback for other targets.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define KDR_SIMD_SSE
+  #include <xmmintrin.h>
+  #include <emmintrin.h>
+#endif
+
+namespace kdr
+{
+  /**
+   * @brief Namespace containing SIMD-related constants.
+   */
+  namespace SIMD
+  {
+    /**
+     * @brief The number of floats processed by a single SIMD lane group.
+     */
+    constexpr unsigned int WIDTH {4};
+  }
+}
+
+#endif // KDR_SIMD_HPP
@@ -0,0 +1,494 @@
+#ifndef KDR_SCENE_HPP
+#define KDR_SCENE_HPP
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Bounds.hpp"
+#include "Entity.hpp"
+#include "Graphics.hpp"
+#include "Hierarchy.hpp"
+#include "Lights.hpp"
+#include "Solids.hpp"
+#include "Space.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Class storing one component type of many entities as a sparse set.
+   *
+   * Components are packed in a dense array, so systems iterate them as a linear loop, while
+   * a sparse array indexed by entity slot finds the component of a given entity in constant
+   * time. Removal moves the last component into the hole, so the order is not stable.
+   *
+   * @tparam T The component type.
+   */
+  template <typename T>
+  class ComponentPool
+  {
+    public:
+      /**
+       * @brief Adds a component to an entity, or replaces the one it has.
+       *
+       * @param entity The entity.
+       * @param component The component.
+       * @return A reference to the stored component, valid until the pool changes size.
+       */
+      T& add(const kdr::Entity entity, const T& component)
+      {
+        const uint32_t slot = entity & kdr::ENTITY_SLOT_MASK;
+        if (slot >= this->sparse.size())
+        {
+          this->sparse.resize(slot + 1, INVALID_INDEX);
+        }
+        if (this->has(entity))
+        {
+          return this->components[this->sparse[slot]] = component;
+        }
+        this->sparse[slot] = this->entities.size();
+        this->entities.push_back(entity);
+        this->components.push_back(component);
+        return this->components.back();
+      }
+      /**
+       * @brief Removes the component of an entity, if it has one.
+       *
+       * @param entity The entity.
+       */
+      void remove(const kdr::Entity entity)
+      {
+        if (!this->has(entity))
+        {
+          return;
+        }
+        const uint32_t index = this->sparse[entity & kdr::ENTITY_SLOT_MASK];
+        const kdr::Entity last = this->entities.back();
+        if (last != entity)
+        {
+          this->entities[index] = last;
+          this->components[index] = std::move(this->components.back());
+          this->sparse[last & kdr::ENTITY_SLOT_MASK] = index;
+        }
+        this->sparse[entity & kdr::ENTITY_SLOT_MASK] = INVALID_INDEX;
+        this->entities.pop_back();
+        this->components.pop_back();
+      }
+      /**
+       * @brief Removes all components.
+       */
+      void clear()
+      {
+        this->sparse.clear();
+        this->entities.clear();
+        this->components.clear();
+      }
+
+      /**
+       * @brief Checks if an entity has a component in the pool.
+       *
+       * @param entity The entity.
+       * @return True if the entity has a component, false otherwise.
+       */
+      bool has(const kdr::Entity entity) const
+      {
+        const uint32_t slot = entity & kdr::ENTITY_SLOT_MASK;
+        return slot < this->sparse.size() && this->sparse[slot] != INVALID_INDEX && this->entities[this->sparse[slot]] == entity;
+      }
+      /**
+       * @brief Gets the component of an entity.
+       *
+       * @param entity The entity.
+       * @return A pointer to the component, or NULL if the entity has none.
+       */
+      T* get(const kdr::Entity entity)
+      { return this->has(entity) ? &this->components[this->sparse[entity & kdr::ENTITY_SLOT_MASK]] : NULL; }
+      /**
+       * @brief Gets the component of an entity.
+       *
+       * @param entity The entity.
+       * @return A pointer to the component, or NULL if the entity has none.
+       */
+      const T* get(const kdr::Entity entity) const
+      { return this->has(entity) ? &this->components[this->sparse[entity & kdr::ENTITY_SLOT_MASK]] : NULL; }
+
+      /**
+       * @brief Gets the number of components.
+       *
+       * @return The component count.
+       */
+      size_t getCount() const
+      { return this->components.size(); }
+      /**
+       * @brief Gets the entities owning the components, in the order of the dense array.
+       *
+       * @return The entities.
+       */
+      const std::vector<kdr::Entity>& getEntities() const
+      { return this->entities; }
+      /**
+       * @brief Gets the dense array of components.
+       *
+       * @return The components, in the order of getEntities().
+       */
+      std::vector<T>& getComponents()
+      { return this->components; }
+      /**
+       * @brief Gets the dense array of components.
+       *
+       * @return The components, in the order of getEntities().
+       */
+      const std::vector<T>& getComponents() const
+      { return this->components; }
+
+    private:
+      static constexpr uint32_t INVALID_INDEX {UINT32_MAX};
+
+      std::vector<uint32_t>    sparse;
+      std::vector<kdr::Entity> entities;
+      std::vector<T>           components;
+  };
+
+  /**
+   * @brief Namespace containing the component types of a scene.
+   */
+  namespace Components
+  {
+    /**
+     * @brief Struct holding the placement of an entity.
+     *
+     * The local matrix is translation times rotation (Y, then X, then Z, in degrees) times
+     * scale, relative to the parent set with kdr::Scene::setParent(), if any. The world matrix
+     * is recomputed by kdr::Scene::updateTransforms() when dirty is set, which must be done
+     * after changing the position, rotation or scale, and follows the changes of the parents.
+     */
+    struct Transform
+    {
+      kdr::Space::Vec3 position {0.f};
+      kdr::Space::Vec3 rotation {0.f};
+      kdr::Space::Vec3 scale    {1.f};
+      kdr::Space::Mat4 world    {1.f};
+      bool             dirty    {true};
+    };
+
+    /**
+     * @brief Struct holding the bounding box of an entity in model space.
+     *
+     * The world-space box is kept apart, see kdr::Scene::getWorldBounds(), so culling walks
+     * a dense array of nothing but world boxes.
+     */
+    struct Bounds
+    {
+      kdr::Bounds::AABB local;
+    };
+
+    /**
+     * @brief The bounding box of an entity in world space.
+     */
+    using WorldBounds = kdr::Bounds::AABB;
+
+    /**
+     * @brief Struct referring to a range of a mesh of the solid arena.
+     *
+     * The mesh is not owned, and must outlive the component.
+     */
+    struct Mesh
+    {
+      GLuint           mesh           {kdr::MeshArena::INVALID_MESH};
+      GLuint           firstIndex     {0};
+      GLuint           indexCount     {0};
+      kdr::Space::Vec3 positionOffset {0.f};
+      kdr::Space::Vec3 positionScale  {1.f};
+    };
+
+    /**
+     * @brief Struct holding the surface of an entity.
+     *
+     * The texture is not owned, and must outlive the component.
+     */
+    struct Material
+    {
+      const kdr::Graphics::Texture* texture {NULL};
+    };
+
+    /**
+     * @brief A light, as used by kdr::Window::useLights().
+     */
+    using Light = kdr::Lights::Light;
+  }
+
+  /**
+   * @brief Class storing entities and their components in one pool per component type.
+   *
+   * Entities are plain identifiers without behaviour. The systems of the scene, such as
+   * updateTransforms() and cull(), and the submission in kdr::Window::renderScene(), each
+   * walk the dense arrays of the pools they need.
+   */
+  class Scene
+  {
+    public:
+      /**
+       * @brief Default constructor. Creates an empty scene.
+       */
+      Scene()
+      {}
+
+      /**
+       * @brief Creates an entity without components.
+       *
+       * @return The new entity.
+       */
+      kdr::Entity create();
+      /**
+       * @brief Creates an entity drawing a mesh of a solid, placed at a position.
+       *
+       * The entity gets a transform, bounds, a mesh referring to the full detail of the solid
+       * and a material. The solid acts as a prototype shared by any number of entities, and
+       * must outlive them.
+       *
+       * @param prototype The solid whose mesh is drawn.
+       * @param position The position of the entity.
+       * @param texture The texture of the entity, or NULL to keep the bound texture.
+       * @return The new entity.
+       */
+      kdr::Entity createMesh(const kdr::Solids::Solid& prototype, const kdr::Space::Vec3& position, const kdr::Graphics::Texture* texture = NULL);
+      /**
+       * @brief Destroys an entity and removes all its components.
+       *
+       * Its children are attached to its parent, their transforms rewritten to keep them in place.
+       *
+       * @param entity The entity to destroy.
+       */
+      void destroy(const kdr::Entity entity);
+      /**
+       * @brief Checks if an entity exists.
+       *
+       * @param entity The entity.
+       * @return True if the entity was created and not destroyed, false otherwise.
+       */
+      bool isAlive(const kdr::Entity entity) const;
+      /**
+       * @brief Gets the number of entities.
+       *
+       * @return The entity count.
+       */
+      size_t getEntityCount() const
+      { return this->slots.size() - this->freeSlots.size(); }
+
+      /**
+       * @brief Sets the parent of an entity, whose transform becomes relative to it.
+       *
+       * @param child The entity to attach, which must have a transform.
+       * @param parent The new parent, or kdr::NULL_ENTITY to detach the entity.
+       * @return True if set, false if an entity is not alive or the parent is a descendant of the child.
+       */
+      bool setParent(const kdr::Entity child, const kdr::Entity parent);
+      /**
+       * @brief Gets the parent of an entity.
+       *
+       * @param entity The entity.
+       * @return The parent, or kdr::NULL_ENTITY if the entity has none.
+       */
+      kdr::Entity getParent(const kdr::Entity entity) const
+      { return this->hierarchy.getParent(entity); }
+      /**
+       * @brief Gets the transform hierarchy.
+       *
+       * @return A reference to the hierarchy.
+       */
+      const kdr::Hierarchy& getHierarchy() const
+      { return this->hierarchy; }
+
+      /**
+       * @brief Recomputes the world matrices of dirty transforms and the world bounds they move.
+       *
+       * Entities with a parent or children are updated through the hierarchy, so a change to
+       * a parent also moves its descendants.
+       */
+      void updateTransforms();
+      /**
+       * @brief Collects the entities with a mesh whose world bounds intersect a frustum.
+       *
+       * @param frustum The frustum to test against, or NULL to collect every entity with a mesh.
+       * @param oVisible Output vector receiving the visible entities, cleared first.
+       */
+      void cull(const kdr::Bounds::Frustum* frustum, std::vector<kdr::Entity>& oVisible) const;
+      /**
+       * @brief Sorts entities by texture and then by mesh, so neighbouring draws share state.
+       *
+       * @param ioEntities The entities to sort, all with a mesh.
+       */
+      void sortDraws(std::vector<kdr::Entity>& ioEntities) const;
+
+      /**
+       * @brief Gets the transform pool.
+       *
+       * @return A reference to the pool.
+       */
+      kdr::ComponentPool<kdr::Components::Transform>& getTransforms()
+      { return this->transforms; }
+      /**
+       * @brief Gets the transform pool.
+       *
+       * @return A reference to the pool.
+       */
+      const kdr::ComponentPool<kdr::Components::Transform>& getTransforms() const
+      { return this->transforms; }
+      /**
+       * @brief Gets the bounds pool.
+       *
+       * @return A reference to the pool.
+       */
+      kdr::ComponentPool<kdr::Components::Bounds>& getBounds()
+      { return this->bounds; }
+      /**
+       * @brief Gets the bounds pool.
+       *
+       * @return A reference to the pool.
+       */
+      const kdr::ComponentPool<kdr::Components::Bounds>& getBounds() const
+      { return this->bounds; }
+      /**
+       * @brief Gets the world bounds pool.
+       *
+       * updateTransforms() adds the world box of an entity with bounds when its transform
+       * changes, and destroy() removes it.
+       *
+       * @return A reference to the pool.
+       */
+      const kdr::ComponentPool<kdr::Components::WorldBounds>& getWorldBounds() const
+      { return this->worldBounds; }
+      /**
+       * @brief Gets the mesh pool.
+       *
+       * @return A reference to the pool.
+       */
+      kdr::ComponentPool<kdr::Components::Mesh>& getMeshes()
+      { return this->meshes; }
+      /**
+       * @brief Gets the mesh pool.
+       *
+       * @return A reference to the pool.
+       */
+      const kdr::ComponentPool<kdr::Components::Mesh>& getMeshes() const
+      { return this->meshes; }
+      /**
+       * @brief Gets the material pool.
+       *
+       * @return A reference to the pool.
+       */
+      kdr::ComponentPool<kdr::Components::Material>& getMaterials()
+      { return this->materials; }
+      /**
+       * @brief Gets the material pool.
+       *
+       * @return A reference to the pool.
+       */
+      const kdr::ComponentPool<kdr::Components::Material>& getMaterials() const
+      { return this->materials; }
+      /**
+       * @brief Gets the light pool.
+       *
+       * @return A reference to the pool.
+       */
+      kdr::ComponentPool<kdr::Components::Light>& getLights()
+      { return this->lights; }
+      /**
+       * @brief Gets the light pool.
+       *
+       * @return A reference to the pool.
+       */
+      const kdr::ComponentPool<kdr::Components::Light>& getLights() const
+      { return this->lights; }
+
+    private:
+      std::vector<uint32_t> slots;
+      std::vector<uint32_t> freeSlots;
+
+      kdr::ComponentPool<kdr::Components::Transform>   transforms;
+      kdr::ComponentPool<kdr::Components::Bounds>      bounds;
+      kdr::ComponentPool<kdr::Components::WorldBounds> worldBounds;
+      kdr::ComponentPool<kdr::Components::Mesh>        meshes;
+      kdr::ComponentPool<kdr::Components::Material>    materials;
+      kdr::ComponentPool<kdr::Components::Light>       lights;
+      kdr::Hierarchy                                   hierarchy;
+
+      mutable std::vector<unsigned char> cullVisibility;
+  };
+
+  /**
+   * @brief Class holding a copy of the state of a scene that rendering reads.
+   *
+   * Only the world matrices and world bounds of the entities with a mesh, and the lights,
+   * are copied. Meshes and materials are read from the scene itself, so they must not change
+   * while the snapshot is rendered, and the scene must outlive it.
+   */
+  class SceneSnapshot
+  {
+    public:
+      /**
+       * @brief Default constructor. Creates an empty snapshot of no scene.
+       */
+      SceneSnapshot()
+      {}
+
+      /**
+       * @brief Copies the current state of a scene, whose transforms must be up to date.
+       *
+       * @param scene The scene.
+       */
+      void capture(const kdr::Scene& scene);
+      /**
+       * @brief Empties the snapshot, leaving it without a scene.
+       */
+      void clear();
+      /**
+       * @brief Collects the entities with a mesh whose captured world bounds intersect a frustum.
+       *
+       * @param frustum The frustum to test against, or NULL to collect every entity with a mesh.
+       * @param oVisible Output vector receiving the visible entities, cleared first.
+       */
+      void cull(const kdr::Bounds::Frustum* frustum, std::vector<kdr::Entity>& oVisible) const;
+
+      /**
+       * @brief Gets the captured scene.
+       *
+       * @return A pointer to the scene, or NULL if nothing was captured.
+       */
+      const kdr::Scene* getScene() const
+      { return this->scene; }
+      /**
+       * @brief Gets the world matrices of the entities with a mesh.
+       *
+       * @return A reference to the pool.
+       */
+      const kdr::ComponentPool<kdr::Space::Mat4>& getWorlds() const
+      { return this->worlds; }
+      /**
+       * @brief Gets the world bounds of the entities with a mesh.
+       *
+       * @return A reference to the pool.
+       */
+      const kdr::ComponentPool<kdr::Components::WorldBounds>& getWorldBounds() const
+      { return this->worldBounds; }
+      /**
+       * @brief Gets the lights.
+       *
+       * @return A reference to the pool.
+       */
+      const kdr::ComponentPool<kdr::Components::Light>& getLights() const
+      { return this->lights; }
+
+    private:
+      const kdr::Scene*                                scene {NULL};
+      kdr::ComponentPool<kdr::Space::Mat4>             worlds;
+      kdr::ComponentPool<kdr::Components::WorldBounds> worldBounds;
+      kdr::ComponentPool<kdr::Components::Light>       lights;
+
+      mutable std::vector<unsigned char> cullVisibility;
+  };
+}
+
+#endif // KDR_SCENE_HPP
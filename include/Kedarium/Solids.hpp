@@ -2,12 +2,18 @@
 #define KDR_SOLIDS_HPP
 
 #include <GL/glew.h>
+#include <cstdint>
 #include <vector>
 #include <string>
 
+#include "Arena.hpp"
+#include "Vertex.hpp"
 #include "Graphics.hpp"
 #include "Space.hpp"
 #include "Object.hpp"
+#include "Bounds.hpp"
+#include "Meshlet.hpp"
+#include "Raycast.hpp"
 
 namespace kdr
 {
@@ -34,18 +40,13 @@ namespace kdr
         /**
          * @brief Destructor for the solid object.
          * 
-         * Cleans up allocated resources.
+         * Releases the mesh of the solid in the solid arena.
          */
         virtual ~Solid()
-        {
-          this->VAO->Delete();
-          this->VBO->Delete();
-          this->EBO->Delete();
+        { kdr::MeshArena::getSolidArena().remove(this->mesh); }
 
-          delete this->VAO;
-          delete this->VBO;
-          delete this->EBO;
-        }
+        Solid(const Solid&) = delete;
+        Solid& operator=(const Solid&) = delete;
 
         /**
          * @brief Translates the solid object by the given vector.
@@ -55,6 +56,7 @@ namespace kdr
         void translate(const kdr::Space::Vec3& vec)
         {
           this->position += vec;
+          this->updateWorldBounds();
         }
         /**
          * @brief Rotates the solid object around the X-axis by the given angle.
@@ -62,21 +64,147 @@ namespace kdr
          * @param degrees The angle of rotation in degrees.
          */
         void rotateX(const float degrees)
-        { this->model = kdr::Space::rotate(this->model, degrees, {1.f, 0.f, 0.f}); }
+        {
+          this->model = kdr::Space::rotate(this->model, degrees, {1.f, 0.f, 0.f});
+          this->updateWorldBounds();
+        }
         /**
          * @brief Rotates the solid object around the Y-axis by the given angle.
          * 
          * @param degrees The angle of rotation in degrees.
          */
         void rotateY(const float degrees)
-        { this->model = kdr::Space::rotate(this->model, degrees, {0.f, 1.f, 0.f}); }
+        {
+          this->model = kdr::Space::rotate(this->model, degrees, {0.f, 1.f, 0.f});
+          this->updateWorldBounds();
+        }
         /**
          * @brief Rotates the solid object around the Z-axis by the given angle.
          * 
          * @param degrees The angle of rotation in degrees.
          */
         void rotateZ(const float degrees)
-        { this->model = kdr::Space::rotate(this->model, degrees, {0.f, 0.f, 1.f}); }
+        {
+          this->model = kdr::Space::rotate(this->model, degrees, {0.f, 0.f, 1.f});
+          this->updateWorldBounds();
+        }
+
+        /**
+         * @brief Gets the position of the solid object.
+         *
+         * @return The position of the solid object.
+         */
+        kdr::Space::Vec3 getPosition() const
+        { return this->position; }
+        /**
+         * @brief Gets the model matrix including the translation to the solid's position.
+         *
+         * @return The model matrix of the solid object.
+         */
+        kdr::Space::Mat4 getModelMatrix() const
+        { return kdr::Space::translate(this->model, this->position); }
+        /**
+         * @brief Gets the bounding box of the solid in model space.
+         *
+         * @return The model-space bounding box.
+         */
+        const kdr::Bounds::AABB& getLocalBounds() const
+        { return this->localBounds; }
+        /**
+         * @brief Gets the bounding box of the solid in world space.
+         *
+         * @return The world-space bounding box.
+         */
+        const kdr::Bounds::AABB& getWorldBounds() const
+        { return this->worldBounds; }
+        /**
+         * @brief Gets the serial number of the solid.
+         *
+         * Unlike its address, the serial number is never given to a solid created later.
+         *
+         * @return The serial number, unique among all solids.
+         */
+        uint64_t getSerial() const
+        { return this->serial; }
+        /**
+         * @brief Gets the bounding sphere of the solid in world space.
+         *
+         * @return The world-space bounding sphere.
+         */
+        const kdr::Bounds::Sphere& getWorldSphere() const
+        { return this->worldSphere; }
+
+        /**
+         * @brief Gets the handle of the solid's mesh in the solid arena.
+         *
+         * @return The mesh handle, or kdr::MeshArena::INVALID_MESH if no mesh was uploaded.
+         */
+        GLuint getMesh() const
+        { return this->mesh; }
+        /**
+         * @brief Gets the levels of detail of the solid's mesh.
+         *
+         * @return The levels of detail, from full detail to coarsest.
+         */
+        const std::vector<kdr::Object::Lod>& getLods() const
+        { return this->lods; }
+        /**
+         * @brief Gets the level of detail drawn by render().
+         *
+         * @return The index of the selected level of detail.
+         */
+        GLuint getSelectedLod() const
+        { return this->selectedLod; }
+        /**
+         * @brief Gets the clusters of the full detail level, used to cull parts of dense meshes.
+         *
+         * @return The clusters, empty for meshes too small to benefit.
+         */
+        const kdr::Meshlet::ClusterSet& getClusters() const
+        { return this->clusters; }
+        /**
+         * @brief Selects the coarsest level of detail whose error stays below a number of pixels.
+         *
+         * The error of a level is projected at the distance of the nearest point of the world
+         * bounding sphere. The selection is a per-draw cache, so it can be made on const solids.
+         *
+         * @param viewPosition The position of the camera.
+         * @param pixelsPerUnit The screen height in pixels over twice the tangent of half the field of view.
+         * @param maxPixelError The largest projected error allowed, in pixels. Zero or less selects full detail.
+         * @return The index of the selected level of detail.
+         */
+        GLuint selectLod(const kdr::Space::Vec3& viewPosition, const float pixelsPerUnit, const float maxPixelError) const;
+        /**
+         * @brief Gets the triangle hierarchy of the solid in model space.
+         *
+         * @return The triangle hierarchy used for ray queries.
+         */
+        const kdr::Raycast::TriangleBVH& getTriangles() const
+        { return this->triangles; }
+        /**
+         * @brief Gets the positions of the occluder geometry of the solid in model space.
+         *
+         * @return Three floats per vertex, empty for solids too dense to be occluders.
+         */
+        const std::vector<GLfloat>& getOccluderPositions() const
+        { return this->occluderPositions; }
+        /**
+         * @brief Gets the triangle list of the occluder geometry of the solid.
+         *
+         * @return The indices into the occluder positions, empty for solids too dense to be occluders.
+         */
+        const std::vector<GLuint>& getOccluderIndices() const
+        { return this->occluderIndices; }
+
+        /**
+         * @brief Intersects a world-space ray with the triangles of the solid.
+         *
+         * @param ray The ray in world space.
+         * @param maxDistance The maximum distance along the ray.
+         * @param oHit Output parameter receiving the hit, with the distance in world units.
+         * @return True if the solid was hit within the maximum distance, false otherwise.
+         */
+        bool intersectRay(const kdr::Bounds::Ray& ray, const float maxDistance, kdr::Raycast::Hit& oHit) const;
 
         /**
          * @brief Applies the model matrix to the shader program.
@@ -86,10 +214,40 @@ namespace kdr
          */
         void applyModelMatrix(const GLuint shaderID, const std::string& uniform) const
         {
-          kdr::Space::Mat4 usedMatrix = kdr::Space::translate(this->model, this->position);
+          kdr::Space::Mat4 usedMatrix = this->getModelMatrix();
           GLuint modelLoc = glGetUniformLocation(shaderID, uniform.c_str());
           glUniformMatrix4fv(modelLoc, 1, GL_FALSE, kdr::Space::valuePointer(usedMatrix));
         }
+        /**
+         * @brief Applies the decoding of quantized positions to the shader program.
+         *
+         * Only needed when the solid format quantizes positions (see kdr::Vertex::Format).
+         *
+         * @param shaderID The ID of the shader program.
+         * @param offsetUniform The name of the uniform receiving the position offset.
+         * @param scaleUniform The name of the uniform receiving the position scale.
+         */
+        void applyPositionDecoding(const GLuint shaderID, const std::string& offsetUniform, const std::string& scaleUniform) const
+        {
+          GLuint offsetLoc = glGetUniformLocation(shaderID, offsetUniform.c_str());
+          GLuint scaleLoc = glGetUniformLocation(shaderID, scaleUniform.c_str());
+          glUniform3f(offsetLoc, this->positionOffset.x, this->positionOffset.y, this->positionOffset.z);
+          glUniform3f(scaleLoc, this->positionScale.x, this->positionScale.y, this->positionScale.z);
+        }
+        /**
+         * @brief Gets the offset added to decoded vertex positions.
+         *
+         * @return The position offset, zero unless positions are quantized.
+         */
+        kdr::Space::Vec3 getPositionOffset() const
+        { return this->positionOffset; }
+        /**
+         * @brief Gets the scale applied to decoded vertex positions.
+         *
+         * @return The position scale, one unless positions are quantized.
+         */
+        kdr::Space::Vec3 getPositionScale() const
+        { return this->positionScale; }
         /**
          * @brief Renders the solid object.
          * 
@@ -98,26 +256,64 @@ namespace kdr
         virtual void render() const = 0;
 
       protected:
-        kdr::Graphics::VAO* VAO {NULL};
-        kdr::Graphics::VBO* VBO {NULL};
-        kdr::Graphics::EBO* EBO {NULL};
-
         /**
          * @brief Initializes the member objects of the solid with provided vertex and index data.
          * 
-         * This function initializes the vertex array object (VAO), vertex buffer object (VBO), and element buffer object (EBO)
-         * with the provided vertex and index data.
+         * This function encodes the vertex data in the solid format, uploads it with the index
+         * data into the shared solid arena and builds the bounds and triangle hierarchy.
          * 
          * @param vertices An array containing the vertex data.
          * @param verticesSize The size of the vertex data array in bytes.
          * @param indices An array containing the index data.
          * @param indicesSize The size of the index data array in bytes.
+         * @param lods The levels of detail as ranges of the indices, or empty if all indices are full detail.
          */
-        void initializeMembers(GLfloat* vertices, GLsizeiptr verticesSize, GLuint* indices, GLsizeiptr indicesSize);
+        void initializeMembers(GLfloat* vertices, GLsizeiptr verticesSize, GLuint* indices, GLsizeiptr indicesSize, const std::vector<kdr::Object::Lod>& lods = {});
+        /**
+         * @brief Draws the selected level of detail of the solid from the solid arena.
+         */
+        void drawMesh() const
+        {
+          if (this->selectedLod < this->lods.size())
+          {
+            const kdr::Object::Lod& lod = this->lods[this->selectedLod];
+            kdr::MeshArena::getSolidArena().draw(this->mesh, lod.firstIndex, lod.indexCount);
+          }
+        }
 
       private:
+        uint64_t         serial         {Solid::_nextSerial()};
+        GLuint           mesh           {kdr::MeshArena::INVALID_MESH};
+        kdr::Space::Vec3 positionOffset {0.f};
+        kdr::Space::Vec3 positionScale  {1.f};
+
+        std::vector<kdr::Object::Lod> lods;
+        mutable GLuint                selectedLod {0};
+        kdr::Meshlet::ClusterSet      clusters;
+
         kdr::Space::Vec3 position {0.f};
         kdr::Space::Mat4 model    {1.f};
+
+        kdr::Bounds::AABB   localBounds;
+        kdr::Bounds::AABB   worldBounds;
+        kdr::Bounds::Sphere localSphere;
+        kdr::Bounds::Sphere worldSphere;
+
+        kdr::Raycast::TriangleBVH triangles;
+
+        std::vector<GLfloat> occluderPositions;
+        std::vector<GLuint>  occluderIndices;
+
+        /**
+         * @brief Recomputes the world-space bounds from the model-space bounds and the current transform.
+         */
+        void updateWorldBounds();
+        /**
+         * @brief Takes the next serial number, from any thread.
+         *
+         * @return The serial number.
+         */
+        static uint64_t _nextSerial();
     };
 
     /**
@@ -225,9 +421,6 @@ namespace kdr
          * @brief Renders the mesh.
          */
         void render() const;
-
-      private:
-        unsigned int indexCount {0};
     };
   }
 }
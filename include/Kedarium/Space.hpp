@@ -475,6 +475,13 @@ namespace kdr
      * @return The view matrix.
      */
     kdr::Space::Mat4 lookAt(const kdr::Space::Vec3& eye, const kdr::Space::Vec3& target, const kdr::Space::Vec3& up);
+    /**
+     * @brief Computes the inverse of a 4x4 matrix.
+     * 
+     * @param mat The matrix to invert.
+     * @return The inverse matrix, or the identity matrix if the matrix is singular.
+     */
+    kdr::Space::Mat4 inverse(const kdr::Space::Mat4& mat);
 
     /**
      * @brief Returns a pointer to the underlying array storing the elements of a 4x4 matrix.
@@ -0,0 +1,143 @@
+#ifndef KDR_STREAM_HPP
+#define KDR_STREAM_HPP
+
+#include <GL/glew.h>
+#include <iostream>
+#include <vector>
+
+namespace kdr
+{
+  /**
+   * @brief Class handing out transient GPU memory that is rewritten every frame.
+   *
+   * The buffer is split into one region per frame in flight. With OpenGL 4.4 or
+   * ARB_buffer_storage it stays persistently and coherently mapped, and a fence placed at the
+   * end of each frame tells when its region may be written again. Without it the buffer is
+   * orphaned every frame, and allocations are written to CPU memory and uploaded by flush().
+   */
+  class StreamBuffer
+  {
+    public:
+      /**
+       * @brief Struct describing memory handed out for the current frame.
+       */
+      struct Allocation
+      {
+        GLubyte*   data   {NULL};
+        GLintptr   offset {0};
+        GLsizeiptr size   {0};
+      };
+
+      /**
+       * @brief Constructs a stream buffer. The GPU buffer is created by the first beginFrame().
+       *
+       * @param frameSize The number of bytes available to each frame.
+       * @param frameCount The number of frames that may be in flight.
+       */
+      StreamBuffer(const GLsizeiptr frameSize = 4 << 20, const unsigned int frameCount = 3)
+      : frameSize(frameSize), frameCount(frameCount)
+      {}
+      /**
+       * @brief Destructor deleting the buffer.
+       */
+      ~StreamBuffer()
+      { this->Delete(); }
+
+      StreamBuffer(const StreamBuffer&) = delete;
+      StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+      /**
+       * @brief Checks if the context supports persistently mapped buffers.
+       *
+       * @return True if buffer storage is available, false otherwise.
+       */
+      static bool isPersistentSupported();
+
+      /**
+       * @brief Starts a frame, waiting only if its region is still read by the GPU.
+       *
+       * If the previous frame ran out of memory, the buffer is recreated larger first.
+       */
+      void beginFrame();
+      /**
+       * @brief Allocates memory for the current frame.
+       *
+       * @param size The number of bytes to allocate.
+       * @param alignment The alignment of the offset in bytes, such as a binding offset alignment.
+       * @param oAllocation Output parameter receiving the pointer to write to and the buffer offset.
+       * @return True if the frame had enough memory left, false otherwise.
+       */
+      bool allocate(const GLsizeiptr size, const GLsizeiptr alignment, Allocation& oAllocation);
+      /**
+       * @brief Makes the data written so far visible to the GPU. Call before drawing with it.
+       */
+      void flush();
+      /**
+       * @brief Ends the frame, fencing its region.
+       */
+      void endFrame();
+      /**
+       * @brief Deletes the buffer and its fences.
+       */
+      void Delete();
+
+      /**
+       * @brief Gets the ID of the buffer.
+       *
+       * @return The ID of the buffer.
+       */
+      GLuint getID() const
+      { return this->ID; }
+      /**
+       * @brief Checks if the buffer is persistently mapped.
+       *
+       * @return True if mapped, false if using the orphaning fallback.
+       */
+      bool getPersistent() const
+      { return this->persistent; }
+      /**
+       * @brief Gets the number of bytes available to each frame.
+       *
+       * @return The frame size in bytes.
+       */
+      GLsizeiptr getFrameSize() const
+      { return this->frameSize; }
+      /**
+       * @brief Gets the number of times beginFrame() had to wait for the GPU.
+       *
+       * @return The number of waits.
+       */
+      unsigned int getWaitCount() const
+      { return this->waitCount; }
+
+    private:
+      GLsizeiptr   frameSize  {0};
+      unsigned int frameCount {0};
+
+      GLuint               ID         {0};
+      bool                 persistent {false};
+      GLubyte*             mapped     {NULL};
+      std::vector<GLsync>  fences;
+      std::vector<GLubyte> staging;
+
+      unsigned int frame     {0};
+      GLsizeiptr   head      {0};
+      GLsizeiptr   flushed   {0};
+      GLsizeiptr   required  {0};
+      unsigned int waitCount {0};
+
+      /**
+       * @brief Creates the buffer, mapping it if possible.
+       */
+      void _create();
+      /**
+       * @brief Gets the offset of the current frame's region in the buffer.
+       *
+       * @return The offset in bytes.
+       */
+      GLintptr _regionOffset() const
+      { return this->persistent ? this->frame * this->frameSize : 0; }
+  };
+}
+
+#endif // KDR_STREAM_HPP
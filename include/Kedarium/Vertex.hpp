@@ -0,0 +1,124 @@
+#ifndef KDR_VERTEX_HPP
+#define KDR_VERTEX_HPP
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "Arena.hpp"
+#include "Bounds.hpp"
+#include "Space.hpp"
+
+namespace kdr
+{
+  /**
+   * @brief Namespace containing vertex formats and their encoding.
+   */
+  namespace Vertex
+  {
+    /**
+     * @brief The number of floats per vertex of the uncompressed solid layout.
+     *
+     * Position (3), color (3), texture coordinates (2) and normal (3).
+     */
+    constexpr GLuint SOURCE_STRIDE {11};
+
+    /**
+     * @brief Enum of the ways normals can be stored.
+     */
+    enum class NormalEncoding
+    {
+      Float,      ///< Three floats, 12 bytes.
+      Octahedral, ///< Octahedral mapping into two 16-bit signed normalized values, 4 bytes.
+      Packed      ///< Three 10-bit signed normalized values in GL_INT_2_10_10_10_REV, 4 bytes.
+    };
+
+    /**
+     * @brief Struct describing how solid vertices are stored on the GPU.
+     *
+     * The default format is the uncompressed 44 byte layout.
+     */
+    struct Format
+    {
+      bool           color              {true};
+      bool           halfTexCoords      {false};
+      NormalEncoding normals            {NormalEncoding::Float};
+      bool           quantizedPositions {false};
+    };
+
+    /**
+     * @brief Gets the number of bytes per vertex of a format.
+     *
+     * @param format The vertex format.
+     * @return The vertex stride in bytes.
+     */
+    GLuint getStride(const kdr::Vertex::Format& format);
+    /**
+     * @brief Gets the attributes of a format, keeping the locations of the uncompressed layout.
+     *
+     * @param format The vertex format.
+     * @return The attributes with byte offsets.
+     */
+    std::vector<kdr::MeshArena::Attribute> getAttributes(const kdr::Vertex::Format& format);
+    /**
+     * @brief Gets the shader defines that make default.vert and indirect.vert decode a format.
+     *
+     * @param format The vertex format.
+     * @return The defines to pass when adding the shader.
+     */
+    std::vector<std::string> getDefines(const kdr::Vertex::Format& format);
+    /**
+     * @brief Encodes uncompressed solid vertices into a format.
+     *
+     * Quantized positions are stored as 16-bit fractions of the bounding box, and decoded in
+     * the shader as positionOffset + position * positionScale. Half float texture coordinates
+     * lose precision above a few hundred, so tiled planes should stay small.
+     *
+     * @param format The vertex format.
+     * @param vertices The uncompressed vertices, SOURCE_STRIDE floats each.
+     * @param vertexCount The number of vertices.
+     * @param bounds The bounding box of the positions.
+     * @param oData Output parameter receiving the encoded vertices.
+     */
+    void encode(const kdr::Vertex::Format& format, const GLfloat* vertices, const size_t vertexCount, const kdr::Bounds::AABB& bounds, std::vector<GLubyte>& oData);
+
+    /**
+     * @brief Converts a float to a half float, rounding to nearest.
+     *
+     * @param value The value to convert.
+     * @return The bits of the half float.
+     */
+    uint16_t toHalf(const float value);
+    /**
+     * @brief Packs a unit vector into three 10-bit signed normalized values.
+     *
+     * @param normal The unit vector.
+     * @return The GL_INT_2_10_10_10_REV value with w set to zero.
+     */
+    uint32_t packNormal(const kdr::Space::Vec3& normal);
+    /**
+     * @brief Encodes a unit vector with the octahedral mapping.
+     *
+     * @param normal The unit vector.
+     * @param oEncoded Output parameter receiving the two 16-bit signed normalized values.
+     */
+    void encodeOctahedral(const kdr::Space::Vec3& normal, int16_t oEncoded[2]);
+
+    /**
+     * @brief Sets the format used by the solid arena. Only possible before any solid is created.
+     *
+     * @param format The vertex format.
+     * @return True if the format was set, false if solids already exist.
+     */
+    bool setSolidFormat(const kdr::Vertex::Format& format);
+    /**
+     * @brief Gets the format used by the solid arena.
+     *
+     * @return The vertex format of solids.
+     */
+    const kdr::Vertex::Format& getSolidFormat();
+  }
+}
+
+#endif // KDR_VERTEX_HPP
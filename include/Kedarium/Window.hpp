@@ -3,21 +3,44 @@
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <string>
 
 #include "Core.hpp"
+#include "Image.hpp"
+#include "Capture.hpp"
+#include "HotReload.hpp"
 #include "Graphics.hpp"
 #include "Color.hpp"
 #include "Keys.hpp"
 #include "Camera.hpp"
 #include "Solids.hpp"
+#include "BVH.hpp"
 #include "Lights.hpp"
 #include "GUI.hpp"
+#include "Profiler.hpp"
+#include "MultiDraw.hpp"
+#include "Occlusion.hpp"
+#include "Scene.hpp"
+#include "Stream.hpp"
 
 namespace kdr
 {
+  /**
+   * @brief Struct holding per-frame rendering counters.
+   */
+  struct RenderStats
+  {
+    unsigned int drawn         {0};
+    unsigned int culled        {0};
+    unsigned int occluded      {0};
+    unsigned int queried       {0};
+    unsigned int queryOccluded {0};
+    unsigned int triangles     {0};
+  };
+
   /**
    * @brief Class representing a window.
    */
@@ -30,9 +53,10 @@ namespace kdr
        * @param width The width of the window.
        * @param height The height of the window.
        * @param title The title of the window.
+       * @param headless True to render into an offscreen framebuffer of a hidden window.
        */
-      Window(const unsigned int width, const unsigned int height, const std::string& title)
-      : width(width), height(height), title(title)
+      Window(const unsigned int width, const unsigned int height, const std::string& title, const bool headless = false)
+      : width(width), height(height), title(title), headless(headless)
       { this->_initialize(); }
       /**
        * @brief Destructor for the Window class.
@@ -41,6 +65,21 @@ namespace kdr
        */
       virtual ~Window()
       {
+        this->hotReloader.stop();
+        this->frameCapture.stop();
+        this->profiler.Delete();
+        this->multiDraw.Delete();
+        this->occlusionQueries.Delete();
+        this->streamBuffer.Delete();
+        this->shaders.clear();
+        this->textures.clear();
+        kdr::MeshArena::getSolidArena().Delete();
+        if (this->framebuffer != 0)
+        {
+          glDeleteFramebuffers(1, &this->framebuffer);
+          glDeleteRenderbuffers(1, &this->colorRenderbuffer);
+          glDeleteRenderbuffers(1, &this->depthRenderbuffer);
+        }
         glfwDestroyWindow(this->glfwWindow);
       }
 
@@ -53,6 +92,59 @@ namespace kdr
        */
       void close()
       { glfwSetWindowShouldClose(this->glfwWindow, GLFW_TRUE); }
+      /**
+       * @brief Runs a fixed number of frames for benchmarking and image regression checks.
+       *
+       * Every frame advances by the same time step and input is ignored, so the camera path
+       * and update() see identical times on every run. In headless mode each frame waits for
+       * the GPU to finish, so frame times include the rendering work.
+       *
+       * @param frameCount The number of frames to run.
+       * @param cameraPath The path the bound camera follows, or NULL to leave the camera alone.
+       * @param screenshotPath The PNG file receiving the last frame, or an empty string for none.
+       * @return The frame time statistics of the run.
+       */
+      kdr::FrameStats benchmark(const unsigned int frameCount, const kdr::CameraPath* cameraPath = NULL, const std::string& screenshotPath = "");
+      /**
+       * @brief Saves the framebuffer the window renders into to a PNG file.
+       *
+       * In windowed mode the back buffer is read, so this must be called from render().
+       *
+       * @param path The file path to write the PNG image to.
+       * @return True if the image was saved successfully, false otherwise.
+       */
+      bool saveScreenshot(const std::string& path);
+      /**
+       * @brief Starts capturing every rendered frame to numbered PNG files.
+       *
+       * Frames are read back asynchronously and encoded on background threads. The capture
+       * resolution is fixed to the framebuffer size at the time capturing starts.
+       *
+       * @param pathPrefix The prefix of the written file paths, followed by the frame number.
+       * @return True if capturing started, false otherwise.
+       */
+      bool startCapture(const std::string& pathPrefix);
+      /**
+       * @brief Stops capturing frames, writing out all frames still in flight.
+       */
+      void stopCapture()
+      { this->frameCapture.stop(); }
+      /**
+       * @brief Starts reloading added shaders and textures when their files change.
+       *
+       * Reloaded objects are swapped in at the start of a frame. If a shader fails to compile
+       * or a texture fails to decode, the previous version stays in use.
+       *
+       * @param directory The directory to watch, including its subdirectories.
+       * @return True if watching started, false otherwise.
+       */
+      bool enableHotReload(const std::string& directory)
+      { return this->hotReloader.start(directory); }
+      /**
+       * @brief Stops reloading assets when their files change.
+       */
+      void disableHotReload()
+      { this->hotReloader.stop(); }
 
       /**
        * @brief Gets the GLFW window associated with this object.
@@ -85,12 +177,44 @@ namespace kdr
       /**
        * @brief Gets the delta time.
        *
-       * This function returns the delta time for the window.
+       * This function returns the time step of update(), which is the fixed tick when a tick
+       * rate is set and the time since the last frame otherwise.
        *
        * @return The delta time.
        */
       float getDeltaTime() const
       { return this->deltaTime; }
+      /**
+       * @brief Gets the time since the last frame.
+       *
+       * @return The frame time in seconds.
+       */
+      float getFrameTime() const
+      { return this->frameTime; }
+      /**
+       * @brief Gets the number of update() calls per second.
+       *
+       * @return The tick rate, or 0 if update() runs once per frame.
+       */
+      double getTickRate() const
+      { return this->tickRate; }
+      /**
+       * @brief Gets the maximum number of update() calls in one frame.
+       *
+       * @return The tick limit.
+       */
+      unsigned int getMaxTicksPerFrame() const
+      { return this->maxTicksPerFrame; }
+      /**
+       * @brief Gets how far the clock has advanced past the last tick, in ticks.
+       *
+       * render() can blend the states of the last two ticks with it, so motion stays smooth
+       * when frames and ticks do not line up.
+       *
+       * @return The interpolation factor in [0, 1], or 1 if update() runs once per frame.
+       */
+      float getInterpolationAlpha() const
+      { return this->interpolationAlpha; }
       /**
        * @brief Gets the shader currently bound to the window.
        *
@@ -98,6 +222,14 @@ namespace kdr
        */
       kdr::Graphics::Shader* getBoundShader() const
       { return this->boundShader; }
+      /**
+       * @brief Gets a texture of the texture manager by name.
+       *
+       * @param name The name of the texture.
+       * @return A pointer to the texture, or NULL if there is none with that name.
+       */
+      kdr::Graphics::Texture* getTexture(const std::string& name)
+      { return this->textures.get(name); }
       /**
        * @brief Gets the camera bound to the window.
        *
@@ -105,6 +237,120 @@ namespace kdr
        */
       kdr::Camera* getBoundCamera() const
       { return this->boundCamera; }
+      /**
+       * @brief Checks if the window renders offscreen.
+       *
+       * @return True if the window is headless, false otherwise.
+       */
+      bool getHeadless() const
+      { return this->headless; }
+      /**
+       * @brief Gets the rendering counters of the last completed frame.
+       *
+       * @return The numbers of drawn, frustum-culled and occluded solids, and of occlusion queries.
+       */
+      kdr::RenderStats getRenderStats() const
+      { return this->renderStats; }
+      /**
+       * @brief Checks if frustum culling is enabled.
+       *
+       * @return True if frustum culling is enabled, false otherwise.
+       */
+      bool getFrustumCulling() const
+      { return this->frustumCulling; }
+      /**
+       * @brief Checks if solids are drawn with indirect multi-draws.
+       *
+       * @return True if multi-draw is enabled, false otherwise.
+       */
+      bool getMultiDraw() const
+      { return this->multiDrawEnabled; }
+      /**
+       * @brief Gets the projected error allowed when selecting the level of detail of solids.
+       *
+       * @return The error in pixels, zero or less if solids are always drawn at full detail.
+       */
+      float getLodThreshold() const
+      { return this->lodThreshold; }
+      /**
+       * @brief Checks if the clusters of dense solids are culled.
+       *
+       * @return True if cluster culling is enabled, false otherwise.
+       */
+      bool getClusterCulling() const
+      { return this->clusterCulling; }
+      /**
+       * @brief Checks if solids hidden behind the occluders are skipped.
+       *
+       * @return True if occlusion culling is enabled, false otherwise.
+       */
+      bool getOcclusionCulling() const
+      { return this->occlusionCulling; }
+      /**
+       * @brief Gets the software depth buffer the occluders were rasterized into this frame.
+       *
+       * @return A reference to the occlusion buffer.
+       */
+      const kdr::OcclusionBuffer& getOcclusionBuffer() const
+      { return this->occlusionBuffer; }
+      /**
+       * @brief Checks if expensive solids are drawn behind GPU occlusion queries.
+       *
+       * @return True if occlusion queries are enabled, false otherwise.
+       */
+      bool getOcclusionQueries() const
+      { return this->occlusionQueriesEnabled; }
+      /**
+       * @brief Checks if update() runs on a worker while the previous frame is rendered.
+       *
+       * @return True if the loop is pipelined, false otherwise.
+       */
+      bool getPipelined() const
+      { return this->pipelined; }
+      /**
+       * @brief Gets the scene bound to the window.
+       *
+       * @return A pointer to the bound scene, or NULL if there is none.
+       */
+      kdr::Scene* getBoundScene() const
+      { return this->boundScene; }
+      /**
+       * @brief Gets the snapshot of the bound scene taken after the previous update().
+       *
+       * Only taken in pipelined mode, where it stays unchanged while the next update() runs,
+       * so render() reads lights and placements from it instead of the bound scene.
+       *
+       * @return A reference to the snapshot, empty if no scene is bound or the loop is not pipelined.
+       */
+      const kdr::SceneSnapshot& getSceneSnapshot() const
+      { return this->frameScenes[this->renderedScene]; }
+      /**
+       * @brief Gets the buffer for transient GPU data of the current frame.
+       *
+       * A new frame of the buffer begins before render() is called and ends after it.
+       *
+       * @return A reference to the stream buffer.
+       */
+      kdr::StreamBuffer& getStreamBuffer()
+      { return this->streamBuffer; }
+      /**
+       * @brief Gets the profiler timing the frames of the window.
+       *
+       * The loop records the "Update", "Render" and "Swap" scopes of every frame, and in
+       * pipelined mode a "Wait" scope for the time spent waiting on the update job, and
+       * user code may add its own scopes with kdr::Profiler::Scope.
+       *
+       * @return A reference to the profiler.
+       */
+      kdr::Profiler& getProfiler()
+      { return this->profiler; }
+      /**
+       * @brief Gets the frame capture of the window.
+       *
+       * @return A reference to the frame capture.
+       */
+      const kdr::FrameCapture& getFrameCapture() const
+      { return this->frameCapture; }
 
       /**
        * @brief Sets the width of the window.
@@ -120,6 +366,139 @@ namespace kdr
        */
       void setHeight(const float height)
       { this->height = height; }
+      /**
+       * @brief Enables or disables frustum culling of solids.
+       * 
+       * @param frustumCulling True to skip solids outside the camera frustum, false to draw everything.
+       */
+      void setFrustumCulling(const bool frustumCulling)
+      { this->frustumCulling = frustumCulling; }
+      /**
+       * @brief Enables or disables drawing batches of solids with one indirect multi-draw.
+       * 
+       * When enabled, renderSolids() draws all visible solids of a call with a single
+       * glMultiDrawElementsIndirect, and the bound shader must read its model matrices like
+       * indirect.vert does. Without OpenGL 4.3 the per-solid path is kept.
+       * 
+       * @param enabled True to use multi-draw, false to draw every solid separately.
+       * @return True if the requested mode is active, false if multi-draw is not supported.
+       */
+      bool setMultiDraw(const bool enabled)
+      {
+        if (enabled && !kdr::MultiDraw::isSupported())
+        {
+          std::cerr << "Multi-draw requires OpenGL 4.3, drawing solids separately.\n";
+          this->multiDrawEnabled = false;
+          return false;
+        }
+        this->multiDrawEnabled = enabled;
+        return true;
+      }
+      /**
+       * @brief Sets the projected error allowed when selecting the level of detail of solids.
+       *
+       * Each drawn solid uses its coarsest level whose simplification error, projected from
+       * the bound camera, stays below this many pixels.
+       *
+       * @param lodThreshold The error in pixels, zero or less to always draw full detail.
+       */
+      void setLodThreshold(const float lodThreshold)
+      { this->lodThreshold = lodThreshold; }
+      /**
+       * @brief Enables or disables culling the clusters of dense solids.
+       *
+       * When enabled, solids drawn separately at full detail have their clusters tested
+       * against the camera frustum and their normal cones, and only the indices of the
+       * visible clusters are written to the stream buffer and drawn. Multi-draws and
+       * coarser levels of detail draw whole solids.
+       *
+       * @param clusterCulling True to cull clusters, false to draw whole solids.
+       */
+      void setClusterCulling(const bool clusterCulling)
+      { this->clusterCulling = clusterCulling; }
+      /**
+       * @brief Enables or disables skipping solids hidden behind the occluders.
+       *
+       * When enabled and occluders were added, the occluders are rasterized on the CPU from
+       * the bound camera before render() is called, and every solid whose bounds are hidden
+       * behind them is skipped.
+       *
+       * @param occlusionCulling True to skip occluded solids, false to draw them.
+       */
+      void setOcclusionCulling(const bool occlusionCulling)
+      { this->occlusionCulling = occlusionCulling; }
+      /**
+       * @brief Designates a solid as an occluder.
+       *
+       * Good occluders are large and simple, such as walls and floors. The solid must outlive
+       * its designation.
+       *
+       * @param solid The solid hiding what lies behind it.
+       * @return True if the solid was added, false if it is too dense to be rasterized on the CPU.
+       */
+      bool addOccluder(const kdr::Solids::Solid& solid);
+      /**
+       * @brief Enables or disables drawing expensive solids behind GPU occlusion queries.
+       *
+       * When enabled, solids drawn separately with at least kdr::OcclusionQueries::MIN_TRIANGLES
+       * triangles first have their bounding box tested against the depth buffer, and are drawn
+       * with conditional rendering on the result. Solids drawn earlier act as occluders, so
+       * large nearby solids should be rendered first.
+       *
+       * @param enabled True to use occlusion queries, false to draw expensive solids directly.
+       */
+      void setOcclusionQueries(const bool enabled)
+      { this->occlusionQueriesEnabled = enabled; }
+      /**
+       * @brief Enables or disables running update() on a worker while the previous frame is rendered.
+       *
+       * In pipelined mode the loop polls input and moves the bound camera on the main thread,
+       * then starts update() and the transform update of the bound scene as a job, and renders
+       * the snapshot of the bound scene taken after the previous update() in the meantime.
+       * The job ends by copying the world matrices, world bounds and lights of the scene into
+       * the other snapshot, still while the previous frame is drawn, and the two are swapped
+       * once both are done. update() must then make no OpenGL calls, leave the camera alone
+       * and not add, remove or change meshes and materials, which the snapshots share with the
+       * scene. render() must draw the scene with renderBoundScene() and read its lights from
+       * getSceneSnapshot().
+       *
+       * The placements of the occluders are snapshotted along with the scene, so update() may
+       * move them, but a solid removed from the occluders must outlive the frame being
+       * rendered. Profiler scopes begun inside update() are not recorded.
+       *
+       * @param enabled True to pipeline update and render, false to run them one after another.
+       */
+      void setPipelined(const bool enabled)
+      { this->pipelined = enabled; }
+      /**
+       * @brief Sets a fixed rate for update(), independent of the frame rate.
+       *
+       * Frame times are accumulated on a double precision clock, and update() runs once for
+       * every whole tick in the accumulator, each time with the tick as delta time.
+       *
+       * @param ticksPerSecond The number of update() calls per second, or 0 to call it once per frame.
+       */
+      void setTickRate(const double ticksPerSecond)
+      {
+        this->tickRate = std::max(0.0, ticksPerSecond);
+        this->tickAccumulator = 0.0;
+      }
+      /**
+       * @brief Sets the maximum number of update() calls in one frame.
+       *
+       * When the simulation falls further behind, the time it cannot catch up on is dropped
+       * instead of making the next frames even longer.
+       *
+       * @param maxTicks The tick limit, at least 1.
+       */
+      void setMaxTicksPerFrame(const unsigned int maxTicks)
+      { this->maxTicksPerFrame = std::max(1u, maxTicks); }
+      /**
+       * @brief Removes a solid from the occluders.
+       *
+       * @param solid The solid to remove.
+       */
+      void removeOccluder(const kdr::Solids::Solid& solid);
       /**
        * Sets the clear color for the window.
        * 
@@ -172,17 +551,37 @@ namespace kdr
       /**
        * @brief Adds a shader to the shader manager.
        * 
+       * The compile and link commands are only issued here, so consecutive calls overlap in
+       * the driver. The shader is finalized when it is first bound, or by finishShaders().
+       * 
        * @param name The name of the shader.
        * @param vertexPath The file path to the vertex shader source code.
        * @param fragmentPath The file path to the fragment shader source code.
+       * @param defines The preprocessor definitions injected into both stages.
        */
-      void addShader(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath)
+      void addShader(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {})
       {
         kdr::Graphics::Shader shader {
           vertexPath,
-          fragmentPath
+          fragmentPath,
+          defines,
+          true
         };
-        this->shaders.add(name, shader);
+        this->shaders.add(name, std::move(shader));
+        this->hotReloader.watchShader(name, vertexPath, fragmentPath, defines);
+      }
+      /**
+       * @brief Waits for all added shaders to finish compiling and reports their errors.
+       * 
+       * @return True if every shader linked successfully, false otherwise.
+       */
+      bool finishShaders()
+      {
+        bool success {true};
+        this->shaders.forEach([&success](const std::string&, kdr::Graphics::Shader& shader) {
+          success = shader.finalize() && success;
+        });
+        return success;
       }
       /**
        * @brief Adds a texture to the texture manager.
@@ -198,7 +597,8 @@ namespace kdr
           GL_TEXTURE0,
           GL_UNSIGNED_BYTE
         };
-        this->textures.add(name, texture);
+        this->textures.add(name, std::move(texture));
+        this->hotReloader.watchTexture(name, pngPath);
       }
 
       /**
@@ -213,6 +613,22 @@ namespace kdr
         {
           return;
         }
+        shader->finalize();
+        this->boundShader = shader;
+        shader->Use();
+      }
+      /**
+       * @brief Binds a shader that is not owned by the window, such as a cached variant.
+       * 
+       * @param shader A pointer to the shader to bind.
+       */
+      void bindShader(kdr::Graphics::Shader* shader)
+      {
+        if (shader == NULL)
+        {
+          return;
+        }
+        shader->finalize();
         this->boundShader = shader;
         shader->Use();
       }
@@ -240,9 +656,20 @@ namespace kdr
       {
         this->boundCamera = camera;
       }
+      /**
+       * @brief Binds a scene to the window, whose transforms are updated after every update().
+       *
+       * @param scene A pointer to the scene to bind, or NULL to unbind it.
+       */
+      void bindScene(kdr::Scene* scene)
+      {
+        this->boundScene = scene;
+      }
       /**
        * @brief Renders a solid object.
        * 
+       * The solid is skipped if it lies outside the frustum of the bound camera or behind the occluders.
+       * 
        * @param solid The solid object to render.
        */
       void renderSolid(const kdr::Solids::Solid& solid)
@@ -251,9 +678,56 @@ namespace kdr
         {
           return;
         }
-        solid.applyModelMatrix(this->boundShader->getID(), "model");
-        solid.render();
+        if (this->frustumCulling && this->boundCamera != NULL && !kdr::Bounds::testAABB(this->boundCamera->getFrustum(), solid.getWorldBounds()))
+        {
+          this->frameStats.culled++;
+          return;
+        }
+        if (this->_isOccluded(solid))
+        {
+          this->frameStats.occluded++;
+          return;
+        }
+        this->_selectLod(solid);
+        this->_drawSolid(solid);
+        this->frameStats.drawn++;
       }
+      /**
+       * @brief Renders multiple solid objects sharing the current shader and texture.
+       * 
+       * The solids are frustum-culled as one batch before any of them is drawn.
+       * 
+       * @param solids The solid objects to render.
+       */
+      void renderSolids(const std::vector<const kdr::Solids::Solid*>& solids);
+      /**
+       * @brief Renders the solids of a hierarchy that intersect the camera frustum.
+       * 
+       * The user data of every object in the hierarchy must point to a kdr::Solids::Solid.
+       * 
+       * @param bvh The hierarchy containing the solids.
+       */
+      void renderSolids(const kdr::BVH& bvh);
+      /**
+       * @brief Renders the entities of a scene that have a mesh.
+       *
+       * The entities are frustum-culled as one batch over the world bounds pool, tested against
+       * the occluders, and drawn sorted by texture and mesh, binding each texture once.
+       * Transforms must be up to date, see kdr::Scene::updateTransforms().
+       *
+       * @param scene The scene to render.
+       */
+      void renderScene(const kdr::Scene& scene);
+      /**
+       * @brief Renders the entities with a mesh of a scene snapshot, like renderScene().
+       *
+       * @param snapshot The snapshot to render.
+       */
+      void renderScene(const kdr::SceneSnapshot& snapshot);
+      /**
+       * @brief Renders the bound scene, from its snapshot in pipelined mode.
+       */
+      void renderBoundScene();
       /**
        * @brief Renders a GUI element.
        * 
@@ -302,6 +776,16 @@ namespace kdr
       {}
 
     private:
+      /**
+       * @brief Struct holding the placement of an occluder when its frame was updated.
+       */
+      struct OccluderState
+      {
+        const kdr::Solids::Solid* solid {NULL};
+        kdr::Space::Mat4          model {1.f};
+        kdr::Bounds::AABB         bounds;
+      };
+
       unsigned int width  {800};
       unsigned int height {600};
       std::string  title  {"GLFW"};
@@ -309,14 +793,64 @@ namespace kdr
       GLFWwindow*      glfwWindow {NULL};
       kdr::Color::RGBA clearColor {kdr::Color::Black};
 
-      float deltaTime {0.f};
-      float lastTime  {(float)glfwGetTime()};
+      bool   headless          {false};
+      GLuint framebuffer       {0};
+      GLuint colorRenderbuffer {0};
+      GLuint depthRenderbuffer {0};
+
+      static constexpr float BENCHMARK_TIMESTEP {1.f / 60.f};
+
+      float  deltaTime {0.f};
+      float  frameTime {0.f};
+      double lastTime  {glfwGetTime()};
+
+      double       tickRate           {0.0};
+      unsigned int maxTicksPerFrame   {8};
+      double       tickAccumulator    {0.0};
+      unsigned int pendingTicks       {1};
+      float        interpolationAlpha {1.f};
 
       kdr::Graphics::Shader* boundShader     {0};
       kdr::Camera*           boundCamera     {NULL};
       kdr::Key               cameraBindKey   {kdr::Key::E};
       kdr::Key               cameraUnbindKey {kdr::Key::Escape};
 
+      bool                           frustumCulling {true};
+      kdr::RenderStats               renderStats;
+      kdr::RenderStats               frameStats;
+      std::vector<kdr::Bounds::AABB> cullBounds;
+      std::vector<unsigned char>     cullVisibility;
+      std::vector<void*>             cullResults;
+      std::vector<kdr::Entity>       sceneDraws;
+
+      bool               pipelined     {false};
+      kdr::Scene*        boundScene    {NULL};
+      kdr::SceneSnapshot frameScenes[2];
+      unsigned int       renderedScene {0};
+
+      float lodThreshold {1.f};
+
+      bool                       clusterCulling {true};
+      std::vector<unsigned char> clusterVisibility;
+
+      bool                                   occlusionCulling {true};
+      bool                                   occlusionReady   {false};
+      std::vector<const kdr::Solids::Solid*> occluders;
+      std::vector<OccluderState>             occluderStates[2];
+      kdr::OcclusionBuffer                   occlusionBuffer;
+
+      bool                  occlusionQueriesEnabled {false};
+      kdr::OcclusionQueries occlusionQueries;
+
+      bool           multiDrawEnabled {false};
+      kdr::MultiDraw multiDraw;
+
+      kdr::StreamBuffer streamBuffer;
+
+      kdr::Profiler     profiler;
+      kdr::FrameCapture frameCapture;
+      kdr::HotReloader  hotReloader;
+
       kdr::Key fullscreenKey     {kdr::Key::F};
       bool     fullscreenEnabled {false};
       bool     canUseFullscreen  {true};
@@ -340,6 +874,12 @@ namespace kdr
        * @return True if initialization is successful, false otherwise.
        */
       bool _initializeOpenGLSettings();
+      /**
+       * @brief Initializes the offscreen framebuffer used in headless mode.
+       * 
+       * @return True if the framebuffer is complete, false otherwise.
+       */
+      bool _initializeFramebuffer();
       /**
        * @brief Initializes the window and OpenGL settings.
        * 
@@ -354,6 +894,12 @@ namespace kdr
        * This function updates the delta time for the window.
        */
       void _updateDeltaTime();
+      /**
+       * @brief Advances the clock, working out the ticks update() has to run this frame.
+       *
+       * @param elapsed The time since the last frame in seconds.
+       */
+      void _advanceClock(const double elapsed);
       /**
        * @brief Updates the camera state.
        * 
@@ -364,10 +910,85 @@ namespace kdr
        * @brief Updates the window state.
        */
       void _update();
+      /**
+       * @brief Polls events, applies reloaded assets and updates the delta time and the camera.
+       *
+       * This is the part of an update that has to run on the main thread.
+       */
+      void _updateInput();
+      /**
+       * @brief Calls update() for every pending tick and updates the transforms of the bound scene.
+       */
+      void _updateState();
+      /**
+       * @brief Copies the state render() reads from the objects update() changes.
+       *
+       * The placements of the occluders are always copied, and a snapshot of the bound scene in pipelined mode.
+       *
+       * @param index The snapshot to write, 0 or 1.
+       */
+      void _captureFrame(const unsigned int index);
+      /**
+       * @brief Runs the loop with update() on a worker, one frame ahead of rendering.
+       */
+      void _loopPipelined();
       /**
        * @brief Renders the window contents.
        */
       void _render();
+      /**
+       * @brief Renders the window contents without presenting them.
+       */
+      void _renderFrame();
+      /**
+       * @brief Presents the rendered frame, or waits for it to finish in headless mode.
+       */
+      void _present();
+      /**
+       * @brief Applies the model matrix and position decoding of a solid to the bound shader.
+       *
+       * @param solid The solid about to be drawn.
+       */
+      void _applySolid(const kdr::Solids::Solid& solid);
+      /**
+       * @brief Draws a solid with the bound shader, culling its clusters or testing it with a query.
+       *
+       * @param solid The solid to draw, with its level of detail selected.
+       */
+      void _drawSolid(const kdr::Solids::Solid& solid);
+      /**
+       * @brief Selects the level of detail of a solid for the bound camera and counts its triangles.
+       *
+       * @param solid The solid about to be drawn.
+       */
+      void _selectLod(const kdr::Solids::Solid& solid);
+      /**
+       * @brief Draws the visible clusters of a solid from a compacted index buffer.
+       *
+       * @param solid The solid to draw, with its shader uniforms applied.
+       * @return True if the solid was handled, false if it should be drawn whole.
+       */
+      bool _renderClusters(const kdr::Solids::Solid& solid);
+      /**
+       * @brief Rasterizes the occluders from the bound camera into the occlusion buffer.
+       */
+      void _renderOccluders();
+      /**
+       * @brief Tests the culled entities of a scene against the occluders, sorts and draws them.
+       *
+       * @param scene The scene holding the meshes and materials.
+       * @param worldBounds The world bounds the occluders are tested against.
+       * @param worlds The world matrices to draw with, or NULL to read the transforms of the scene.
+       */
+      void _drawScene(const kdr::Scene& scene, const kdr::ComponentPool<kdr::Components::WorldBounds>& worldBounds, const kdr::ComponentPool<kdr::Space::Mat4>* worlds);
+      /**
+       * @brief Checks if a solid is hidden behind the occluders of the current frame.
+       *
+       * @param solid The solid about to be drawn.
+       * @return True if the solid can be skipped, false otherwise.
+       */
+      bool _isOccluded(const kdr::Solids::Solid& solid) const
+      { return this->occlusionReady && !this->occlusionBuffer.testAABB(solid.getWorldBounds()); }
   };
 }
 
@@ -0,0 +1,340 @@
+#include "Kedarium/Arena.hpp"
+#include "Kedarium/Vertex.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+bool kdr::RangeAllocator::allocate(const GLuint size, GLuint& oOffset)
+{
+  if (size == 0)
+  {
+    return false;
+  }
+
+  for (auto it = this->freeRanges.begin(); it != this->freeRanges.end(); it++)
+  {
+    if (it->second < size)
+    {
+      continue;
+    }
+    oOffset = it->first;
+    const GLuint remaining = it->second - size;
+    this->freeRanges.erase(it);
+    if (remaining > 0)
+    {
+      this->freeRanges[oOffset + size] = remaining;
+    }
+    this->used += size;
+    return true;
+  }
+  return false;
+}
+
+void kdr::RangeAllocator::release(const GLuint offset, const GLuint size)
+{
+  if (size == 0)
+  {
+    return;
+  }
+
+  GLuint start = offset;
+  GLuint length = size;
+  auto next = this->freeRanges.lower_bound(offset);
+  if (next != this->freeRanges.begin())
+  {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset)
+    {
+      start = previous->first;
+      length += previous->second;
+      this->freeRanges.erase(previous);
+    }
+  }
+  if (next != this->freeRanges.end() && offset + size == next->first)
+  {
+    length += next->second;
+    this->freeRanges.erase(next);
+  }
+  this->freeRanges[start] = length;
+  this->used -= size;
+}
+
+void kdr::RangeAllocator::grow(const GLuint capacity)
+{
+  if (capacity <= this->capacity)
+  {
+    return;
+  }
+
+  const GLuint added = capacity - this->capacity;
+  const GLuint start = this->capacity;
+  this->capacity = capacity;
+  // The new units are counted as used so releasing them merges them with a trailing free range.
+  this->used += added;
+  this->release(start, added);
+}
+
+void kdr::RangeAllocator::reset(const GLuint capacity, const GLuint used)
+{
+  this->freeRanges.clear();
+  this->capacity = capacity;
+  this->used = std::min(used, capacity);
+  if (this->used < capacity)
+  {
+    this->freeRanges[this->used] = capacity - this->used;
+  }
+}
+
+GLuint kdr::RangeAllocator::getLargestFree() const
+{
+  GLuint largest {0};
+  for (const auto& range : this->freeRanges)
+  {
+    largest = std::max(largest, range.second);
+  }
+  return largest;
+}
+
+kdr::MeshArena& kdr::MeshArena::getSolidArena()
+{
+  static kdr::MeshArena arena {
+    kdr::Vertex::getStride(kdr::Vertex::getSolidFormat()),
+    kdr::Vertex::getAttributes(kdr::Vertex::getSolidFormat())
+  };
+  return arena;
+}
+
+bool kdr::MeshArena::setLayout(const GLuint vertexStride, const std::vector<Attribute>& attributes)
+{
+  if (this->vertices.getUsed() > 0)
+  {
+    std::cerr << "Cannot change the vertex layout of an arena holding meshes!\n";
+    return false;
+  }
+
+  // The buffers are sized in vertices, so they are recreated with the new stride on first use.
+  this->Delete();
+  this->vertexStride = vertexStride;
+  this->attributes = attributes;
+  return true;
+}
+
+GLuint kdr::MeshArena::add(const void* vertices, const GLuint vertexCount, const GLuint* indices, const GLsizei indexCount)
+{
+  if (vertexCount == 0 || indexCount <= 0)
+  {
+    std::cerr << "Cannot add an empty mesh to the arena!\n";
+    return INVALID_MESH;
+  }
+  if (this->vertexArray == 0)
+  {
+    this->_reallocate(this->vertices.getCapacity(), this->indices.getCapacity(), false);
+  }
+
+  // Capacities double so that adding many meshes only copies the buffers a few times.
+  Range range;
+  if (!this->vertices.allocate(vertexCount, range.firstVertex))
+  {
+    const GLuint capacity = this->vertices.getCapacity();
+    this->_reallocate(std::max(capacity * 2, capacity + vertexCount), this->indices.getCapacity(), false);
+    this->vertices.allocate(vertexCount, range.firstVertex);
+  }
+  if (!this->indices.allocate(indexCount, range.firstIndex))
+  {
+    const GLuint capacity = this->indices.getCapacity();
+    this->_reallocate(this->vertices.getCapacity(), std::max(capacity * 2, capacity + (GLuint)indexCount), false);
+    this->indices.allocate(indexCount, range.firstIndex);
+  }
+  range.vertexCount = vertexCount;
+  range.indexCount = indexCount;
+  range.used = true;
+
+  const GLsizeiptr vertexBytes = this->vertexStride;
+  glBindBuffer(GL_COPY_WRITE_BUFFER, this->vertexBuffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstVertex * vertexBytes, vertexCount * vertexBytes, vertices);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, this->indexBuffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstIndex * sizeof(GLuint), indexCount * sizeof(GLuint), indices);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  if (!this->freeMeshes.empty())
+  {
+    const GLuint mesh = this->freeMeshes.back();
+    this->freeMeshes.pop_back();
+    this->meshes[mesh] = range;
+    return mesh;
+  }
+  this->meshes.push_back(range);
+  return this->meshes.size() - 1;
+}
+
+void kdr::MeshArena::remove(const GLuint mesh)
+{
+  if (mesh >= this->meshes.size() || !this->meshes[mesh].used)
+  {
+    return;
+  }
+
+  Range& range = this->meshes[mesh];
+  this->vertices.release(range.firstVertex, range.vertexCount);
+  this->indices.release(range.firstIndex, range.indexCount);
+  range = Range();
+  this->freeMeshes.push_back(mesh);
+}
+
+void kdr::MeshArena::draw(const GLuint mesh) const
+{
+  if (mesh >= this->meshes.size())
+  {
+    return;
+  }
+  this->draw(mesh, 0, this->meshes[mesh].indexCount);
+}
+
+void kdr::MeshArena::draw(const GLuint mesh, const GLuint firstIndex, const GLsizei indexCount) const
+{
+  if (mesh >= this->meshes.size())
+  {
+    return;
+  }
+
+  const Range& range = this->meshes[mesh];
+  glBindVertexArray(this->vertexArray);
+  glDrawElementsBaseVertex(
+    GL_TRIANGLES,
+    indexCount,
+    GL_UNSIGNED_INT,
+    (const void*)((range.firstIndex + firstIndex) * sizeof(GLuint)),
+    (GLint)range.firstVertex
+  );
+}
+
+void kdr::MeshArena::compact()
+{
+  if (this->vertexArray == 0)
+  {
+    return;
+  }
+  this->_reallocate(this->vertices.getCapacity(), this->indices.getCapacity(), true);
+}
+
+void kdr::MeshArena::Delete()
+{
+  if (this->vertexArray != 0) glDeleteVertexArrays(1, &this->vertexArray);
+  if (this->vertexBuffer != 0) glDeleteBuffers(1, &this->vertexBuffer);
+  if (this->indexBuffer != 0) glDeleteBuffers(1, &this->indexBuffer);
+  this->vertexArray = 0;
+  this->vertexBuffer = 0;
+  this->indexBuffer = 0;
+
+  this->meshes.clear();
+  this->freeMeshes.clear();
+  this->vertices.reset(this->vertices.getCapacity(), 0);
+  this->indices.reset(this->indices.getCapacity(), 0);
+}
+
+float kdr::MeshArena::getFragmentation() const
+{
+  const GLuint freeVertices = this->vertices.getCapacity() - this->vertices.getUsed();
+  if (freeVertices == 0)
+  {
+    return 0.f;
+  }
+  return 1.f - (float)this->vertices.getLargestFree() / freeVertices;
+}
+
+void kdr::MeshArena::_reallocate(const GLuint vertexCapacity, const GLuint indexCapacity, const bool pack)
+{
+  const GLsizeiptr vertexBytes = this->vertexStride;
+
+  GLuint vertexBuffer {0};
+  GLuint indexBuffer {0};
+  glGenBuffers(1, &vertexBuffer);
+  glGenBuffers(1, &indexBuffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * vertexBytes, NULL, GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+
+  // The data is copied on the GPU; indices stay valid because they are relative to their mesh.
+  GLuint nextVertex {0};
+  GLuint nextIndex {0};
+  if (this->vertexBuffer != 0)
+  {
+    glBindBuffer(GL_COPY_READ_BUFFER, this->vertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    if (pack)
+    {
+      for (Range& range : this->meshes)
+      {
+        if (!range.used) continue;
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.firstVertex * vertexBytes, nextVertex * vertexBytes, range.vertexCount * vertexBytes);
+        range.firstVertex = nextVertex;
+        nextVertex += range.vertexCount;
+      }
+    }
+    else
+    {
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, std::min(this->vertices.getCapacity(), vertexCapacity) * vertexBytes);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, this->indexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    if (pack)
+    {
+      for (Range& range : this->meshes)
+      {
+        if (!range.used) continue;
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.firstIndex * sizeof(GLuint), nextIndex * sizeof(GLuint), range.indexCount * sizeof(GLuint));
+        range.firstIndex = nextIndex;
+        nextIndex += range.indexCount;
+      }
+    }
+    else
+    {
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, std::min(this->indices.getCapacity(), indexCapacity) * sizeof(GLuint));
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    glDeleteBuffers(1, &this->vertexBuffer);
+    glDeleteBuffers(1, &this->indexBuffer);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  this->vertexBuffer = vertexBuffer;
+  this->indexBuffer = indexBuffer;
+
+  if (pack)
+  {
+    this->vertices.reset(vertexCapacity, nextVertex);
+    this->indices.reset(indexCapacity, nextIndex);
+    this->freeMeshes.clear();
+    while (!this->meshes.empty() && !this->meshes.back().used)
+    {
+      this->meshes.pop_back();
+    }
+    for (GLuint mesh = 0; mesh < this->meshes.size(); mesh++)
+    {
+      if (!this->meshes[mesh].used) this->freeMeshes.push_back(mesh);
+    }
+  }
+  else
+  {
+    this->vertices.grow(vertexCapacity);
+    this->indices.grow(indexCapacity);
+  }
+
+  // The shared VAO keeps its attribute layout; only the buffers it points at change.
+  if (this->vertexArray == 0)
+  {
+    glGenVertexArrays(1, &this->vertexArray);
+  }
+  glBindVertexArray(this->vertexArray);
+  glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+  for (const Attribute& attribute : this->attributes)
+  {
+    glVertexAttribPointer(attribute.layout, attribute.size, attribute.type, attribute.normalized, vertexBytes, (const void*)(GLintptr)attribute.offset);
+    glEnableVertexAttribArray(attribute.layout);
+  }
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,558 @@
+#include "Kedarium/BVH.hpp"
+
+#include <algorithm>
+
+namespace
+{
+  constexpr int BIN_COUNT {12};
+
+  kdr::Bounds::AABB merge(const kdr::Bounds::AABB& first, const kdr::Bounds::AABB& second)
+  {
+    kdr::Bounds::AABB result {first};
+    result.expand(second);
+    return result;
+  }
+
+  float getAxis(const kdr::Space::Vec3& vec, const int axis)
+  {
+    return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+  }
+}
+
+int kdr::BVH::insert(const kdr::Bounds::AABB& box, void* userData)
+{
+  const int proxy = this->allocateNode();
+  Node& node = this->nodes[proxy];
+  node.box = {
+    box.min - kdr::Space::Vec3 {this->margin},
+    box.max + kdr::Space::Vec3 {this->margin}
+  };
+  node.userData = userData;
+  node.height = 0;
+
+  this->insertLeaf(proxy);
+  this->proxyCount++;
+  return proxy;
+}
+
+void kdr::BVH::remove(const int proxy)
+{
+  this->removeLeaf(proxy);
+  this->freeNode(proxy);
+  this->proxyCount--;
+}
+
+bool kdr::BVH::update(const int proxy, const kdr::Bounds::AABB& box)
+{
+  if (this->nodes[proxy].box.contains(box))
+  {
+    return false;
+  }
+
+  this->removeLeaf(proxy);
+  this->nodes[proxy].box = {
+    box.min - kdr::Space::Vec3 {this->margin},
+    box.max + kdr::Space::Vec3 {this->margin}
+  };
+  this->insertLeaf(proxy);
+  return true;
+}
+
+void kdr::BVH::setBounds(const int proxy, const kdr::Bounds::AABB& box)
+{
+  this->nodes[proxy].box = {
+    box.min - kdr::Space::Vec3 {this->margin},
+    box.max + kdr::Space::Vec3 {this->margin}
+  };
+}
+
+void kdr::BVH::refit()
+{
+  if (this->root == NULL_NODE) return;
+
+  // A pre-order listing visits parents before children, so walking it backwards refits bottom-up.
+  std::vector<int> order;
+  order.reserve(this->nodes.size());
+  order.push_back(this->root);
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    const Node& node = this->nodes[order[i]];
+    if (node.isLeaf()) continue;
+    order.push_back(node.child1);
+    order.push_back(node.child2);
+  }
+
+  for (size_t i = order.size(); i-- > 0;)
+  {
+    Node& node = this->nodes[order[i]];
+    if (node.isLeaf()) continue;
+    node.box = merge(this->nodes[node.child1].box, this->nodes[node.child2].box);
+  }
+}
+
+void kdr::BVH::rebuild()
+{
+  if (this->root == NULL_NODE) return;
+
+  std::vector<int> leaves;
+  leaves.reserve(this->proxyCount);
+  for (int i = 0; i < (int)this->nodes.size(); i++)
+  {
+    const Node& node = this->nodes[i];
+    if (node.height < 0) continue;
+    if (node.isLeaf())
+    {
+      leaves.push_back(i);
+      continue;
+    }
+    this->freeNode(i);
+  }
+
+  this->root = this->buildRange(leaves, 0, leaves.size());
+  this->nodes[this->root].parent = NULL_NODE;
+}
+
+void kdr::BVH::clear()
+{
+  this->nodes.clear();
+  this->root = NULL_NODE;
+  this->freeList = NULL_NODE;
+  this->proxyCount = 0;
+}
+
+void kdr::BVH::queryFrustum(const kdr::Bounds::Frustum& frustum, std::vector<void*>& oResults) const
+{
+  if (this->root == NULL_NODE) return;
+
+  kdr::Bounds::TraversalStack<std::pair<int, unsigned int>> stack;
+  stack.push({this->root, 0x3fu});
+  while (!stack.empty())
+  {
+    auto [index, planeMask] = stack.pop();
+    const Node& node = this->nodes[index];
+    if (kdr::Bounds::classifyAABB(frustum, node.box, planeMask) < 0) continue;
+
+    if (node.isLeaf())
+    {
+      oResults.push_back(node.userData);
+      continue;
+    }
+    stack.push({node.child1, planeMask});
+    stack.push({node.child2, planeMask});
+  }
+}
+
+void kdr::BVH::queryOverlap(const kdr::Bounds::AABB& box, std::vector<void*>& oResults) const
+{
+  if (this->root == NULL_NODE) return;
+
+  kdr::Bounds::TraversalStack<int> stack;
+  stack.push(this->root);
+  while (!stack.empty())
+  {
+    const Node& node = this->nodes[stack.pop()];
+    if (!node.box.overlaps(box)) continue;
+
+    if (node.isLeaf())
+    {
+      oResults.push_back(node.userData);
+      continue;
+    }
+    stack.push(node.child1);
+    stack.push(node.child2);
+  }
+}
+
+float kdr::BVH::queryRay(const kdr::Bounds::Ray& ray, const float maxDistance, const std::function<float(void*, const kdr::Bounds::Ray&, float)>& callback) const
+{
+  float closest {maxDistance};
+  float entry   {0.f};
+  if (this->root == NULL_NODE || !kdr::Bounds::intersectRay(ray, this->nodes[this->root].box, closest, entry)) return closest;
+
+  kdr::Bounds::TraversalStack<std::pair<int, float>> stack;
+  stack.push({this->root, entry});
+  while (!stack.empty())
+  {
+    const auto [index, distance] = stack.pop();
+    if (distance > closest) continue;
+
+    const Node& node = this->nodes[index];
+    if (node.isLeaf())
+    {
+      closest = fminf(closest, callback(node.userData, ray, closest));
+      continue;
+    }
+
+    float distance1 {0.f};
+    float distance2 {0.f};
+    const bool hit1 = kdr::Bounds::intersectRay(ray, this->nodes[node.child1].box, closest, distance1);
+    const bool hit2 = kdr::Bounds::intersectRay(ray, this->nodes[node.child2].box, closest, distance2);
+
+    // The nearer child is pushed last so it is visited first and can shorten the ray early.
+    if (hit1 && hit2)
+    {
+      const bool firstNearer = distance1 <= distance2;
+      stack.push(firstNearer ? std::make_pair(node.child2, distance2) : std::make_pair(node.child1, distance1));
+      stack.push(firstNearer ? std::make_pair(node.child1, distance1) : std::make_pair(node.child2, distance2));
+    }
+    else if (hit1)
+    {
+      stack.push({node.child1, distance1});
+    }
+    else if (hit2)
+    {
+      stack.push({node.child2, distance2});
+    }
+  }
+  return closest;
+}
+
+int kdr::BVH::allocateNode()
+{
+  if (this->freeList == NULL_NODE)
+  {
+    this->nodes.emplace_back();
+    this->nodes.back().height = 0;
+    return (int)this->nodes.size() - 1;
+  }
+
+  const int index = this->freeList;
+  this->freeList = this->nodes[index].parent;
+  this->nodes[index] = Node {};
+  this->nodes[index].height = 0;
+  return index;
+}
+
+void kdr::BVH::freeNode(const int index)
+{
+  Node& node = this->nodes[index];
+  node.parent = this->freeList;
+  node.child1 = NULL_NODE;
+  node.child2 = NULL_NODE;
+  node.userData = NULL;
+  node.height = -1;
+  this->freeList = index;
+}
+
+void kdr::BVH::insertLeaf(const int leaf)
+{
+  if (this->root == NULL_NODE)
+  {
+    this->root = leaf;
+    this->nodes[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // Descend towards the sibling that minimizes the increase in total surface area.
+  const kdr::Bounds::AABB leafBox = this->nodes[leaf].box;
+  int index = this->root;
+  while (!this->nodes[index].isLeaf())
+  {
+    const Node& node = this->nodes[index];
+    const float area = node.box.getSurfaceArea();
+    const float combinedArea = merge(node.box, leafBox).getSurfaceArea();
+
+    const float cost = 2.f * combinedArea;
+    const float inheritanceCost = 2.f * (combinedArea - area);
+
+    float childCosts[2];
+    const int children[2] = {node.child1, node.child2};
+    for (int i = 0; i < 2; i++)
+    {
+      const Node& child = this->nodes[children[i]];
+      const float mergedArea = merge(child.box, leafBox).getSurfaceArea();
+      childCosts[i] = child.isLeaf()
+        ? mergedArea + inheritanceCost
+        : mergedArea - child.box.getSurfaceArea() + inheritanceCost;
+    }
+
+    if (cost < childCosts[0] && cost < childCosts[1]) break;
+    index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+  }
+
+  const int sibling = index;
+  const int oldParent = this->nodes[sibling].parent;
+  const int newParent = this->allocateNode();
+
+  Node& parentNode = this->nodes[newParent];
+  parentNode.parent = oldParent;
+  parentNode.box = merge(leafBox, this->nodes[sibling].box);
+  parentNode.height = this->nodes[sibling].height + 1;
+  parentNode.child1 = sibling;
+  parentNode.child2 = leaf;
+  this->nodes[sibling].parent = newParent;
+  this->nodes[leaf].parent = newParent;
+
+  if (oldParent == NULL_NODE)
+  {
+    this->root = newParent;
+  }
+  else if (this->nodes[oldParent].child1 == sibling)
+  {
+    this->nodes[oldParent].child1 = newParent;
+  }
+  else
+  {
+    this->nodes[oldParent].child2 = newParent;
+  }
+
+  this->fixUpwards(this->nodes[leaf].parent);
+}
+
+void kdr::BVH::removeLeaf(const int leaf)
+{
+  if (leaf == this->root)
+  {
+    this->root = NULL_NODE;
+    return;
+  }
+
+  const int parent = this->nodes[leaf].parent;
+  const int grandParent = this->nodes[parent].parent;
+  const int sibling = this->nodes[parent].child1 == leaf
+    ? this->nodes[parent].child2
+    : this->nodes[parent].child1;
+
+  this->nodes[leaf].parent = NULL_NODE;
+  if (grandParent == NULL_NODE)
+  {
+    this->root = sibling;
+    this->nodes[sibling].parent = NULL_NODE;
+    this->freeNode(parent);
+    return;
+  }
+
+  if (this->nodes[grandParent].child1 == parent)
+  {
+    this->nodes[grandParent].child1 = sibling;
+  }
+  else
+  {
+    this->nodes[grandParent].child2 = sibling;
+  }
+  this->nodes[sibling].parent = grandParent;
+  this->freeNode(parent);
+  this->fixUpwards(grandParent);
+}
+
+void kdr::BVH::fixUpwards(int index)
+{
+  while (index != NULL_NODE)
+  {
+    index = this->balance(index);
+
+    Node& node = this->nodes[index];
+    const Node& child1 = this->nodes[node.child1];
+    const Node& child2 = this->nodes[node.child2];
+    node.height = 1 + std::max(child1.height, child2.height);
+    node.box = merge(child1.box, child2.box);
+
+    index = node.parent;
+  }
+}
+
+int kdr::BVH::balance(const int iA)
+{
+  Node& A = this->nodes[iA];
+  if (A.isLeaf() || A.height < 2)
+  {
+    return iA;
+  }
+
+  const int iB = A.child1;
+  const int iC = A.child2;
+  Node& B = this->nodes[iB];
+  Node& C = this->nodes[iC];
+  const int difference = C.height - B.height;
+
+  // Rotate C up.
+  if (difference > 1)
+  {
+    const int iF = C.child1;
+    const int iG = C.child2;
+    Node& F = this->nodes[iF];
+    Node& G = this->nodes[iG];
+
+    C.child1 = iA;
+    C.parent = A.parent;
+    A.parent = iC;
+
+    if (C.parent == NULL_NODE)
+    {
+      this->root = iC;
+    }
+    else if (this->nodes[C.parent].child1 == iA)
+    {
+      this->nodes[C.parent].child1 = iC;
+    }
+    else
+    {
+      this->nodes[C.parent].child2 = iC;
+    }
+
+    if (F.height > G.height)
+    {
+      C.child2 = iF;
+      A.child2 = iG;
+      G.parent = iA;
+      A.box = merge(B.box, G.box);
+      C.box = merge(A.box, F.box);
+      A.height = 1 + std::max(B.height, G.height);
+      C.height = 1 + std::max(A.height, F.height);
+    }
+    else
+    {
+      C.child2 = iG;
+      A.child2 = iF;
+      F.parent = iA;
+      A.box = merge(B.box, F.box);
+      C.box = merge(A.box, G.box);
+      A.height = 1 + std::max(B.height, F.height);
+      C.height = 1 + std::max(A.height, G.height);
+    }
+    return iC;
+  }
+
+  // Rotate B up.
+  if (difference < -1)
+  {
+    const int iD = B.child1;
+    const int iE = B.child2;
+    Node& D = this->nodes[iD];
+    Node& E = this->nodes[iE];
+
+    B.child1 = iA;
+    B.parent = A.parent;
+    A.parent = iB;
+
+    if (B.parent == NULL_NODE)
+    {
+      this->root = iB;
+    }
+    else if (this->nodes[B.parent].child1 == iA)
+    {
+      this->nodes[B.parent].child1 = iB;
+    }
+    else
+    {
+      this->nodes[B.parent].child2 = iB;
+    }
+
+    if (D.height > E.height)
+    {
+      B.child2 = iD;
+      A.child1 = iE;
+      E.parent = iA;
+      A.box = merge(C.box, E.box);
+      B.box = merge(A.box, D.box);
+      A.height = 1 + std::max(C.height, E.height);
+      B.height = 1 + std::max(A.height, D.height);
+    }
+    else
+    {
+      B.child2 = iE;
+      A.child1 = iD;
+      D.parent = iA;
+      A.box = merge(C.box, D.box);
+      B.box = merge(A.box, E.box);
+      A.height = 1 + std::max(C.height, D.height);
+      B.height = 1 + std::max(A.height, E.height);
+    }
+    return iB;
+  }
+
+  return iA;
+}
+
+int kdr::BVH::buildRange(std::vector<int>& leaves, const size_t begin, const size_t end)
+{
+  if (end - begin == 1)
+  {
+    return leaves[begin];
+  }
+
+  kdr::Bounds::AABB centroidBounds;
+  for (size_t i = begin; i < end; i++)
+  {
+    centroidBounds.expand(this->nodes[leaves[i]].box.getCenter());
+  }
+
+  // Evaluate binned SAH splits along all three axes.
+  int   bestAxis {-1};
+  int   bestSplit {0};
+  float bestCost {FLT_MAX};
+  for (int axis = 0; axis < 3; axis++)
+  {
+    const float axisMin = getAxis(centroidBounds.min, axis);
+    const float axisExtent = getAxis(centroidBounds.max, axis) - axisMin;
+    if (axisExtent <= 0.f) continue;
+
+    kdr::Bounds::AABB binBounds[BIN_COUNT];
+    size_t            binCounts[BIN_COUNT] {};
+    for (size_t i = begin; i < end; i++)
+    {
+      const kdr::Bounds::AABB& box = this->nodes[leaves[i]].box;
+      const int bin = std::min(BIN_COUNT - 1, (int)((getAxis(box.getCenter(), axis) - axisMin) * BIN_COUNT / axisExtent));
+      binBounds[bin].expand(box);
+      binCounts[bin]++;
+    }
+
+    float             rightAreas[BIN_COUNT];
+    size_t            rightCounts[BIN_COUNT];
+    kdr::Bounds::AABB rightBounds;
+    size_t            rightCount {0};
+    for (int bin = BIN_COUNT - 1; bin > 0; bin--)
+    {
+      rightBounds.expand(binBounds[bin]);
+      rightCount += binCounts[bin];
+      rightAreas[bin] = rightBounds.getSurfaceArea();
+      rightCounts[bin] = rightCount;
+    }
+
+    kdr::Bounds::AABB leftBounds;
+    size_t            leftCount {0};
+    for (int bin = 0; bin < BIN_COUNT - 1; bin++)
+    {
+      leftBounds.expand(binBounds[bin]);
+      leftCount += binCounts[bin];
+      if (leftCount == 0 || rightCounts[bin + 1] == 0) continue;
+
+      const float cost = leftCount * leftBounds.getSurfaceArea() + rightCounts[bin + 1] * rightAreas[bin + 1];
+      if (cost < bestCost)
+      {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = bin;
+      }
+    }
+  }
+
+  size_t middle = (begin + end) / 2;
+  if (bestAxis >= 0)
+  {
+    const float axisMin = getAxis(centroidBounds.min, bestAxis);
+    const float axisExtent = getAxis(centroidBounds.max, bestAxis) - axisMin;
+    auto split = std::partition(leaves.begin() + begin, leaves.begin() + end, [&](const int leaf) {
+      const float center = getAxis(this->nodes[leaf].box.getCenter(), bestAxis);
+      return std::min(BIN_COUNT - 1, (int)((center - axisMin) * BIN_COUNT / axisExtent)) <= bestSplit;
+    });
+    middle = split - leaves.begin();
+  }
+  if (middle == begin || middle == end)
+  {
+    middle = (begin + end) / 2;
+  }
+
+  const int left = this->buildRange(leaves, begin, middle);
+  const int right = this->buildRange(leaves, middle, end);
+  const int index = this->allocateNode();
+
+  Node& node = this->nodes[index];
+  node.child1 = left;
+  node.child2 = right;
+  node.box = merge(this->nodes[left].box, this->nodes[right].box);
+  node.height = 1 + std::max(this->nodes[left].height, this->nodes[right].height);
+  this->nodes[left].parent = index;
+  this->nodes[right].parent = index;
+  return index;
+}
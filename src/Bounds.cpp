@@ -0,0 +1,257 @@
+#include "Kedarium/Bounds.hpp"
+
+kdr::Bounds::AABB kdr::Bounds::fromVertices(const float* vertices, const size_t vertexCount, const size_t stride)
+{
+  kdr::Bounds::AABB box;
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    const float* vertex = vertices + i * stride;
+    box.expand({vertex[0], vertex[1], vertex[2]});
+  }
+  return box;
+}
+
+kdr::Bounds::Sphere kdr::Bounds::sphereFromVertices(const float* vertices, const size_t vertexCount, const size_t stride, const kdr::Bounds::AABB& box)
+{
+  kdr::Space::Vec3 center = box.getCenter();
+  float radiusSquared {0.f};
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    const float* vertex = vertices + i * stride;
+    kdr::Space::Vec3 offset {
+      vertex[0] - center.x,
+      vertex[1] - center.y,
+      vertex[2] - center.z
+    };
+    radiusSquared = fmaxf(radiusSquared, kdr::Space::dot(offset, offset));
+  }
+  return kdr::Bounds::Sphere {center, sqrtf(radiusSquared)};
+}
+
+kdr::Bounds::AABB kdr::Bounds::transform(const kdr::Bounds::AABB& box, const kdr::Space::Mat4& mat)
+{
+  if (!box.isValid()) return box;
+
+  const kdr::Space::Vec3 center = box.getCenter();
+  const kdr::Space::Vec3 extents = box.getExtents();
+  const float localCenter[3] = {center.x, center.y, center.z};
+  const float localExtents[3] = {extents.x, extents.y, extents.z};
+
+  float worldCenter[3];
+  float worldExtents[3];
+  for (int row = 0; row < 3; row++)
+  {
+    worldCenter[row] = mat[3][row];
+    worldExtents[row] = 0.f;
+    for (int column = 0; column < 3; column++)
+    {
+      worldCenter[row] += mat[column][row] * localCenter[column];
+      worldExtents[row] += fabsf(mat[column][row]) * localExtents[column];
+    }
+  }
+
+  return kdr::Bounds::AABB {
+    {worldCenter[0] - worldExtents[0], worldCenter[1] - worldExtents[1], worldCenter[2] - worldExtents[2]},
+    {worldCenter[0] + worldExtents[0], worldCenter[1] + worldExtents[1], worldCenter[2] + worldExtents[2]}
+  };
+}
+
+kdr::Bounds::Sphere kdr::Bounds::transform(const kdr::Bounds::Sphere& sphere, const kdr::Space::Mat4& mat)
+{
+  float maxScaleSquared {0.f};
+  for (int column = 0; column < 3; column++)
+  {
+    const float scaleSquared =
+      mat[column][0] * mat[column][0] +
+      mat[column][1] * mat[column][1] +
+      mat[column][2] * mat[column][2];
+    maxScaleSquared = fmaxf(maxScaleSquared, scaleSquared);
+  }
+
+  const kdr::Space::Vec3& center = sphere.center;
+  return kdr::Bounds::Sphere {
+    {
+      mat[0][0] * center.x + mat[1][0] * center.y + mat[2][0] * center.z + mat[3][0],
+      mat[0][1] * center.x + mat[1][1] * center.y + mat[2][1] * center.z + mat[3][1],
+      mat[0][2] * center.x + mat[1][2] * center.y + mat[2][2] * center.z + mat[3][2]
+    },
+    sphere.radius * sqrtf(maxScaleSquared)
+  };
+}
+
+kdr::Bounds::Frustum kdr::Bounds::extractFrustum(const kdr::Space::Mat4& mat)
+{
+  // Gribb-Hartmann: each plane is the fourth row of the matrix plus or minus one of the others.
+  // The matrix is stored column-major, so row r is (mat[0][r], mat[1][r], mat[2][r], mat[3][r]).
+  kdr::Bounds::Frustum frustum;
+  for (int plane = 0; plane < 6; plane++)
+  {
+    const int   row  = plane / 2;
+    const float sign = plane % 2 == 0 ? 1.f : -1.f;
+    for (int column = 0; column < 4; column++)
+    {
+      frustum.planes[plane][column] = mat[column][3] + sign * mat[column][row];
+    }
+
+    const float length = sqrtf(
+      frustum.planes[plane][0] * frustum.planes[plane][0] +
+      frustum.planes[plane][1] * frustum.planes[plane][1] +
+      frustum.planes[plane][2] * frustum.planes[plane][2]
+    );
+    if (length == 0.f) continue;
+    for (int column = 0; column < 4; column++)
+    {
+      frustum.planes[plane][column] /= length;
+    }
+  }
+  return frustum;
+}
+
+bool kdr::Bounds::testAABB(const kdr::Bounds::Frustum& frustum, const kdr::Bounds::AABB& box)
+{
+  const kdr::Space::Vec3 center = box.getCenter();
+  const kdr::Space::Vec3 extents = box.getExtents();
+  for (int i = 0; i < 6; i++)
+  {
+    const float* plane = frustum.planes[i];
+    const float distance = plane[0] * center.x + plane[1] * center.y + plane[2] * center.z + plane[3];
+    const float radius = fabsf(plane[0]) * extents.x + fabsf(plane[1]) * extents.y + fabsf(plane[2]) * extents.z;
+    if (distance + radius < 0.f) return false;
+  }
+  return true;
+}
+
+kdr::Bounds::Frustum kdr::Bounds::toModelSpace(const kdr::Bounds::Frustum& frustum, const kdr::Space::Mat4& model)
+{
+  // A plane p tests world points M * x, which is the plane p * M tested against model points x.
+  kdr::Bounds::Frustum result;
+  for (int i = 0; i < 6; i++)
+  {
+    const float* plane = frustum.planes[i];
+    float* local = result.planes[i];
+    for (int column = 0; column < 4; column++)
+    {
+      local[column] = plane[0] * model[column][0] + plane[1] * model[column][1] + plane[2] * model[column][2] + plane[3] * model[column][3];
+    }
+    const float length = sqrtf(local[0] * local[0] + local[1] * local[1] + local[2] * local[2]);
+    if (length > 0.f)
+    {
+      for (int component = 0; component < 4; component++)
+      {
+        local[component] /= length;
+      }
+    }
+  }
+  return result;
+}
+
+bool kdr::Bounds::testSphere(const kdr::Bounds::Frustum& frustum, const kdr::Bounds::Sphere& sphere)
+{
+  for (int i = 0; i < 6; i++)
+  {
+    const float* plane = frustum.planes[i];
+    const float distance = plane[0] * sphere.center.x + plane[1] * sphere.center.y + plane[2] * sphere.center.z + plane[3];
+    if (distance < -sphere.radius) return false;
+  }
+  return true;
+}
+
+int kdr::Bounds::classifyAABB(const kdr::Bounds::Frustum& frustum, const kdr::Bounds::AABB& box, unsigned int& ioPlaneMask)
+{
+  const kdr::Space::Vec3 center = box.getCenter();
+  const kdr::Space::Vec3 extents = box.getExtents();
+  for (int i = 0; i < 6; i++)
+  {
+    if ((ioPlaneMask & (1u << i)) == 0) continue;
+
+    const float* plane = frustum.planes[i];
+    const float distance = plane[0] * center.x + plane[1] * center.y + plane[2] * center.z + plane[3];
+    const float radius = fabsf(plane[0]) * extents.x + fabsf(plane[1]) * extents.y + fabsf(plane[2]) * extents.z;
+    if (distance + radius < 0.f) return -1;
+    if (distance - radius >= 0.f) ioPlaneMask &= ~(1u << i);
+  }
+  return ioPlaneMask == 0 ? 1 : 0;
+}
+
+bool kdr::Bounds::intersectRay(const kdr::Bounds::Ray& ray, const kdr::Bounds::AABB& box, const float maxDistance, float& oDistance)
+{
+  const float tx1 = (box.min.x - ray.origin.x) * ray.inverseDirection.x;
+  const float tx2 = (box.max.x - ray.origin.x) * ray.inverseDirection.x;
+  const float ty1 = (box.min.y - ray.origin.y) * ray.inverseDirection.y;
+  const float ty2 = (box.max.y - ray.origin.y) * ray.inverseDirection.y;
+  const float tz1 = (box.min.z - ray.origin.z) * ray.inverseDirection.z;
+  const float tz2 = (box.max.z - ray.origin.z) * ray.inverseDirection.z;
+
+  // fminf/fmaxf drop the NaNs produced by 0 * inf when the origin lies on a slab.
+  const float tNear = fmaxf(fmaxf(fminf(tx1, tx2), fminf(ty1, ty2)), fmaxf(fminf(tz1, tz2), 0.f));
+  const float tFar  = fminf(fminf(fmaxf(tx1, tx2), fmaxf(ty1, ty2)), fminf(fmaxf(tz1, tz2), maxDistance));
+  if (tNear > tFar) return false;
+
+  oDistance = tNear;
+  return true;
+}
+
+size_t kdr::Bounds::cullAABBs(const kdr::Bounds::Frustum& frustum, const kdr::Bounds::AABB* boxes, const size_t count, unsigned char* oVisible)
+{
+  size_t visibleCount {0};
+  size_t i {0};
+
+#ifdef KDR_SIMD_SSE
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+  for (; i + kdr::SIMD::WIDTH <= count; i += kdr::SIMD::WIDTH)
+  {
+    const kdr::Bounds::AABB* b = boxes + i;
+    const __m128 minX = _mm_setr_ps(b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x);
+    const __m128 minY = _mm_setr_ps(b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y);
+    const __m128 minZ = _mm_setr_ps(b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z);
+    const __m128 maxX = _mm_setr_ps(b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x);
+    const __m128 maxY = _mm_setr_ps(b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y);
+    const __m128 maxZ = _mm_setr_ps(b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z);
+
+    const __m128 centerX = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+    const __m128 centerY = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+    const __m128 centerZ = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+    const __m128 extentX = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+    const __m128 extentY = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+    const __m128 extentZ = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+    __m128 outside = _mm_setzero_ps();
+    for (int p = 0; p < 6; p++)
+    {
+      const float* plane = frustum.planes[p];
+      const __m128 a = _mm_set1_ps(plane[0]);
+      const __m128 bb = _mm_set1_ps(plane[1]);
+      const __m128 c = _mm_set1_ps(plane[2]);
+      const __m128 d = _mm_set1_ps(plane[3]);
+
+      const __m128 distance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(a, centerX), _mm_mul_ps(bb, centerY)),
+        _mm_add_ps(_mm_mul_ps(c, centerZ), d)
+      );
+      const __m128 radius = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_and_ps(a, absMask), extentX), _mm_mul_ps(_mm_and_ps(bb, absMask), extentY)),
+        _mm_mul_ps(_mm_and_ps(c, absMask), extentZ)
+      );
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+    }
+
+    const int outsideMask = _mm_movemask_ps(outside);
+    for (unsigned int lane = 0; lane < kdr::SIMD::WIDTH; lane++)
+    {
+      const unsigned char visible = (outsideMask & (1 << lane)) == 0;
+      oVisible[i + lane] = visible;
+      visibleCount += visible;
+    }
+  }
+#endif
+
+  for (; i < count; i++)
+  {
+    const unsigned char visible = kdr::Bounds::testAABB(frustum, boxes[i]);
+    oVisible[i] = visible;
+    visibleCount += visible;
+  }
+  return visibleCount;
+}
@@ -111,6 +111,7 @@ void kdr::Camera::updateMatrix3D()
   );
 
   this->matrix = projection * view;
+  this->frustum = kdr::Bounds::extractFrustum(this->matrix);
 }
 
 void kdr::Camera::applyMatrix(const GLuint shaderID, const std::string& uniformName)
@@ -118,3 +119,33 @@ void kdr::Camera::applyMatrix(const GLuint shaderID, const std::string& uniformN
   GLuint matrixLoc = glGetUniformLocation(shaderID, uniformName.c_str());
   glUniformMatrix4fv(matrixLoc, 1, GL_FALSE, kdr::Space::valuePointer(this->matrix));
 }
+
+void kdr::CameraPath::apply(kdr::Camera& camera, const float time) const
+{
+  if (this->keyframes.empty())
+  {
+    return;
+  }
+
+  size_t next = 0;
+  while (next < this->keyframes.size() && this->keyframes[next].time <= time)
+  {
+    next++;
+  }
+  if (next == 0 || next == this->keyframes.size())
+  {
+    const Keyframe& keyframe = this->keyframes[next == 0 ? 0 : next - 1];
+    camera.setPosition(keyframe.position);
+    camera.setYaw(keyframe.yaw);
+    camera.setPitch(keyframe.pitch);
+    return;
+  }
+
+  const Keyframe& from = this->keyframes[next - 1];
+  const Keyframe& to = this->keyframes[next];
+  const float t = (time - from.time) / (to.time - from.time);
+
+  camera.setPosition(from.position + (to.position - from.position) * t);
+  camera.setYaw(from.yaw + (to.yaw - from.yaw) * t);
+  camera.setPitch(from.pitch + (to.pitch - from.pitch) * t);
+}
@@ -0,0 +1,209 @@
+#include "Kedarium/Capture.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+bool kdr::FrameCapture::start(const std::string& pathPrefix, const int width, const int height, const unsigned int ringSize, const unsigned int queueSize)
+{
+  if (this->active)
+  {
+    this->stop();
+  }
+  if (width <= 0 || height <= 0 || ringSize == 0 || queueSize == 0)
+  {
+    std::cerr << "Invalid frame capture size!\n";
+    return false;
+  }
+
+  this->pathPrefix = pathPrefix;
+  this->width = width;
+  this->height = height;
+  this->frameCount = 0;
+  this->stallCount = 0;
+  this->nextSlot = 0;
+  this->queueSize = queueSize;
+  this->queueStallCount = 0;
+
+  const GLsizeiptr frameBytes = (GLsizeiptr)width * height * 4;
+  this->slots.resize(ringSize);
+  for (Slot& slot : this->slots)
+  {
+    glGenBuffers(1, &slot.PBO);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+    glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  // PNG encoding is far slower than a readback, so several encoders keep up with the frame rate.
+  const unsigned int encoderCount = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+  this->stopping = false;
+  for (unsigned int i = 0; i < encoderCount; i++)
+  {
+    this->encoders.emplace_back(&kdr::FrameCapture::_encode, this);
+  }
+
+  this->active = true;
+  return true;
+}
+
+void kdr::FrameCapture::capture(const GLenum readBuffer)
+{
+  if (!this->active)
+  {
+    return;
+  }
+
+  // Read back every slot the GPU has already finished, oldest first, then make room for
+  // this frame, waiting only if the ring has wrapped around onto an unfinished frame.
+  for (size_t i = 0; i < this->slots.size(); i++)
+  {
+    Slot& slot = this->slots[(this->nextSlot + i) % this->slots.size()];
+    if (slot.pending && !this->_readSlot(slot, false))
+    {
+      break;
+    }
+  }
+  Slot& slot = this->slots[this->nextSlot];
+  if (slot.pending)
+  {
+    this->stallCount++;
+    this->_readSlot(slot, true);
+  }
+
+  glReadBuffer(readBuffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+  glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.frame = this->frameCount++;
+  slot.pending = true;
+  this->nextSlot = (this->nextSlot + 1) % this->slots.size();
+}
+
+void kdr::FrameCapture::stop()
+{
+  if (!this->active)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < this->slots.size(); i++)
+  {
+    Slot& slot = this->slots[(this->nextSlot + i) % this->slots.size()];
+    if (slot.pending)
+    {
+      this->_readSlot(slot, true);
+    }
+  }
+  for (Slot& slot : this->slots)
+  {
+    glDeleteBuffers(1, &slot.PBO);
+  }
+  this->slots.clear();
+
+  this->_stopEncoders();
+  this->active = false;
+}
+
+bool kdr::FrameCapture::_readSlot(Slot& slot, const bool wait)
+{
+  // Only this thread adds to the queue, so it cannot fill up again after the check.
+  {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (this->jobs.size() >= this->queueSize)
+    {
+      if (!wait)
+      {
+        return false;
+      }
+      this->queueStallCount++;
+      this->queueSpace.wait(lock, [this] { return this->jobs.size() < this->queueSize; });
+    }
+  }
+
+  const GLuint64 timeout = wait ? GL_TIMEOUT_IGNORED : 0;
+  const GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+  if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+  {
+    return false;
+  }
+  glDeleteSync(slot.fence);
+  slot.fence = NULL;
+  slot.pending = false;
+
+  Job job;
+  job.frame = slot.frame;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->bufferPool.empty())
+    {
+      job.pixels = std::move(this->bufferPool.back());
+      this->bufferPool.pop_back();
+    }
+  }
+  job.pixels.resize((size_t)this->width * this->height * 4);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+  const GLubyte* pixels = (const GLubyte*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, job.pixels.size(), GL_MAP_READ_BIT);
+  if (pixels != NULL)
+  {
+    std::copy(pixels, pixels + job.pixels.size(), job.pixels.begin());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (pixels == NULL)
+  {
+    std::cerr << "Failed to map captured frame " << slot.frame << "!\n";
+    return true;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->jobs.push_back(std::move(job));
+  }
+  this->condition.notify_one();
+  return true;
+}
+
+void kdr::FrameCapture::_encode()
+{
+  while (true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(lock, [this] { return this->stopping || !this->jobs.empty(); });
+      if (this->jobs.empty())
+      {
+        return;
+      }
+      job = std::move(this->jobs.front());
+      this->jobs.pop_front();
+    }
+    this->queueSpace.notify_one();
+
+    char number[16];
+    snprintf(number, sizeof(number), "%06u", job.frame);
+    kdr::Image::saveToPNG(this->pathPrefix + number + ".png", job.pixels.data(), this->width, this->height, true, 1);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->bufferPool.push_back(std::move(job.pixels));
+  }
+}
+
+void kdr::FrameCapture::_stopEncoders()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->condition.notify_all();
+  for (std::thread& encoder : this->encoders)
+  {
+    encoder.join();
+  }
+  this->encoders.clear();
+  this->bufferPool.clear();
+}
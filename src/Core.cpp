@@ -1,5 +1,7 @@
 #include "Kedarium/Core.hpp"
 
+#include <cstdlib>
+
 void kdr::Core::printEngineInfo()
 {
   std::cout << kdr::Constants::ENGINE_NAME << " " << kdr::Constants::ENGINE_VERSION << '\n';
@@ -14,21 +16,49 @@ void kdr::Core::printVersionInfo()
   std::cout << "GLFW:   " << glfwGetVersionString() << '\n';
 }
 
-bool kdr::Core::initializeGlfw()
+bool kdr::Core::initializeGlfw(const bool headless)
 {
-  glfwInit();
+#ifdef GLFW_PLATFORM_NULL
+  if (headless && getenv("DISPLAY") == NULL && getenv("WAYLAND_DISPLAY") == NULL)
+  {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
+#endif
+  if (glfwInit() == GLFW_FALSE)
+  {
+    std::cerr << "Failed to initialize GLFW!\n";
+    return false;
+  }
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_SAMPLES, 4);
 
+  if (headless)
+  {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef GLFW_PLATFORM_NULL
+    if (glfwGetPlatform() == GLFW_PLATFORM_NULL)
+    {
+      glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    }
+#endif
+  }
+
   return true;
 }
 
 bool kdr::Core::initializeGlew()
 {
   GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+  // GLEW reports this for EGL contexts after the core entry points were already loaded.
+  if (err == GLEW_ERROR_NO_GLX_DISPLAY)
+  {
+    err = GLEW_OK;
+  }
+#endif
   if (err != GLEW_OK)
   {
     std::cerr << "Failed to initialize GLEW!\n";
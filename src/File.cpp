@@ -1,5 +1,7 @@
 #include "Kedarium/File.hpp"
 
+#include <filesystem>
+
 std::string kdr::File::getContents(const std::string& path)
 {
   std::ifstream file(path);
@@ -12,3 +14,35 @@ std::string kdr::File::getContents(const std::string& path)
   buffer << file.rdbuf();
   return buffer.str();
 }
+
+bool kdr::File::readBinary(const std::string& path, std::vector<char>& oData)
+{
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open())
+  {
+    return false;
+  }
+  const std::streamsize size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  oData.resize(size);
+  return (bool)file.read(oData.data(), size);
+}
+
+bool kdr::File::writeBinary(const std::string& path, const void* data, const size_t size)
+{
+  const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+  std::error_code error;
+  if (!parent.empty())
+  {
+    std::filesystem::create_directories(parent, error);
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+  {
+    std::cerr << "Failed to open file (\"" << path << "\") for writing!" << '\n';
+    return false;
+  }
+  file.write((const char*)data, size);
+  return file.good();
+}
@@ -14,25 +14,24 @@ kdr::GUI::Element::Element(const kdr::Space::Vec2& position, float width, const
     width,  0.f,    1.f, 1.f, // 3 11
   };
 
-  this->VAO = new kdr::Graphics::VAO();
-  this->VBO = new kdr::Graphics::VBO(elementVertices, sizeof(elementVertices));
-  this->EBO = new kdr::Graphics::EBO(elementIndices, sizeof(elementIndices));
+  this->VBO = kdr::Graphics::VBO(elementVertices, sizeof(elementVertices));
+  this->EBO = kdr::Graphics::EBO(elementIndices, sizeof(elementIndices));
 
-  this->VAO->Bind();
-  this->VBO->Bind();
-  this->EBO->Bind();
+  this->VAO.Bind();
+  this->VBO.Bind();
+  this->EBO.Bind();
 
-  this->VAO->LinkAttrib(*VBO, 0, 2, GL_FLOAT, 4 * sizeof(GLfloat), (void*)0);
-  this->VAO->LinkAttrib(*VBO, 1, 2, GL_FLOAT, 4 * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
+  this->VAO.LinkAttrib(this->VBO, 0, 2, GL_FLOAT, 4 * sizeof(GLfloat), (void*)0);
+  this->VAO.LinkAttrib(this->VBO, 1, 2, GL_FLOAT, 4 * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
 
-  this->VAO->Unbind();
-  this->VBO->Unbind();
-  this->EBO->Unbind();
+  this->VAO.Unbind();
+  this->VBO.Unbind();
+  this->EBO.Unbind();
 }
 
 void kdr::GUI::Element::render() const
 {
-  this->VAO->Bind();
+  this->VAO.Bind();
   glDrawElements(GL_TRIANGLES, sizeof(elementIndices) / sizeof(GLuint), GL_UNSIGNED_INT, NULL);
-  this->VAO->Unbind();
+  this->VAO.Unbind();
 }
@@ -1,49 +1,295 @@
 #include "Kedarium/Graphics.hpp"
 
-kdr::Graphics::Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath)
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+  /**
+   * @brief Header stored in front of every cached program binary.
+   */
+  struct ProgramBinaryHeader
+  {
+    char     magic[4] {'K', 'D', 'R', 'P'};
+    uint32_t version  {1};
+    uint32_t format   {0};
+    uint32_t length   {0};
+  };
+
+  std::string shaderCacheDirectory;
+
+  /**
+   * @brief Feeds a string into a 64-bit FNV-1a hash.
+   *
+   * @param hash The running hash.
+   * @param text The string to hash, followed by a terminating zero byte.
+   * @return The updated hash.
+   */
+  uint64_t hashString(uint64_t hash, const char* text)
+  {
+    do
+    {
+      hash ^= (unsigned char)*text;
+      hash *= 1099511628211ull;
+    } while (*text++ != '\0');
+    return hash;
+  }
+
+  /**
+   * @brief Checks if the driver can save and load program binaries.
+   *
+   * @return True if program binaries are supported, false otherwise.
+   */
+  bool supportsProgramBinaries()
+  {
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+    {
+      return false;
+    }
+    GLint formatCount {0};
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+  }
+
+  /**
+   * @brief Lets the driver use as many compiler threads as it wants, once per process.
+   */
+  void enableParallelCompile()
+  {
+    static bool enabled {false};
+    if (enabled || !GLEW_KHR_parallel_shader_compile)
+    {
+      return;
+    }
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    enabled = true;
+  }
+
+  /**
+   * @brief Appends a source file to a preprocessed shader, expanding its includes.
+   *
+   * @param path The file path to the source.
+   * @param ioIncluded The canonical paths of the files included so far.
+   * @param oSource The string receiving the expanded source.
+   * @return True if the file and all of its includes were loaded, false otherwise.
+   */
+  bool expandIncludes(const std::filesystem::path& path, std::set<std::string>& ioIncluded, std::string& oSource)
+  {
+    std::error_code error;
+    const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    if (!ioIncluded.insert((error ? path : canonical).string()).second)
+    {
+      return true;
+    }
+
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+      std::cerr << "Failed to open file (\"" << path.string() << "\")!" << '\n';
+      return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+      const size_t hash = line.find_first_not_of(" \t");
+      if (hash != std::string::npos && line[hash] == '#')
+      {
+        const size_t directive = line.find_first_not_of(" \t", hash + 1);
+        if (directive != std::string::npos && line.compare(directive, 7, "include") == 0)
+        {
+          const size_t open = line.find('"', directive + 7);
+          const size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+          if (close == std::string::npos)
+          {
+            std::cerr << "Malformed include in \"" << path.string() << "\": " << line << '\n';
+            return false;
+          }
+          if (!expandIncludes(path.parent_path() / line.substr(open + 1, close - open - 1), ioIncluded, oSource))
+          {
+            return false;
+          }
+          continue;
+        }
+      }
+      oSource += line;
+      oSource += '\n';
+    }
+    return true;
+  }
+}
+
+std::string kdr::Graphics::preprocessShader(const std::string& path, const std::vector<std::string>& defines, std::vector<std::string>* oDependencies)
 {
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  std::set<std::string> included;
+  std::string source;
+  const bool loaded = expandIncludes(path, included, source);
+  if (oDependencies != NULL)
+  {
+    oDependencies->assign(included.begin(), included.end());
+  }
+  if (!loaded)
+  {
+    return "";
+  }
+  if (defines.empty())
+  {
+    return source;
+  }
+
+  std::string injected;
+  for (const std::string& define : defines)
+  {
+    injected += "#define " + define + "\n";
+  }
 
-  std::string vertexShaderString = kdr::File::getContents(vertexPath);
-  std::string fragmentShaderString = kdr::File::getContents(fragmentPath);
+  // The #version directive must stay first, so the defines go right after it.
+  size_t insertAt = 0;
+  const size_t version = source.find("#version");
+  if (version != std::string::npos)
+  {
+    const size_t lineEnd = source.find('\n', version);
+    insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+  }
+  source.insert(insertAt, injected);
+  return source;
+}
 
-  const char* vertexShaderSource = vertexShaderString.c_str();
-  const char* fragmentShaderSource = fragmentShaderString.c_str();
+void kdr::Graphics::setShaderCacheDirectory(const std::string& directory)
+{
+  shaderCacheDirectory = directory;
+}
 
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(vertexShader);
-  glCompileShader(fragmentShader);
+const std::string& kdr::Graphics::getShaderCacheDirectory()
+{
+  return shaderCacheDirectory;
+}
+
+kdr::Graphics::Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines, const bool deferred)
+: vertexPath(vertexPath), fragmentPath(fragmentPath), loadStart(std::chrono::steady_clock::now())
+{
+  std::string vertexShaderString = kdr::Graphics::preprocessShader(vertexPath, defines);
+  std::string fragmentShaderString = kdr::Graphics::preprocessShader(fragmentPath, defines);
+  this->_load(vertexShaderString, fragmentShaderString, deferred);
+}
+
+kdr::Graphics::Shader kdr::Graphics::Shader::fromSources(const std::string& vertexSource, const std::string& fragmentSource, const std::string& vertexPath, const std::string& fragmentPath, const bool deferred)
+{
+  kdr::Graphics::Shader shader;
+  shader.vertexPath = vertexPath;
+  shader.fragmentPath = fragmentPath;
+  shader.loadStart = std::chrono::steady_clock::now();
+  shader._load(vertexSource, fragmentSource, deferred);
+  return shader;
+}
+
+kdr::Graphics::Shader& kdr::Graphics::Shader::operator=(kdr::Graphics::Shader&& other) noexcept
+{
+  if (this != &other)
+  {
+    this->Delete();
+    this->ID = std::exchange(other.ID, 0);
+    this->loadMilliseconds = other.loadMilliseconds;
+    this->fromCache = other.fromCache;
+    this->linked = std::exchange(other.linked, false);
+    this->vertexShader = std::exchange(other.vertexShader, 0);
+    this->fragmentShader = std::exchange(other.fragmentShader, 0);
+    this->pending = std::exchange(other.pending, false);
+    this->vertexPath = std::move(other.vertexPath);
+    this->fragmentPath = std::move(other.fragmentPath);
+    this->cachePath = std::move(other.cachePath);
+    this->loadStart = other.loadStart;
+  }
+  return *this;
+}
+
+void kdr::Graphics::Shader::Delete()
+{
+  if (this->vertexShader != 0) glDeleteShader(this->vertexShader);
+  if (this->fragmentShader != 0) glDeleteShader(this->fragmentShader);
+  if (this->ID != 0) glDeleteProgram(this->ID);
+  this->ID = 0;
+  this->vertexShader = 0;
+  this->fragmentShader = 0;
+  this->pending = false;
+  this->linked = false;
+}
+
+void kdr::Graphics::Shader::_load(const std::string& vertexSource, const std::string& fragmentSource, const bool deferred)
+{
+  if (!shaderCacheDirectory.empty() && supportsProgramBinaries())
+  {
+    uint64_t hash {14695981039346656037ull};
+    hash = hashString(hash, vertexSource.c_str());
+    hash = hashString(hash, fragmentSource.c_str());
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+    this->cachePath = shaderCacheDirectory + "/" + name;
+  }
+
+  this->fromCache = !this->cachePath.empty() && this->_loadBinary(this->cachePath);
+  if (this->fromCache)
+  {
+    this->linked = true;
+    this->loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->loadStart).count();
+    return;
+  }
+
+  this->_compile(vertexSource, fragmentSource);
+  if (!deferred)
+  {
+    this->finalize();
+  }
+}
+
+bool kdr::Graphics::Shader::isReady() const
+{
+  if (!this->pending || !GLEW_KHR_parallel_shader_compile)
+  {
+    return true;
+  }
+  GLint complete {GL_FALSE};
+  glGetProgramiv(this->ID, GL_COMPLETION_STATUS_KHR, &complete);
+  return complete == GL_TRUE;
+}
+
+bool kdr::Graphics::Shader::finalize()
+{
+  if (!this->pending)
+  {
+    return this->linked;
+  }
+  this->pending = false;
 
   // Info Log
   char infoLog[512];
   int success {0};
 
   // Vertex Shader Validation
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+  glGetShaderiv(this->vertexShader, GL_COMPILE_STATUS, &success);
   if (!success)
   {
-    glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-    std::cerr << "Failed to compile the vertex shader (\"" << vertexPath << "\")!\n";
+    glGetShaderInfoLog(this->vertexShader, 512, NULL, infoLog);
+    std::cerr << "Failed to compile the vertex shader (\"" << this->vertexPath << "\")!\n";
     std::cerr << "Error:\n" << infoLog << "\n";
   }
 
   // Fragment Shader Validation
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+  glGetShaderiv(this->fragmentShader, GL_COMPILE_STATUS, &success);
   if (!success)
   {
-    glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-    std::cerr << "Failed to compile the fragment shader (\"" << fragmentPath << "\")!\n";
+    glGetShaderInfoLog(this->fragmentShader, 512, NULL, infoLog);
+    std::cerr << "Failed to compile the fragment shader (\"" << this->fragmentPath << "\")!\n";
     std::cerr << "Error:\n" << infoLog << "\n";
   }
 
-  // Shader Program
-  this->ID = glCreateProgram();
-  glAttachShader(this->ID, vertexShader);
-  glAttachShader(this->ID, fragmentShader);
-  glLinkProgram(this->ID);
-
   // Shader Program Validation
   glGetProgramiv(this->ID, GL_LINK_STATUS, &success);
   if (!success)
@@ -52,10 +298,98 @@ kdr::Graphics::Shader::Shader(const std::string& vertexPath, const std::string&
     std::cerr << "Failed to link the shader program!\n";
     std::cerr << "Error:\n" << infoLog << "\n";
   }
+  this->linked = success;
 
   // Deleting the Shaders
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
+  glDeleteShader(this->vertexShader);
+  glDeleteShader(this->fragmentShader);
+  this->vertexShader = 0;
+  this->fragmentShader = 0;
+
+  if (this->linked && !this->cachePath.empty())
+  {
+    this->_saveBinary(this->cachePath);
+  }
+  this->loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->loadStart).count();
+  return this->linked;
+}
+
+void kdr::Graphics::Shader::_compile(const std::string& vertexSource, const std::string& fragmentSource)
+{
+  enableParallelCompile();
+
+  this->vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  this->fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+
+  const char* vertexShaderSource = vertexSource.c_str();
+  const char* fragmentShaderSource = fragmentSource.c_str();
+
+  glShaderSource(this->vertexShader, 1, &vertexShaderSource, NULL);
+  glShaderSource(this->fragmentShader, 1, &fragmentShaderSource, NULL);
+  glCompileShader(this->vertexShader);
+  glCompileShader(this->fragmentShader);
+
+  // Shader Program
+  this->ID = glCreateProgram();
+  if (!this->cachePath.empty())
+  {
+    glProgramParameteri(this->ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+  glAttachShader(this->ID, this->vertexShader);
+  glAttachShader(this->ID, this->fragmentShader);
+  glLinkProgram(this->ID);
+  this->pending = true;
+}
+
+bool kdr::Graphics::Shader::_loadBinary(const std::string& cachePath)
+{
+  std::vector<char> data;
+  if (!kdr::File::readBinary(cachePath, data) || data.size() < sizeof(ProgramBinaryHeader))
+  {
+    return false;
+  }
+
+  ProgramBinaryHeader header;
+  const ProgramBinaryHeader expected;
+  memcpy(&header, data.data(), sizeof(header));
+  if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version || header.length != data.size() - sizeof(header))
+  {
+    return false;
+  }
+
+  this->ID = glCreateProgram();
+  glProgramBinary(this->ID, header.format, data.data() + sizeof(header), header.length);
+
+  // Drivers reject binaries from other builds here, in which case the program is compiled instead.
+  int success {0};
+  glGetProgramiv(this->ID, GL_LINK_STATUS, &success);
+  if (!success)
+  {
+    glDeleteProgram(this->ID);
+    this->ID = 0;
+    return false;
+  }
+  return true;
+}
+
+void kdr::Graphics::Shader::_saveBinary(const std::string& cachePath) const
+{
+  GLint length {0};
+  glGetProgramiv(this->ID, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+  {
+    return;
+  }
+
+  ProgramBinaryHeader header;
+  std::vector<char> data(sizeof(header) + length);
+  GLenum format {0};
+  glGetProgramBinary(this->ID, length, NULL, &format, data.data() + sizeof(header));
+  header.format = format;
+  header.length = length;
+  memcpy(data.data(), &header, sizeof(header));
+
+  kdr::File::writeBinary(cachePath, data.data(), data.size());
 }
 
 kdr::Graphics::VBO::VBO(GLfloat vertices[], GLsizeiptr size)
@@ -98,6 +432,17 @@ kdr::Graphics::Texture::Texture(const std::string& pngPath, GLenum type, GLenum
   );
   if (!imgData) return;
 
+  this->_upload(imgData, imgWidth, imgHeight, hasAlpha, slot, pixelType);
+  free(imgData);
+}
+
+kdr::Graphics::Texture::Texture(const GLubyte* data, const int width, const int height, const bool hasAlpha, GLenum type, GLenum slot, GLenum pixelType) : type(type)
+{
+  this->_upload(data, width, height, hasAlpha, slot, pixelType);
+}
+
+void kdr::Graphics::Texture::_upload(const GLubyte* data, const int width, const int height, const bool hasAlpha, GLenum slot, GLenum pixelType)
+{
   glGenTextures(1, &this->ID);
   glActiveTexture(slot);
   this->Bind();
@@ -110,16 +455,59 @@ kdr::Graphics::Texture::Texture(const std::string& pngPath, GLenum type, GLenum
     this->type,
     0,
     GL_RGBA,
-    imgWidth,
-    imgHeight,
+    width,
+    height,
     0,
     hasAlpha ? GL_RGBA : GL_RGB,
     pixelType,
-    imgData
+    data
   );
   glGenerateMipmap(this->type);
   glTexParameterf(this->type, GL_TEXTURE_MAX_ANISOTROPY_EXT, 4.f);
 
-  delete imgData;
   this->Unbind();
 }
+
+void kdr::Graphics::ShaderVariants::prepare(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::vector<std::string>>& defineSets)
+{
+  for (const std::vector<std::string>& defines : defineSets)
+  {
+    std::unique_ptr<kdr::Graphics::Shader>& variant = this->variants[makeKey(vertexPath, fragmentPath, defines)];
+    if (variant == NULL)
+    {
+      variant = std::make_unique<kdr::Graphics::Shader>(vertexPath, fragmentPath, defines, true);
+    }
+  }
+}
+
+kdr::Graphics::Shader* kdr::Graphics::ShaderVariants::get(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines)
+{
+  std::unique_ptr<kdr::Graphics::Shader>& variant = this->variants[makeKey(vertexPath, fragmentPath, defines)];
+  if (variant == NULL)
+  {
+    variant = std::make_unique<kdr::Graphics::Shader>(vertexPath, fragmentPath, defines);
+  }
+  variant->finalize();
+  return variant.get();
+}
+
+void kdr::Graphics::ShaderVariants::Delete()
+{
+  for (auto& variant : this->variants)
+  {
+    variant.second->finalize();
+    variant.second->Delete();
+  }
+  this->variants.clear();
+}
+
+std::string kdr::Graphics::ShaderVariants::makeKey(const std::string& vertexPath, const std::string& fragmentPath, std::vector<std::string> defines)
+{
+  std::sort(defines.begin(), defines.end());
+  std::string key = vertexPath + '\n' + fragmentPath;
+  for (const std::string& define : defines)
+  {
+    key += '\n' + define;
+  }
+  return key;
+}
@@ -0,0 +1,284 @@
+#include "Kedarium/Hierarchy.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#include "Kedarium/Jobs.hpp"
+
+bool kdr::Hierarchy::attach(const kdr::Entity entity, const kdr::Entity parent)
+{
+  const uint32_t node = this->_add(entity);
+  uint32_t parentNode {INVALID_NODE};
+  if (parent != kdr::NULL_ENTITY)
+  {
+    parentNode = this->_add(parent);
+    for (uint32_t ancestor = parentNode; ancestor != INVALID_NODE; ancestor = this->parents[ancestor])
+    {
+      if (ancestor == node)
+      {
+        return false;
+      }
+    }
+  }
+
+  this->parents[node] = parentNode;
+  this->dirty[node] = 1;
+  this->sorted = false;
+  return true;
+}
+
+void kdr::Hierarchy::remove(const kdr::Entity entity)
+{
+  const uint32_t node = this->find(entity);
+  if (node == INVALID_NODE)
+  {
+    return;
+  }
+
+  // Children keep their place in the world by taking over the local matrix of their parent.
+  for (uint32_t child = 0; child < this->entities.size(); child++)
+  {
+    if (this->parents[child] == node)
+    {
+      this->parents[child] = this->parents[node];
+      this->locals[child] = this->locals[node] * this->locals[child];
+      this->dirty[child] = 1;
+    }
+  }
+
+  const uint32_t last = this->entities.size() - 1;
+  if (node != last)
+  {
+    this->entities[node] = this->entities[last];
+    this->parents[node] = this->parents[last];
+    this->locals[node] = this->locals[last];
+    this->worlds[node] = this->worlds[last];
+    this->dirty[node] = this->dirty[last];
+    this->sparse[this->entities[node] & kdr::ENTITY_SLOT_MASK] = node;
+    for (uint32_t& nodeParent : this->parents)
+    {
+      if (nodeParent == last)
+      {
+        nodeParent = node;
+      }
+    }
+  }
+  this->sparse[entity & kdr::ENTITY_SLOT_MASK] = INVALID_NODE;
+  this->entities.pop_back();
+  this->parents.pop_back();
+  this->locals.pop_back();
+  this->worlds.pop_back();
+  this->dirty.pop_back();
+  this->sorted = false;
+}
+
+void kdr::Hierarchy::clear()
+{
+  this->entities.clear();
+  this->parents.clear();
+  this->firstChildren.clear();
+  this->childCounts.clear();
+  this->locals.clear();
+  this->worlds.clear();
+  this->dirty.clear();
+  this->updated.clear();
+  this->levelStarts.clear();
+  this->sparse.clear();
+  this->sorted = true;
+}
+
+uint32_t kdr::Hierarchy::find(const kdr::Entity entity) const
+{
+  const uint32_t slot = entity & kdr::ENTITY_SLOT_MASK;
+  if (slot >= this->sparse.size() || this->sparse[slot] == INVALID_NODE || this->entities[this->sparse[slot]] != entity)
+  {
+    return INVALID_NODE;
+  }
+  return this->sparse[slot];
+}
+
+kdr::Entity kdr::Hierarchy::getParent(const kdr::Entity entity) const
+{
+  const uint32_t node = this->find(entity);
+  if (node == INVALID_NODE || this->parents[node] == INVALID_NODE)
+  {
+    return kdr::NULL_ENTITY;
+  }
+  return this->entities[this->parents[node]];
+}
+
+void kdr::Hierarchy::setLocal(const kdr::Entity entity, const kdr::Space::Mat4& local)
+{
+  if (!this->sorted)
+  {
+    this->_sort();
+  }
+  const uint32_t node = this->find(entity);
+  if (node == INVALID_NODE)
+  {
+    return;
+  }
+  this->locals[node] = local;
+
+  // The descendants of a node on each level below it form one contiguous range, from the
+  // first child of the first node of the range above to the last child of its last node.
+  uint32_t begin = node;
+  uint32_t end = node + 1;
+  while (begin < end)
+  {
+    std::fill(this->dirty.begin() + begin, this->dirty.begin() + end, 1);
+    const uint32_t nextBegin = this->firstChildren[begin];
+    end = this->firstChildren[end - 1] + this->childCounts[end - 1];
+    begin = nextBegin;
+  }
+}
+
+size_t kdr::Hierarchy::update()
+{
+  if (!this->sorted)
+  {
+    this->_sort();
+  }
+  this->updated.assign(this->entities.size(), 0);
+
+  std::atomic<size_t> updatedCount {0};
+  for (size_t level = 0; level + 1 < this->levelStarts.size(); level++)
+  {
+    const uint32_t begin = this->levelStarts[level];
+    const uint32_t end = this->levelStarts[level + 1];
+    kdr::Core::getJobSystem().parallelFor(end - begin, PARALLEL_GRAIN, [&](const size_t first, const size_t last)
+    {
+      updatedCount += this->_updateRange(begin + first, begin + last);
+    });
+  }
+  return updatedCount;
+}
+
+uint32_t kdr::Hierarchy::_add(const kdr::Entity entity)
+{
+  const uint32_t existing = this->find(entity);
+  if (existing != INVALID_NODE)
+  {
+    return existing;
+  }
+
+  const uint32_t slot = entity & kdr::ENTITY_SLOT_MASK;
+  if (slot >= this->sparse.size())
+  {
+    this->sparse.resize(slot + 1, INVALID_NODE);
+  }
+  const uint32_t node = this->entities.size();
+  this->sparse[slot] = node;
+  this->entities.push_back(entity);
+  this->parents.push_back(INVALID_NODE);
+  this->locals.push_back(kdr::Space::Mat4 {1.f});
+  this->worlds.push_back(kdr::Space::Mat4 {1.f});
+  this->dirty.push_back(1);
+  this->sorted = false;
+  return node;
+}
+
+void kdr::Hierarchy::_sort()
+{
+  const uint32_t count = this->entities.size();
+
+  // Children are grouped by parent with a counting sort over the current order.
+  std::vector<uint32_t> childStarts(count + 1, 0);
+  std::vector<uint32_t> roots;
+  for (uint32_t node = 0; node < count; node++)
+  {
+    if (this->parents[node] == INVALID_NODE)
+    {
+      roots.push_back(node);
+    }
+    else
+    {
+      childStarts[this->parents[node] + 1]++;
+    }
+  }
+  for (uint32_t node = 0; node < count; node++)
+  {
+    childStarts[node + 1] += childStarts[node];
+  }
+  std::vector<uint32_t> children(childStarts[count]);
+  std::vector<uint32_t> cursors(childStarts.begin(), childStarts.end() - 1);
+  for (uint32_t node = 0; node < count; node++)
+  {
+    if (this->parents[node] != INVALID_NODE)
+    {
+      children[cursors[this->parents[node]]++] = node;
+    }
+  }
+
+  // The queue of the breadth-first walk is the new order itself.
+  std::vector<uint32_t> order(roots);
+  order.reserve(count);
+  std::vector<uint32_t> newIndices(count, INVALID_NODE);
+  this->levelStarts.assign(1, 0);
+  size_t levelEnd = order.size();
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    if (i == levelEnd)
+    {
+      this->levelStarts.push_back(i);
+      levelEnd = order.size();
+    }
+    const uint32_t node = order[i];
+    newIndices[node] = i;
+    order.insert(order.end(), children.begin() + childStarts[node], children.begin() + childStarts[node + 1]);
+  }
+  this->levelStarts.push_back(order.size());
+
+  std::vector<kdr::Entity> entities(count);
+  std::vector<uint32_t> parents(count);
+  std::vector<kdr::Space::Mat4> locals(count);
+  std::vector<kdr::Space::Mat4> worlds(count);
+  std::vector<unsigned char> dirty(count);
+  this->firstChildren.assign(count, 0);
+  this->childCounts.assign(count, 0);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const uint32_t node = order[i];
+    const uint32_t parent = this->parents[node];
+    entities[i] = this->entities[node];
+    parents[i] = parent == INVALID_NODE ? INVALID_NODE : newIndices[parent];
+    locals[i] = this->locals[node];
+    worlds[i] = this->worlds[node];
+    dirty[i] = this->dirty[node] || (parent != INVALID_NODE && dirty[newIndices[parent]]);
+    this->childCounts[i] = childStarts[node + 1] - childStarts[node];
+    this->sparse[entities[i] & kdr::ENTITY_SLOT_MASK] = i;
+  }
+  // The children of a node follow those of the nodes before it on its level.
+  uint32_t nextChild = this->levelStarts.size() > 1 ? this->levelStarts[1] : count;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    this->firstChildren[i] = nextChild;
+    nextChild += this->childCounts[i];
+  }
+
+  this->entities = std::move(entities);
+  this->parents = std::move(parents);
+  this->locals = std::move(locals);
+  this->worlds = std::move(worlds);
+  this->dirty = std::move(dirty);
+  this->sorted = true;
+}
+
+size_t kdr::Hierarchy::_updateRange(const uint32_t begin, const uint32_t end)
+{
+  size_t updatedCount {0};
+  for (uint32_t node = begin; node < end; node++)
+  {
+    if (!this->dirty[node])
+    {
+      continue;
+    }
+    const uint32_t parent = this->parents[node];
+    this->worlds[node] = parent == INVALID_NODE ? this->locals[node] : this->worlds[parent] * this->locals[node];
+    this->dirty[node] = 0;
+    this->updated[node] = 1;
+    updatedCount++;
+  }
+  return updatedCount;
+}
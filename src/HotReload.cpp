@@ -0,0 +1,352 @@
+#include "Kedarium/HotReload.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  /**
+   * @brief Normalizes a path so events and registered assets can be compared.
+   *
+   * @param path The path to normalize.
+   * @return The canonical path, or the path itself if it cannot be resolved.
+   */
+  std::string canonicalPath(const std::string& path)
+  {
+    std::error_code error;
+    const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+  }
+}
+
+bool kdr::HotReloader::start(const std::string& directory)
+{
+#ifdef __linux__
+  if (this->getActive())
+  {
+    this->stop();
+  }
+
+  this->inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  this->wakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (this->inotifyFD < 0 || this->wakeFD < 0)
+  {
+    std::cerr << "Failed to initialize inotify for hot reloading!\n";
+    this->stop();
+    return false;
+  }
+
+  this->_addWatches(directory);
+  if (this->watches.empty())
+  {
+    std::cerr << "Failed to watch directory (\"" << directory << "\")!\n";
+    this->stop();
+    return false;
+  }
+
+  this->thread = std::thread(&kdr::HotReloader::_run, this);
+  return true;
+#else
+  std::cerr << "Hot reloading of \"" << directory << "\" requires Linux inotify!\n";
+  return false;
+#endif
+}
+
+void kdr::HotReloader::stop()
+{
+#ifdef __linux__
+  if (this->thread.joinable())
+  {
+    const uint64_t value {1};
+    if (write(this->wakeFD, &value, sizeof(value)) < 0)
+    {
+      std::cerr << "Failed to wake the hot reload thread!\n";
+    }
+    this->thread.join();
+  }
+  if (this->inotifyFD >= 0) close(this->inotifyFD);
+  if (this->wakeFD >= 0) close(this->wakeFD);
+  this->inotifyFD = -1;
+  this->wakeFD = -1;
+  this->watches.clear();
+#endif
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (Result& result : this->results)
+  {
+    free(result.pixels);
+  }
+  this->results.clear();
+  this->pendingShaders.clear();
+}
+
+void kdr::HotReloader::watchShader(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->shaderEntries[name] = {vertexPath, fragmentPath, defines, {}};
+}
+
+void kdr::HotReloader::watchTexture(const std::string& name, const std::string& pngPath)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->textureEntries[name] = pngPath;
+}
+
+size_t kdr::HotReloader::apply(kdr::Core::Manager<kdr::Graphics::Shader>& shaders, kdr::Core::Manager<kdr::Graphics::Texture>& textures)
+{
+  std::vector<Result> ready;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::swap(ready, this->results);
+
+    for (Result& result : ready)
+    {
+      auto entry = this->shaderEntries.find(result.name);
+      if (!result.shader || entry == this->shaderEntries.end())
+      {
+        continue;
+      }
+      this->pendingShaders.push_back({
+        result.name,
+        kdr::Graphics::Shader::fromSources(
+          result.vertexSource,
+          result.fragmentSource,
+          entry->second.vertexPath,
+          entry->second.fragmentPath,
+          true
+        )
+      });
+    }
+  }
+
+  size_t replaced {0};
+  for (Result& result : ready)
+  {
+    if (result.shader)
+    {
+      continue;
+    }
+    kdr::Graphics::Texture* current = textures.get(result.name);
+    if (current != NULL)
+    {
+      kdr::Graphics::Texture texture {
+        result.pixels,
+        result.width,
+        result.height,
+        result.hasAlpha,
+        current->getType(),
+        GL_TEXTURE0,
+        GL_UNSIGNED_BYTE
+      };
+      *current = std::move(texture);
+      replaced++;
+    }
+    free(result.pixels);
+  }
+
+  // Linking continues in the driver between frames; a shader is swapped once it is ready.
+  size_t kept {0};
+  for (size_t i = 0; i < this->pendingShaders.size(); i++)
+  {
+    PendingShader& pending = this->pendingShaders[i];
+    if (!pending.shader.isReady())
+    {
+      if (kept != i) this->pendingShaders[kept] = std::move(pending);
+      kept++;
+      continue;
+    }
+    if (!pending.shader.finalize())
+    {
+      std::cerr << "Failed to reload shader \"" << pending.name << "\", keeping the previous version.\n";
+      continue;
+    }
+    kdr::Graphics::Shader* current = shaders.get(pending.name);
+    if (current == NULL)
+    {
+      continue;
+    }
+    *current = std::move(pending.shader);
+    replaced++;
+  }
+  this->pendingShaders.erase(this->pendingShaders.begin() + kept, this->pendingShaders.end());
+
+  return replaced;
+}
+
+void kdr::HotReloader::_addWatches(const std::string& directory)
+{
+#ifdef __linux__
+  std::error_code error;
+  std::vector<std::string> directories {directory};
+  for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+  {
+    if (it->is_directory(error))
+    {
+      directories.push_back(it->path().string());
+    }
+  }
+
+  for (const std::string& path : directories)
+  {
+    const int watch = inotify_add_watch(this->inotifyFD, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watch >= 0)
+    {
+      this->watches[watch] = path;
+    }
+  }
+#else
+  (void)directory;
+#endif
+}
+
+void kdr::HotReloader::_run()
+{
+#ifdef __linux__
+  std::set<std::string> changed;
+  while (true)
+  {
+    pollfd descriptors[2] {
+      {this->inotifyFD, POLLIN, 0},
+      {this->wakeFD, POLLIN, 0}
+    };
+
+    // Editors often write a file in several steps, so changes are collected until the
+    // directory has been quiet for a moment before anything is reloaded.
+    const int ready = poll(descriptors, 2, changed.empty() ? -1 : 50);
+    if (ready < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (ready < 0 || (descriptors[1].revents & POLLIN))
+    {
+      return;
+    }
+    if (ready == 0)
+    {
+      this->_reload(changed);
+      changed.clear();
+      continue;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(this->inotifyFD, buffer, sizeof(buffer))) > 0)
+    {
+      for (char* cursor = buffer; cursor < buffer + length;)
+      {
+        const inotify_event* event = (const inotify_event*)cursor;
+        cursor += sizeof(inotify_event) + event->len;
+
+        auto watch = this->watches.find(event->wd);
+        if (watch == this->watches.end() || event->len == 0)
+        {
+          continue;
+        }
+        const std::string path = watch->second + "/" + event->name;
+        if (event->mask & IN_ISDIR)
+        {
+          this->_addWatches(path);
+        }
+        else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+        {
+          changed.insert(canonicalPath(path));
+        }
+      }
+    }
+  }
+#endif
+}
+
+void kdr::HotReloader::_reload(const std::set<std::string>& changed)
+{
+  std::map<std::string, ShaderEntry> shaders;
+  std::map<std::string, std::string> textures;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    shaders = this->shaderEntries;
+    textures = this->textureEntries;
+  }
+
+  std::vector<Result> reloaded;
+  for (auto& item : shaders)
+  {
+    ShaderEntry& entry = item.second;
+    bool affected = entry.dependencies.empty();
+    for (const std::string& dependency : entry.dependencies)
+    {
+      affected = affected || changed.count(dependency) > 0;
+    }
+    if (!affected)
+    {
+      continue;
+    }
+
+    Result result;
+    result.name = item.first;
+    result.shader = true;
+
+    std::vector<std::string> vertexDependencies;
+    std::vector<std::string> fragmentDependencies;
+    result.vertexSource = kdr::Graphics::preprocessShader(entry.vertexPath, entry.defines, &vertexDependencies);
+    result.fragmentSource = kdr::Graphics::preprocessShader(entry.fragmentPath, entry.defines, &fragmentDependencies);
+
+    const bool wasKnown = !entry.dependencies.empty();
+    entry.dependencies = vertexDependencies;
+    entry.dependencies.insert(entry.dependencies.end(), fragmentDependencies.begin(), fragmentDependencies.end());
+
+    // Entries seen for the first time only learn their includes unless one of them changed.
+    bool dependencyChanged = wasKnown;
+    for (const std::string& dependency : entry.dependencies)
+    {
+      dependencyChanged = dependencyChanged || changed.count(dependency) > 0;
+    }
+    if (!dependencyChanged)
+    {
+      continue;
+    }
+    if (result.vertexSource.empty() || result.fragmentSource.empty())
+    {
+      std::cerr << "Failed to read shader \"" << item.first << "\", keeping the previous version.\n";
+      continue;
+    }
+    reloaded.push_back(std::move(result));
+  }
+
+  for (const auto& item : textures)
+  {
+    if (changed.count(canonicalPath(item.second)) == 0)
+    {
+      continue;
+    }
+    Result result;
+    result.name = item.first;
+    if (!kdr::Image::loadFromPNG(item.second, &result.pixels, result.width, result.height, result.hasAlpha))
+    {
+      std::cerr << "Failed to decode texture \"" << item.first << "\", keeping the previous version.\n";
+      continue;
+    }
+    reloaded.push_back(std::move(result));
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (const auto& item : shaders)
+  {
+    auto entry = this->shaderEntries.find(item.first);
+    if (entry != this->shaderEntries.end())
+    {
+      entry->second.dependencies = item.second.dependencies;
+    }
+  }
+  for (Result& result : reloaded)
+  {
+    this->results.push_back(std::move(result));
+  }
+}
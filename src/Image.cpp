@@ -65,3 +65,74 @@ bool kdr::Image::loadFromPNG(const std::string& path, GLubyte** oData, int& oWid
   fclose(file);
   return true;
 }
+
+bool kdr::Image::saveToPNG(const std::string& path, const GLubyte* data, const int width, const int height, const bool hasAlpha, const int compressionLevel)
+{
+  png_structp pngPtr;
+  png_infop   infoPtr;
+  FILE        *file;
+
+  file = fopen(path.c_str(), "wb");
+  if (file == NULL)
+  {
+    std::cerr << "Failed to open image (\"" << path << "\") for writing!" << '\n';
+    return false;
+  }
+
+  pngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (pngPtr == NULL)
+  {
+    std::cerr << "Failed to create write struct for image (\"" << path << "\")!" << '\n';
+    fclose(file);
+    return false;
+  }
+
+  infoPtr = png_create_info_struct(pngPtr);
+  if (infoPtr == NULL)
+  {
+    std::cerr << "Failed to create info struct for image (\"" << path << "\")!" << '\n';
+    png_destroy_write_struct(&pngPtr, NULL);
+    fclose(file);
+    return false;
+  }
+
+  const size_t rowBytes = (size_t)width * (hasAlpha ? 4 : 3);
+  png_bytepp rowPointers = reinterpret_cast<png_bytepp>(malloc(sizeof(png_bytep) * height));
+  for (int i = 0; i < height; i++)
+  {
+    rowPointers[i] = const_cast<png_bytep>(data + rowBytes * (height - i - 1));
+  }
+
+  if (setjmp(png_jmpbuf(pngPtr)))
+  {
+    std::cerr << "Failed to write image (\"" << path << "\")!" << '\n';
+    free(rowPointers);
+    png_destroy_write_struct(&pngPtr, &infoPtr);
+    fclose(file);
+    return false;
+  }
+
+  png_init_io(pngPtr, file);
+  if (compressionLevel >= 0)
+  {
+    png_set_compression_level(pngPtr, compressionLevel);
+  }
+  png_set_IHDR(
+    pngPtr,
+    infoPtr,
+    width,
+    height,
+    8,
+    hasAlpha ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB,
+    PNG_INTERLACE_NONE,
+    PNG_COMPRESSION_TYPE_DEFAULT,
+    PNG_FILTER_TYPE_DEFAULT
+  );
+  png_set_rows(pngPtr, infoPtr, rowPointers);
+  png_write_png(pngPtr, infoPtr, PNG_TRANSFORM_IDENTITY, NULL);
+
+  free(rowPointers);
+  png_destroy_write_struct(&pngPtr, &infoPtr);
+  fclose(file);
+  return true;
+}
@@ -0,0 +1,379 @@
+#include "Kedarium/Jobs.hpp"
+
+struct kdr::Core::Job
+{
+  std::function<void()>  function;
+  kdr::Core::JobCounter* counter {NULL};
+  std::atomic<bool>      busy    {false};
+};
+
+/**
+ * @brief Struct holding the Chase-Lev deque and the job storage of one thread.
+ *
+ * Only the owning thread pushes, pops and allocates, any thread steals. The deque is a
+ * fixed ring, so a push fails instead of growing when it is full.
+ */
+struct kdr::Core::JobSystem::Worker
+{
+  static constexpr int64_t CAPACITY {4096};
+
+  alignas(64) std::atomic<int64_t> top    {0};
+  alignas(64) std::atomic<int64_t> bottom {0};
+  std::atomic<kdr::Core::Job*>     deque[CAPACITY];
+  kdr::Core::Job                   jobs[CAPACITY];
+  size_t                           nextJob {0};
+  uint32_t                         random  {1};
+  std::thread                      thread;
+
+  /**
+   * @brief Takes a free job from the storage ring.
+   *
+   * @return A pointer to the job, or NULL if the next one in the ring is still in use.
+   */
+  kdr::Core::Job* allocate()
+  {
+    kdr::Core::Job* job = &this->jobs[this->nextJob % CAPACITY];
+    if (job->busy.load(std::memory_order_acquire))
+    {
+      return NULL;
+    }
+    this->nextJob++;
+    return job;
+  }
+  /**
+   * @brief Pushes a job to the bottom of the deque.
+   *
+   * @param job The job.
+   * @return True if pushed, false if the deque is full.
+   */
+  bool push(kdr::Core::Job* job)
+  {
+    const int64_t b = this->bottom.load(std::memory_order_relaxed);
+    const int64_t t = this->top.load(std::memory_order_acquire);
+    if (b - t >= CAPACITY)
+    {
+      return false;
+    }
+    this->deque[b % CAPACITY].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    this->bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+  /**
+   * @brief Pops the most recent job from the bottom of the deque.
+   *
+   * @return A pointer to the job, or NULL if the deque is empty or a thief took the last job.
+   */
+  kdr::Core::Job* pop()
+  {
+    const int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+    this->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = this->top.load(std::memory_order_relaxed);
+    if (t > b)
+    {
+      this->bottom.store(b + 1, std::memory_order_relaxed);
+      return NULL;
+    }
+
+    kdr::Core::Job* job = this->deque[b % CAPACITY].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+      // The last job is raced for with thieves through top, like a steal.
+      if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      {
+        job = NULL;
+      }
+      this->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+  /**
+   * @brief Steals the oldest job from the top of the deque.
+   *
+   * @return A pointer to the job, or NULL if the deque is empty or another thread won the race.
+   */
+  kdr::Core::Job* steal()
+  {
+    int64_t t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = this->bottom.load(std::memory_order_acquire);
+    if (t >= b)
+    {
+      return NULL;
+    }
+    kdr::Core::Job* job = this->deque[t % CAPACITY].load(std::memory_order_relaxed);
+    if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+      return NULL;
+    }
+    return job;
+  }
+};
+
+namespace
+{
+  /**
+   * @brief The number of times an idle worker yields before going to sleep.
+   */
+  constexpr int SPIN_COUNT {64};
+
+  thread_local kdr::Core::JobSystem* currentSystem {NULL};
+  thread_local unsigned int          currentWorker {0};
+}
+
+kdr::Core::JobSystem::JobSystem(const unsigned int workerCount)
+{
+  for (unsigned int i = 0; i <= workerCount; i++)
+  {
+    this->workers.push_back(std::make_unique<Worker>());
+    this->workers.back()->random = i * 2654435761u + 1;
+  }
+  currentSystem = this;
+  currentWorker = 0;
+  for (unsigned int i = 1; i <= workerCount; i++)
+  {
+    this->workers[i]->thread = std::thread(&kdr::Core::JobSystem::_work, this, i);
+  }
+}
+
+kdr::Core::JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->sleepMutex);
+    this->stopping.store(true);
+  }
+  this->wakeUp.notify_all();
+  for (size_t i = 1; i < this->workers.size(); i++)
+  {
+    this->workers[i]->thread.join();
+  }
+  if (currentSystem == this)
+  {
+    currentSystem = NULL;
+  }
+}
+
+void kdr::Core::JobSystem::run(std::function<void()> function, kdr::Core::JobCounter* counter, kdr::Core::JobCounter* dependency)
+{
+  if (counter != NULL)
+  {
+    counter->pending.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  Worker* worker = this->_getCurrentWorker();
+  kdr::Core::Job* job = worker != NULL ? worker->allocate() : NULL;
+  if (job == NULL)
+  {
+    if (dependency != NULL)
+    {
+      this->wait(*dependency);
+    }
+    function();
+    this->_finish(worker, counter);
+    return;
+  }
+  job->function = std::move(function);
+  job->counter = counter;
+  job->busy.store(true, std::memory_order_relaxed);
+
+  if (dependency != NULL)
+  {
+    // Checked under the lock that _finish() holds while releasing, so the job is never missed.
+    std::lock_guard<std::mutex> lock(dependency->mutex);
+    if (dependency->pending.load(std::memory_order_acquire) > 0)
+    {
+      dependency->continuations.push_back(job);
+      return;
+    }
+  }
+  this->_schedule(worker, job);
+}
+
+void kdr::Core::JobSystem::runOnWorker(std::function<void()> function, kdr::Core::JobCounter* counter)
+{
+  if (counter != NULL)
+  {
+    counter->pending.fetch_add(1, std::memory_order_acq_rel);
+  }
+  if (this->workers.size() < 2)
+  {
+    function();
+    this->_finish(this->_getCurrentWorker(), counter);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->workerJobsMutex);
+    this->workerJobs.emplace_back(std::move(function), counter);
+  }
+  this->queuedCount.fetch_add(1);
+  this->_wakeWorker();
+}
+
+void kdr::Core::JobSystem::wait(kdr::Core::JobCounter& counter)
+{
+  Worker* worker = this->_getCurrentWorker();
+  while (counter.pending.load(std::memory_order_acquire) > 0)
+  {
+    kdr::Core::Job* job = this->_findJob(worker);
+    if (job != NULL)
+    {
+      this->_execute(worker, job);
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+  // The thread finishing the last job may still hold the lock, and the counter may be
+  // destroyed as soon as this returns.
+  std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+kdr::Core::JobSystem::Worker* kdr::Core::JobSystem::_getCurrentWorker()
+{
+  return currentSystem == this ? this->workers[currentWorker].get() : NULL;
+}
+
+void kdr::Core::JobSystem::_schedule(Worker* worker, kdr::Core::Job* job)
+{
+  if (worker == NULL || !worker->push(job))
+  {
+    this->_execute(worker, job);
+    return;
+  }
+  this->queuedCount.fetch_add(1);
+  this->_wakeWorker();
+}
+
+void kdr::Core::JobSystem::_wakeWorker()
+{
+  // Pairs with the sleeping workers counting themselves before checking for queued jobs.
+  if (this->sleepingCount.load() > 0)
+  {
+    std::lock_guard<std::mutex> lock(this->sleepMutex);
+    this->wakeUp.notify_one();
+  }
+}
+
+bool kdr::Core::JobSystem::_runWorkerJob(Worker* worker)
+{
+  std::pair<std::function<void()>, kdr::Core::JobCounter*> job;
+  {
+    std::lock_guard<std::mutex> lock(this->workerJobsMutex);
+    if (this->workerJobs.empty())
+    {
+      return false;
+    }
+    job = std::move(this->workerJobs.front());
+    this->workerJobs.pop_front();
+  }
+  this->queuedCount.fetch_sub(1);
+  job.first();
+  this->_finish(worker, job.second);
+  return true;
+}
+
+kdr::Core::Job* kdr::Core::JobSystem::_findJob(Worker* worker)
+{
+  kdr::Core::Job* job = worker != NULL ? worker->pop() : NULL;
+  if (job == NULL)
+  {
+    uint32_t start {0};
+    if (worker != NULL)
+    {
+      worker->random ^= worker->random << 13;
+      worker->random ^= worker->random >> 17;
+      worker->random ^= worker->random << 5;
+      start = worker->random;
+    }
+    const size_t count = this->workers.size();
+    for (size_t i = 0; i < count && job == NULL; i++)
+    {
+      Worker* victim = this->workers[(start + i) % count].get();
+      if (victim != worker)
+      {
+        job = victim->steal();
+      }
+    }
+  }
+  if (job != NULL)
+  {
+    this->queuedCount.fetch_sub(1);
+  }
+  return job;
+}
+
+void kdr::Core::JobSystem::_execute(Worker* worker, kdr::Core::Job* job)
+{
+  job->function();
+  job->function = nullptr;
+  kdr::Core::JobCounter* counter = job->counter;
+  job->busy.store(false, std::memory_order_release);
+  this->_finish(worker, counter);
+}
+
+void kdr::Core::JobSystem::_finish(Worker* worker, kdr::Core::JobCounter* counter)
+{
+  if (counter == NULL)
+  {
+    return;
+  }
+  std::vector<kdr::Core::Job*> released;
+  {
+    std::lock_guard<std::mutex> lock(counter->mutex);
+    if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      released.swap(counter->continuations);
+    }
+  }
+  for (kdr::Core::Job* job : released)
+  {
+    this->_schedule(worker, job);
+  }
+}
+
+void kdr::Core::JobSystem::_work(const unsigned int index)
+{
+  currentSystem = this;
+  currentWorker = index;
+  Worker* worker = this->workers[index].get();
+
+  int idleCount {0};
+  while (!this->stopping.load())
+  {
+    kdr::Core::Job* job = this->_findJob(worker);
+    if (job != NULL)
+    {
+      this->_execute(worker, job);
+      idleCount = 0;
+      continue;
+    }
+    // Only the top of the loop takes shared jobs, so they never run inside a wait().
+    if (this->_runWorkerJob(worker))
+    {
+      idleCount = 0;
+      continue;
+    }
+    if (++idleCount < SPIN_COUNT)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    idleCount = 0;
+    std::unique_lock<std::mutex> lock(this->sleepMutex);
+    this->sleepingCount.fetch_add(1);
+    this->wakeUp.wait(lock, [this]()
+    {
+      return this->queuedCount.load() > 0 || this->stopping.load();
+    });
+    this->sleepingCount.fetch_sub(1);
+  }
+}
+
+kdr::Core::JobSystem& kdr::Core::getJobSystem()
+{
+  static kdr::Core::JobSystem jobSystem;
+  return jobSystem;
+}
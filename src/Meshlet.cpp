@@ -0,0 +1,363 @@
+#include "Kedarium/Meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <numeric>
+
+#include "Kedarium/Jobs.hpp"
+
+namespace
+{
+  // Below this spread of the triangle normals, the cone is too wide to reject anything.
+  constexpr float MIN_CONE_DOT {0.1f};
+
+  /**
+   * @brief Computes the bounding sphere and normal cone of a cluster.
+   *
+   * @param vertices The vertices, with the position in the first three floats.
+   * @param stride The number of floats per vertex.
+   * @param indices The triangle list the cluster refers to.
+   * @param ioCluster The cluster, whose index range is read and bounds are written.
+   */
+  void computeBounds(const GLfloat* vertices, const size_t stride, const GLuint* indices, kdr::Meshlet::Cluster& ioCluster)
+  {
+    const GLuint* begin = indices + ioCluster.firstIndex;
+    const GLuint* end = begin + ioCluster.indexCount;
+
+    kdr::Bounds::AABB box;
+    for (const GLuint* index = begin; index != end; index++)
+    {
+      box.expand(kdr::Space::Vec3 {vertices[*index * stride], vertices[*index * stride + 1], vertices[*index * stride + 2]});
+    }
+    const kdr::Space::Vec3 center = box.getCenter();
+    float radiusSquared {0.f};
+    for (const GLuint* index = begin; index != end; index++)
+    {
+      const kdr::Space::Vec3 offset = kdr::Space::Vec3 {vertices[*index * stride], vertices[*index * stride + 1], vertices[*index * stride + 2]} - center;
+      radiusSquared = std::max(radiusSquared, kdr::Space::dot(offset, offset));
+    }
+    ioCluster.sphere = {center, sqrtf(radiusSquared)};
+
+    std::vector<kdr::Space::Vec3> normals;
+    kdr::Space::Vec3 axis {0.f};
+    for (const GLuint* triangle = begin; triangle != end; triangle += 3)
+    {
+      const GLfloat* p0 = vertices + triangle[0] * stride;
+      const GLfloat* p1 = vertices + triangle[1] * stride;
+      const GLfloat* p2 = vertices + triangle[2] * stride;
+      const kdr::Space::Vec3 normal = kdr::Space::cross(
+        kdr::Space::Vec3 {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]},
+        kdr::Space::Vec3 {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]}
+      );
+      const float length = sqrtf(kdr::Space::dot(normal, normal));
+      if (length <= 0.f)
+      {
+        continue;
+      }
+      normals.push_back((1.f / length) * normal);
+      axis += normals.back();
+    }
+
+    ioCluster.coneAxis = kdr::Space::Vec3 {0.f};
+    ioCluster.coneCutoff = 1.f;
+    const float axisLength = sqrtf(kdr::Space::dot(axis, axis));
+    if (normals.empty() || axisLength <= 0.f)
+    {
+      return;
+    }
+    axis = (1.f / axisLength) * axis;
+
+    float minDot {1.f};
+    for (const kdr::Space::Vec3& normal : normals)
+    {
+      minDot = std::min(minDot, kdr::Space::dot(axis, normal));
+    }
+    if (minDot < MIN_CONE_DOT)
+    {
+      return;
+    }
+    // Every triangle faces away once the view direction is within 90 degrees minus the
+    // cone angle of the axis, so the cutoff is the sine of the cone angle.
+    ioCluster.coneAxis = axis;
+    ioCluster.coneCutoff = sqrtf(1.f - minDot * minDot);
+  }
+}
+
+std::vector<kdr::Meshlet::Cluster> kdr::Meshlet::build(const GLfloat* vertices, const size_t stride, GLuint* ioIndices, const size_t indexCount)
+{
+  std::vector<kdr::Meshlet::Cluster> clusters;
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0)
+  {
+    return clusters;
+  }
+
+  const GLuint vertexCount = *std::max_element(ioIndices, ioIndices + triangleCount * 3) + 1;
+  std::vector<GLuint> adjacencyOffsets(vertexCount + 1, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++)
+  {
+    adjacencyOffsets[ioIndices[i] + 1]++;
+  }
+  std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+  std::vector<GLuint> adjacency(triangleCount * 3);
+  std::vector<GLuint> filled(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++)
+  {
+    adjacency[adjacencyOffsets[ioIndices[i]] + filled[ioIndices[i]]++] = i / 3;
+  }
+
+  std::vector<kdr::Space::Vec3> centroids(triangleCount);
+  for (size_t i = 0; i < triangleCount; i++)
+  {
+    const GLfloat* p0 = vertices + ioIndices[i * 3] * stride;
+    const GLfloat* p1 = vertices + ioIndices[i * 3 + 1] * stride;
+    const GLfloat* p2 = vertices + ioIndices[i * 3 + 2] * stride;
+    centroids[i] = kdr::Space::Vec3 {p0[0] + p1[0] + p2[0], p0[1] + p1[1] + p2[1], p0[2] + p1[2] + p2[2]} * (1.f / 3.f);
+  }
+
+  // Vertices are marked with the number of the cluster that last used them.
+  std::vector<GLuint> marks(vertexCount, 0);
+  GLuint mark {0};
+  auto countNewVertices = [&](const GLuint* triangle)
+  {
+    GLuint count {0};
+    for (int corner = 0; corner < 3; corner++)
+    {
+      const bool repeated = (corner > 0 && triangle[corner] == triangle[0]) || (corner == 2 && triangle[2] == triangle[1]);
+      count += marks[triangle[corner]] != mark && !repeated;
+    }
+    return count;
+  };
+
+  std::vector<bool>   emitted(triangleCount, false);
+  std::vector<GLuint> result;
+  std::vector<GLuint> clusterVertices;
+  result.reserve(triangleCount * 3);
+  size_t seedCursor {0};
+
+  // Clusters grow from the first free triangle in the current order, which keeps the order of
+  // the optimizer passes at the cluster level. The next triangle is a neighbour adding the
+  // fewest vertices, then the one closest to the cluster, so clusters stay round and their
+  // normal cones narrow.
+  while (result.size() < triangleCount * 3)
+  {
+    while (emitted[seedCursor])
+    {
+      seedCursor++;
+    }
+
+    mark++;
+    kdr::Meshlet::Cluster cluster;
+    cluster.firstIndex = result.size();
+    clusterVertices.clear();
+    kdr::Space::Vec3 centroidSum {0.f};
+    long next = seedCursor;
+
+    while (next >= 0)
+    {
+      const GLuint* triangle = ioIndices + next * 3;
+      for (int corner = 0; corner < 3; corner++)
+      {
+        if (marks[triangle[corner]] != mark)
+        {
+          marks[triangle[corner]] = mark;
+          clusterVertices.push_back(triangle[corner]);
+        }
+      }
+      result.insert(result.end(), triangle, triangle + 3);
+      emitted[next] = true;
+      cluster.indexCount += 3;
+      centroidSum += centroids[next];
+
+      next = -1;
+      if (cluster.indexCount / 3 >= kdr::Meshlet::MAX_TRIANGLES)
+      {
+        break;
+      }
+      const kdr::Space::Vec3 center = (1.f / (cluster.indexCount / 3)) * centroidSum;
+      GLuint bestNew {4};
+      float  bestDistance {0.f};
+      for (const GLuint vertex : clusterVertices)
+      {
+        for (GLuint i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++)
+        {
+          const GLuint candidate = adjacency[i];
+          if (emitted[candidate])
+          {
+            continue;
+          }
+          const GLuint newVertices = countNewVertices(ioIndices + candidate * 3);
+          if (clusterVertices.size() + newVertices > kdr::Meshlet::MAX_VERTICES || newVertices > bestNew)
+          {
+            continue;
+          }
+          const kdr::Space::Vec3 offset = centroids[candidate] - center;
+          const float distance = kdr::Space::dot(offset, offset);
+          if (newVertices < bestNew || distance < bestDistance)
+          {
+            bestNew = newVertices;
+            bestDistance = distance;
+            next = candidate;
+          }
+        }
+      }
+    }
+    clusters.push_back(cluster);
+  }
+
+  std::copy(result.begin(), result.end(), ioIndices);
+  for (kdr::Meshlet::Cluster& cluster : clusters)
+  {
+    computeBounds(vertices, stride, ioIndices, cluster);
+  }
+  return clusters;
+}
+
+void kdr::Meshlet::ClusterSet::build(const GLfloat* vertices, const size_t stride, GLuint* ioIndices, const size_t indexCount)
+{
+  this->clusters = kdr::Meshlet::build(vertices, stride, ioIndices, indexCount);
+  this->indices.assign(ioIndices, ioIndices + indexCount);
+
+  const size_t count = this->clusters.size();
+  this->centerX.resize(count);
+  this->centerY.resize(count);
+  this->centerZ.resize(count);
+  this->radius.resize(count);
+  this->axisX.resize(count);
+  this->axisY.resize(count);
+  this->axisZ.resize(count);
+  this->cutoff.resize(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    const kdr::Meshlet::Cluster& cluster = this->clusters[i];
+    this->centerX[i] = cluster.sphere.center.x;
+    this->centerY[i] = cluster.sphere.center.y;
+    this->centerZ[i] = cluster.sphere.center.z;
+    this->radius[i] = cluster.sphere.radius;
+    this->axisX[i] = cluster.coneAxis.x;
+    this->axisY[i] = cluster.coneAxis.y;
+    this->axisZ[i] = cluster.coneAxis.z;
+    this->cutoff[i] = cluster.coneCutoff;
+  }
+}
+
+void kdr::Meshlet::ClusterSet::clear()
+{
+  *this = kdr::Meshlet::ClusterSet();
+}
+
+size_t kdr::Meshlet::ClusterSet::cull(const kdr::Bounds::Frustum& frustum, const kdr::Space::Vec3& cameraPosition, unsigned char* oVisible) const
+{
+  // The grain is a multiple of the SIMD width, so only the last chunk has a scalar tail.
+  std::atomic<size_t> visibleCount {0};
+  kdr::Core::getJobSystem().parallelFor(this->clusters.size(), PARALLEL_GRAIN, [&](const size_t begin, const size_t end)
+  {
+    visibleCount += this->_cullRange(frustum, cameraPosition, begin, end, oVisible);
+  });
+  return visibleCount;
+}
+
+size_t kdr::Meshlet::ClusterSet::_cullRange(const kdr::Bounds::Frustum& frustum, const kdr::Space::Vec3& cameraPosition, const size_t begin, const size_t end, unsigned char* oVisible) const
+{
+  size_t visibleCount {0};
+  size_t i {begin};
+
+#ifdef KDR_SIMD_SSE
+  const __m128 cameraX = _mm_set1_ps(cameraPosition.x);
+  const __m128 cameraY = _mm_set1_ps(cameraPosition.y);
+  const __m128 cameraZ = _mm_set1_ps(cameraPosition.z);
+
+  for (; i + kdr::SIMD::WIDTH <= end; i += kdr::SIMD::WIDTH)
+  {
+    const __m128 centerX = _mm_loadu_ps(&this->centerX[i]);
+    const __m128 centerY = _mm_loadu_ps(&this->centerY[i]);
+    const __m128 centerZ = _mm_loadu_ps(&this->centerZ[i]);
+    const __m128 radius = _mm_loadu_ps(&this->radius[i]);
+    const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+    __m128 rejected = _mm_setzero_ps();
+    for (int p = 0; p < 6; p++)
+    {
+      const float* plane = frustum.planes[p];
+      const __m128 distance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), centerX), _mm_mul_ps(_mm_set1_ps(plane[1]), centerY)),
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), centerZ), _mm_set1_ps(plane[3]))
+      );
+      rejected = _mm_or_ps(rejected, _mm_cmplt_ps(distance, negativeRadius));
+    }
+
+    const __m128 viewX = _mm_sub_ps(centerX, cameraX);
+    const __m128 viewY = _mm_sub_ps(centerY, cameraY);
+    const __m128 viewZ = _mm_sub_ps(centerZ, cameraZ);
+    const __m128 viewLength = _mm_sqrt_ps(_mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(viewX, viewX), _mm_mul_ps(viewY, viewY)),
+      _mm_mul_ps(viewZ, viewZ)
+    ));
+    const __m128 coneDot = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(viewX, _mm_loadu_ps(&this->axisX[i])), _mm_mul_ps(viewY, _mm_loadu_ps(&this->axisY[i]))),
+      _mm_mul_ps(viewZ, _mm_loadu_ps(&this->axisZ[i]))
+    );
+    const __m128 coneLimit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&this->cutoff[i]), viewLength), radius);
+    rejected = _mm_or_ps(rejected, _mm_cmpgt_ps(coneDot, coneLimit));
+
+    const int rejectedMask = _mm_movemask_ps(rejected);
+    for (unsigned int lane = 0; lane < kdr::SIMD::WIDTH; lane++)
+    {
+      const unsigned char visible = (rejectedMask & (1 << lane)) == 0;
+      oVisible[i + lane] = visible;
+      visibleCount += visible;
+    }
+  }
+#endif
+
+  for (; i < end; i++)
+  {
+    const kdr::Meshlet::Cluster& cluster = this->clusters[i];
+    unsigned char visible = kdr::Bounds::testSphere(frustum, cluster.sphere);
+    if (visible)
+    {
+      // The cluster faces away if the view direction lies inside the back-facing cone.
+      const kdr::Space::Vec3 view = cluster.sphere.center - cameraPosition;
+      visible = kdr::Space::dot(view, cluster.coneAxis) <= cluster.coneCutoff * sqrtf(kdr::Space::dot(view, view)) + cluster.sphere.radius;
+    }
+    oVisible[i] = visible;
+    visibleCount += visible;
+  }
+  return visibleCount;
+}
+
+size_t kdr::Meshlet::ClusterSet::countIndices(const unsigned char* visible) const
+{
+  size_t indexCount {0};
+  for (size_t i = 0; i < this->clusters.size(); i++)
+  {
+    indexCount += visible[i] ? this->clusters[i].indexCount : 0;
+  }
+  return indexCount;
+}
+
+size_t kdr::Meshlet::ClusterSet::compact(const unsigned char* visible, GLuint* oIndices) const
+{
+  size_t written {0};
+  size_t i {0};
+  while (i < this->clusters.size())
+  {
+    if (!visible[i])
+    {
+      i++;
+      continue;
+    }
+    // Clusters are consecutive ranges, so a run of visible clusters is one range.
+    const GLuint first = this->clusters[i].firstIndex;
+    GLuint count {0};
+    for (; i < this->clusters.size() && visible[i]; i++)
+    {
+      count += this->clusters[i].indexCount;
+    }
+    memcpy(oIndices + written, this->indices.data() + first, count * sizeof(GLuint));
+    written += count;
+  }
+  return written;
+}
@@ -0,0 +1,121 @@
+#include "Kedarium/MultiDraw.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+bool kdr::MultiDraw::isSupported()
+{
+  if (GLEW_VERSION_4_3)
+  {
+    return true;
+  }
+  return GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_base_instance;
+}
+
+void kdr::MultiDraw::add(const kdr::Solids::Solid& solid)
+{
+  const kdr::Object::Lod& lod = solid.getLods()[solid.getSelectedLod()];
+  this->add(solid.getMesh(), lod.firstIndex, lod.indexCount, solid.getModelMatrix(), solid.getPositionOffset(), solid.getPositionScale());
+}
+
+void kdr::MultiDraw::add(const GLuint mesh, const GLuint firstIndex, const GLuint indexCount, const kdr::Space::Mat4& model, const kdr::Space::Vec3& positionOffset, const kdr::Space::Vec3& positionScale)
+{
+  if (mesh == kdr::MeshArena::INVALID_MESH)
+  {
+    return;
+  }
+
+  const kdr::MeshArena::Range& range = kdr::MeshArena::getSolidArena().getRange(mesh);
+  kdr::DrawElementsIndirectCommand command;
+  command.count = indexCount;
+  command.instanceCount = 1;
+  command.firstIndex = range.firstIndex + firstIndex;
+  command.baseVertex = (GLint)range.firstVertex;
+  command.baseInstance = this->commands.size();
+  this->commands.push_back(command);
+
+  DrawData draw;
+  memcpy(draw.model, kdr::Space::valuePointer(model), sizeof(draw.model));
+  draw.positionOffset[0] = positionOffset.x;
+  draw.positionOffset[1] = positionOffset.y;
+  draw.positionOffset[2] = positionOffset.z;
+  draw.positionOffset[3] = 0.f;
+  draw.positionScale[0] = positionScale.x;
+  draw.positionScale[1] = positionScale.y;
+  draw.positionScale[2] = positionScale.z;
+  draw.positionScale[3] = 0.f;
+  this->draws.push_back(draw);
+}
+
+size_t kdr::MultiDraw::submit(kdr::StreamBuffer& stream)
+{
+  const size_t drawCount = this->commands.size();
+  if (drawCount == 0)
+  {
+    return 0;
+  }
+
+  static GLint storageAlignment {0};
+  if (storageAlignment == 0)
+  {
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+  }
+
+  kdr::StreamBuffer::Allocation commandMemory;
+  kdr::StreamBuffer::Allocation drawMemory;
+  const GLsizeiptr commandBytes = drawCount * sizeof(kdr::DrawElementsIndirectCommand);
+  const GLsizeiptr drawBytes = drawCount * sizeof(DrawData);
+  if (!stream.allocate(commandBytes, sizeof(GLuint), commandMemory) || !stream.allocate(drawBytes, storageAlignment, drawMemory))
+  {
+    this->commands.clear();
+    this->draws.clear();
+    return 0;
+  }
+  memcpy(commandMemory.data, this->commands.data(), commandBytes);
+  memcpy(drawMemory.data, this->draws.data(), drawBytes);
+  stream.flush();
+
+  if (this->drawIDBuffer == 0)
+  {
+    glGenBuffers(1, &this->drawIDBuffer);
+  }
+  // The draw IDs never change, so the buffer is only rewritten when more draws are needed.
+  if (this->drawIDCount < drawCount)
+  {
+    this->drawIDCount = std::max<GLuint>(drawCount, this->drawIDCount * 2);
+    std::vector<GLuint> drawIDs(this->drawIDCount);
+    for (GLuint i = 0; i < this->drawIDCount; i++)
+    {
+      drawIDs[i] = i;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, this->drawIDBuffer);
+    glBufferData(GL_ARRAY_BUFFER, drawIDs.size() * sizeof(GLuint), drawIDs.data(), GL_STATIC_DRAW);
+  }
+
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_BUFFER_BINDING, stream.getID(), drawMemory.offset, drawBytes);
+
+  kdr::MeshArena& arena = kdr::MeshArena::getSolidArena();
+  arena.Bind();
+  glBindBuffer(GL_ARRAY_BUFFER, this->drawIDBuffer);
+  glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, 0, NULL);
+  glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+  glEnableVertexAttribArray(DRAW_ID_LOCATION);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.getID());
+  glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)commandMemory.offset, drawCount, 0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+  this->commands.clear();
+  this->draws.clear();
+  return drawCount;
+}
+
+void kdr::MultiDraw::Delete()
+{
+  if (this->drawIDBuffer != 0) glDeleteBuffers(1, &this->drawIDBuffer);
+  this->drawIDBuffer = 0;
+  this->drawIDCount = 0;
+  this->commands.clear();
+  this->draws.clear();
+}
@@ -1,5 +1,58 @@
 #include "Kedarium/Object.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#include "Kedarium/File.hpp"
+#include "Kedarium/Optimize.hpp"
+
+namespace
+{
+  /**
+   * @brief Struct of the header at the start of a mesh cache file.
+   */
+  struct MeshCacheHeader
+  {
+    char     magic[4]    {'K', 'D', 'R', 'M'};
+    uint32_t version     {3};
+    uint64_t sourceHash  {0};
+    uint32_t vertexCount {0};
+    uint32_t indexCount  {0};
+    uint32_t lodCount    {0};
+    uint32_t padding     {0};
+  };
+
+  constexpr size_t MAX_LOD_COUNT     {6};
+  constexpr float  LOD_REDUCTION     {0.5f};
+  constexpr size_t MIN_LOD_TRIANGLES {128};
+
+  std::string meshCacheDirectory;
+
+  /**
+   * @brief Feeds bytes into a 64-bit FNV-1a hash.
+   *
+   * @param hash The running hash.
+   * @param data The bytes to hash.
+   * @param size The number of bytes.
+   * @return The updated hash.
+   */
+  uint64_t hashBytes(uint64_t hash, const void* data, const size_t size)
+  {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+}
+
 bool kdr::Object::loadFromObj(const std::string& objPath, std::vector<GLfloat>& oVertices, GLsizeiptr& oVerticesSize, std::vector<GLuint>& oIndices, GLsizeiptr& oIndicesSize, const kdr::Space::Vec3& dimensions)
 {
   std::ifstream file(objPath);
@@ -110,12 +163,22 @@ bool kdr::Object::loadFromObj(const std::string& objPath, std::vector<GLfloat>&
   float height = hasDimensions ? dimensions.y : 1.f;
   float width  = hasDimensions ? dimensions.z : 1.f;
 
+  // Face corners sharing position, texture coordinates and normal become one vertex.
+  std::map<std::array<int, 3>, GLuint> uniqueVertices;
+
   for (int i = 0; i < (int)(faceData.size() / 3); i++)
   {
     int posIndex = faceData.at(i * 3);
     int texIndex = faceData.at(i * 3 + 1);
     int normIndex = faceData.at(i * 3 + 2);
 
+    const auto inserted = uniqueVertices.insert({{posIndex, texIndex, normIndex}, (GLuint)(vertices.size() / 11)});
+    indices.push_back(inserted.first->second);
+    if (!inserted.second)
+    {
+      continue;
+    }
+
     vertices.push_back(vecVals.at((posIndex - 1) * 3)     * length);
     vertices.push_back(vecVals.at((posIndex - 1) * 3 + 1) * height);
     vertices.push_back(vecVals.at((posIndex - 1) * 3 + 2) * width);
@@ -127,8 +190,6 @@ bool kdr::Object::loadFromObj(const std::string& objPath, std::vector<GLfloat>&
     vertices.push_back(normVals.at((normIndex - 1) * 3));
     vertices.push_back(normVals.at((normIndex - 1) * 3 + 1));
     vertices.push_back(normVals.at((normIndex - 1) * 3 + 2));
-
-    indices.push_back(i);
   }
 
   oVertices = vertices;
@@ -138,3 +199,122 @@ bool kdr::Object::loadFromObj(const std::string& objPath, std::vector<GLfloat>&
 
   return true;
 }
+
+void kdr::Object::setMeshCacheDirectory(const std::string& directory)
+{
+  meshCacheDirectory = directory;
+}
+
+const std::string& kdr::Object::getMeshCacheDirectory()
+{
+  return meshCacheDirectory;
+}
+
+bool kdr::Object::loadMesh(const std::string& objPath, std::vector<GLfloat>& oVertices, std::vector<GLuint>& oIndices, std::vector<kdr::Object::Lod>& oLods, const kdr::Space::Vec3& dimensions)
+{
+  std::string cachePath;
+  MeshCacheHeader header;
+  if (!meshCacheDirectory.empty())
+  {
+    const std::string source = kdr::File::getContents(objPath);
+    if (source.empty())
+    {
+      return false;
+    }
+    header.sourceHash = hashBytes(14695981039346656037ull, source.data(), source.size());
+    header.sourceHash = hashBytes(header.sourceHash, &dimensions, sizeof(dimensions));
+
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)header.sourceHash);
+    cachePath = meshCacheDirectory + "/" + name + ".kmesh";
+
+    std::vector<char> data;
+    if (kdr::File::readBinary(cachePath, data) && data.size() >= sizeof(MeshCacheHeader))
+    {
+      MeshCacheHeader cached;
+      memcpy(&cached, data.data(), sizeof(cached));
+      const size_t lodsSize = cached.lodCount * sizeof(kdr::Object::Lod);
+      const size_t verticesSize = cached.vertexCount * 11 * sizeof(GLfloat);
+      const size_t expectedSize = sizeof(cached) + lodsSize + verticesSize + cached.indexCount * sizeof(GLuint);
+      if (memcmp(cached.magic, header.magic, 4) == 0 && cached.version == header.version && cached.sourceHash == header.sourceHash && cached.lodCount > 0 && data.size() == expectedSize)
+      {
+        std::vector<kdr::Object::Lod> lods(cached.lodCount);
+        const char* cursor = data.data() + sizeof(cached);
+        memcpy(lods.data(), cursor, lodsSize);
+        // A stale or corrupt file must not make any level draw past the index buffer.
+        const bool lodsValid = std::all_of(lods.begin(), lods.end(), [&cached](const kdr::Object::Lod& lod)
+        {
+          return lod.indexCount > 0 && lod.firstIndex <= cached.indexCount && lod.indexCount <= cached.indexCount - lod.firstIndex;
+        });
+        if (lodsValid)
+        {
+          oLods = std::move(lods);
+          oVertices.resize(cached.vertexCount * 11);
+          oIndices.resize(cached.indexCount);
+          memcpy(oVertices.data(), cursor + lodsSize, verticesSize);
+          memcpy(oIndices.data(), cursor + lodsSize + verticesSize, oIndices.size() * sizeof(GLuint));
+          return true;
+        }
+        std::cerr << "Ignoring mesh cache with invalid levels of detail (\"" << cachePath << "\")!" << '\n';
+      }
+    }
+  }
+
+  GLsizeiptr verticesSize {0};
+  GLsizeiptr indicesSize  {0};
+  if (!kdr::Object::loadFromObj(objPath, oVertices, verticesSize, oIndices, indicesSize, dimensions))
+  {
+    return false;
+  }
+  kdr::Optimize::optimizeMesh(oVertices, 11, oIndices);
+
+  // Every level is simplified from the full mesh, so its error is measured against the source.
+  const size_t vertexCount = oVertices.size() / 11;
+  const std::vector<GLuint> source = oIndices;
+  oLods = {{0, (GLuint)source.size(), 0.f}};
+  std::vector<GLuint> lodIndices;
+  while (oLods.size() < MAX_LOD_COUNT)
+  {
+    const size_t previousCount = oLods.back().indexCount;
+    const size_t targetCount = (size_t)(previousCount * LOD_REDUCTION) / 3 * 3;
+    if (targetCount < MIN_LOD_TRIANGLES * 3)
+    {
+      break;
+    }
+    const float error = kdr::Optimize::simplify(oVertices.data(), vertexCount, 11, source, targetCount, FLT_MAX, lodIndices);
+    // Stop once seams and borders keep the simplifier from getting meaningfully smaller.
+    if (lodIndices.size() > previousCount * 0.9f)
+    {
+      break;
+    }
+    kdr::Optimize::optimizeVertexCache(lodIndices, vertexCount);
+    // A level no more accurate than the finer one would never be selected, so it replaces it.
+    if (oLods.size() > 1 && error <= oLods.back().error)
+    {
+      oIndices.resize(oLods.back().firstIndex);
+      oLods.pop_back();
+    }
+    oLods.push_back({(GLuint)oIndices.size(), (GLuint)lodIndices.size(), error});
+    oIndices.insert(oIndices.end(), lodIndices.begin(), lodIndices.end());
+  }
+
+  if (!cachePath.empty())
+  {
+    header.vertexCount = oVertices.size() / 11;
+    header.indexCount = oIndices.size();
+    header.lodCount = oLods.size();
+    const size_t lodsSize = oLods.size() * sizeof(kdr::Object::Lod);
+    const size_t verticesSize = oVertices.size() * sizeof(GLfloat);
+    std::vector<char> data(sizeof(header) + lodsSize + verticesSize + oIndices.size() * sizeof(GLuint));
+    char* cursor = data.data();
+    memcpy(cursor, &header, sizeof(header));
+    memcpy(cursor + sizeof(header), oLods.data(), lodsSize);
+    memcpy(cursor + sizeof(header) + lodsSize, oVertices.data(), verticesSize);
+    memcpy(cursor + sizeof(header) + lodsSize + verticesSize, oIndices.data(), oIndices.size() * sizeof(GLuint));
+    if (!kdr::File::writeBinary(cachePath, data.data(), data.size()))
+    {
+      std::cerr << "Failed to write mesh cache (\"" << cachePath << "\")!" << '\n';
+    }
+  }
+  return true;
+}
@@ -0,0 +1,464 @@
+#include "Kedarium/Occlusion.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Kedarium/Jobs.hpp"
+
+namespace
+{
+  /**
+   * @brief Transforms a point into clip space.
+   *
+   * @param matrix The transform, column-major.
+   * @param x The X coordinate of the point.
+   * @param y The Y coordinate of the point.
+   * @param z The Z coordinate of the point.
+   * @param oClip Output array receiving the clip-space X, Y, Z and W.
+   */
+  void transformPoint(const kdr::Space::Mat4& matrix, const float x, const float y, const float z, float* oClip)
+  {
+    for (int row = 0; row < 4; row++)
+    {
+      oClip[row] = matrix[0][row] * x + matrix[1][row] * y + matrix[2][row] * z + matrix[3][row];
+    }
+  }
+}
+
+kdr::OcclusionBuffer::OcclusionBuffer()
+: bins(TILES_X * TILES_Y), depth(WIDTH * HEIGHT, 1.f), blockDepth(BLOCKS_X * BLOCKS_Y, 1.f)
+{}
+
+void kdr::OcclusionBuffer::clear(const kdr::Space::Mat4& viewProjection)
+{
+  this->viewProjection = viewProjection;
+  this->triangles.clear();
+  for (std::vector<uint32_t>& bin : this->bins)
+  {
+    bin.clear();
+  }
+  std::fill(this->blockDepth.begin(), this->blockDepth.end(), 1.f);
+}
+
+void kdr::OcclusionBuffer::addOccluder(const GLfloat* positions, const size_t vertexCount, const GLuint* indices, const size_t indexCount, const kdr::Space::Mat4& model)
+{
+  const kdr::Space::Mat4 matrix = this->viewProjection * model;
+  this->clipVertices.resize(vertexCount * 4);
+  for (size_t v = 0; v < vertexCount; v++)
+  {
+    transformPoint(matrix, positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2], &this->clipVertices[v * 4]);
+  }
+
+  for (size_t i = 0; i + 2 < indexCount; i += 3)
+  {
+    float x[3];
+    float y[3];
+    float z[3];
+    bool clipped {false};
+    for (int k = 0; k < 3; k++)
+    {
+      const float* clip = &this->clipVertices[indices[i + k] * 4];
+      if (clip[2] < -clip[3] || clip[3] <= FLT_EPSILON)
+      {
+        clipped = true;
+        break;
+      }
+      const float inverseW = 1.f / clip[3];
+      x[k] = (clip[0] * inverseW * 0.5f + 0.5f) * WIDTH;
+      y[k] = (clip[1] * inverseW * 0.5f + 0.5f) * HEIGHT;
+      z[k] = clip[2] * inverseW * 0.5f + 0.5f;
+    }
+    if (clipped)
+    {
+      continue;
+    }
+
+    const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area <= 0.f)
+    {
+      continue;
+    }
+
+    Triangle triangle;
+    triangle.minX = std::max(0, (int)std::floor(std::min({x[0], x[1], x[2]})));
+    triangle.minY = std::max(0, (int)std::floor(std::min({y[0], y[1], y[2]})));
+    triangle.maxX = std::min(WIDTH - 1, (int)std::floor(std::max({x[0], x[1], x[2]})));
+    triangle.maxY = std::min(HEIGHT - 1, (int)std::floor(std::max({y[0], y[1], y[2]})));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+    {
+      continue;
+    }
+
+    // Edge k runs from vertex k + 1 to vertex k + 2, so it is zero at both and its value at
+    // vertex k over the area is the barycentric weight of vertex k.
+    for (int k = 0; k < 3; k++)
+    {
+      const int a = (k + 1) % 3;
+      const int b = (k + 2) % 3;
+      triangle.edgeA[k] = y[a] - y[b];
+      triangle.edgeB[k] = x[b] - x[a];
+      triangle.edgeC[k] = x[a] * y[b] - x[b] * y[a];
+    }
+    const float inverseArea = 1.f / area;
+    triangle.depthA = (triangle.edgeA[0] * z[0] + triangle.edgeA[1] * z[1] + triangle.edgeA[2] * z[2]) * inverseArea;
+    triangle.depthB = (triangle.edgeB[0] * z[0] + triangle.edgeB[1] * z[1] + triangle.edgeB[2] * z[2]) * inverseArea;
+    triangle.depthC = (triangle.edgeC[0] * z[0] + triangle.edgeC[1] * z[1] + triangle.edgeC[2] * z[2]) * inverseArea;
+    // Depths are sampled at pixel centers, so the farthest depth within the pixel is kept.
+    triangle.depthC += 0.5f * (std::fabs(triangle.depthA) + std::fabs(triangle.depthB));
+
+    const uint32_t index = (uint32_t)this->triangles.size();
+    this->triangles.push_back(triangle);
+    for (int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; tileY++)
+    {
+      for (int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; tileX++)
+      {
+        this->bins[tileY * TILES_X + tileX].push_back(index);
+      }
+    }
+  }
+}
+
+void kdr::OcclusionBuffer::render()
+{
+  // Tiles are single jobs, since their triangle counts vary widely and idle workers steal them.
+  constexpr size_t tileCount {TILES_X * TILES_Y};
+  const size_t grain = this->triangles.size() < PARALLEL_THRESHOLD ? tileCount : 1;
+  kdr::Core::getJobSystem().parallelFor(tileCount, grain, [this](const size_t begin, const size_t end)
+  {
+    for (size_t tile = begin; tile < end; tile++)
+    {
+      this->_renderTile(tile);
+    }
+  });
+}
+
+bool kdr::OcclusionBuffer::testAABB(const kdr::Bounds::AABB& box) const
+{
+  float minX {FLT_MAX};
+  float minY {FLT_MAX};
+  float maxX {-FLT_MAX};
+  float maxY {-FLT_MAX};
+  float minZ {FLT_MAX};
+  for (int corner = 0; corner < 8; corner++)
+  {
+    float clip[4];
+    transformPoint(
+      this->viewProjection,
+      (corner & 1) ? box.max.x : box.min.x,
+      (corner & 2) ? box.max.y : box.min.y,
+      (corner & 4) ? box.max.z : box.min.z,
+      clip
+    );
+    if (clip[2] < -clip[3] || clip[3] <= FLT_EPSILON)
+    {
+      return true;
+    }
+    const float inverseW = 1.f / clip[3];
+    const float x = (clip[0] * inverseW * 0.5f + 0.5f) * WIDTH;
+    const float y = (clip[1] * inverseW * 0.5f + 0.5f) * HEIGHT;
+    minX = std::min(minX, x);
+    minY = std::min(minY, y);
+    maxX = std::max(maxX, x);
+    maxY = std::max(maxY, y);
+    minZ = std::min(minZ, clip[2] * inverseW * 0.5f + 0.5f);
+  }
+  if (maxX < 0.f || maxY < 0.f || minX >= WIDTH || minY >= HEIGHT)
+  {
+    return true;
+  }
+
+  const int blockMinX = std::max(0, (int)std::floor(minX)) / BLOCK_SIZE;
+  const int blockMinY = std::max(0, (int)std::floor(minY)) / BLOCK_SIZE;
+  const int blockMaxX = std::min(WIDTH - 1, (int)std::floor(maxX)) / BLOCK_SIZE;
+  const int blockMaxY = std::min(HEIGHT - 1, (int)std::floor(maxY)) / BLOCK_SIZE;
+  for (int blockY = blockMinY; blockY <= blockMaxY; blockY++)
+  {
+    for (int blockX = blockMinX; blockX <= blockMaxX; blockX++)
+    {
+      if (minZ <= this->blockDepth[blockY * BLOCKS_X + blockX])
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void kdr::OcclusionBuffer::_renderTile(const int tile)
+{
+  const int tileMinX = (tile % TILES_X) * TILE_WIDTH;
+  const int tileMinY = (tile / TILES_X) * TILE_HEIGHT;
+  const int tileMaxX = tileMinX + TILE_WIDTH - 1;
+  const int tileMaxY = tileMinY + TILE_HEIGHT - 1;
+  float* depth = this->depth.data();
+
+  for (int y = tileMinY; y <= tileMaxY; y++)
+  {
+    std::fill(depth + y * WIDTH + tileMinX, depth + y * WIDTH + tileMaxX + 1, 1.f);
+  }
+
+  for (const uint32_t index : this->bins[tile])
+  {
+    const Triangle& triangle = this->triangles[index];
+    const int minY = std::max(triangle.minY, tileMinY);
+    const int maxY = std::min(triangle.maxY, tileMaxY);
+    const int maxX = std::min(triangle.maxX, tileMaxX);
+    int minX = std::max(triangle.minX, tileMinX);
+
+#ifdef KDR_SIMD_SSE
+    // Tiles are multiples of the SIMD width wide, so aligning the start keeps every group inside.
+    minX &= ~(int)(kdr::SIMD::WIDTH - 1);
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]);
+    const __m128 edgeA1 = _mm_set1_ps(triangle.edgeA[1]);
+    const __m128 edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+    const __m128 depthA = _mm_set1_ps(triangle.depthA);
+
+    for (int y = minY; y <= maxY; y++)
+    {
+      const float centerY = y + 0.5f;
+      const __m128 row0 = _mm_set1_ps(triangle.edgeB[0] * centerY + triangle.edgeC[0]);
+      const __m128 row1 = _mm_set1_ps(triangle.edgeB[1] * centerY + triangle.edgeC[1]);
+      const __m128 row2 = _mm_set1_ps(triangle.edgeB[2] * centerY + triangle.edgeC[2]);
+      const __m128 rowDepth = _mm_set1_ps(triangle.depthB * centerY + triangle.depthC);
+      float* rowPixels = depth + y * WIDTH;
+
+      for (int x = minX; x <= maxX; x += kdr::SIMD::WIDTH)
+      {
+        const __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+        const __m128 inside = _mm_and_ps(
+          _mm_and_ps(
+            _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, centerX), row0), zero),
+            _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, centerX), row1), zero)
+          ),
+          _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, centerX), row2), zero)
+        );
+        if (_mm_movemask_ps(inside) == 0)
+        {
+          continue;
+        }
+        const __m128 pixels = _mm_loadu_ps(rowPixels + x);
+        const __m128 nearest = _mm_min_ps(pixels, _mm_add_ps(_mm_mul_ps(depthA, centerX), rowDepth));
+        _mm_storeu_ps(rowPixels + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, pixels)));
+      }
+    }
+#else
+    for (int y = minY; y <= maxY; y++)
+    {
+      const float centerY = y + 0.5f;
+      float* rowPixels = depth + y * WIDTH;
+      for (int x = minX; x <= maxX; x++)
+      {
+        const float centerX = x + 0.5f;
+        bool inside {true};
+        for (int k = 0; k < 3 && inside; k++)
+        {
+          inside = triangle.edgeA[k] * centerX + triangle.edgeB[k] * centerY + triangle.edgeC[k] >= 0.f;
+        }
+        if (inside)
+        {
+          rowPixels[x] = std::min(rowPixels[x], triangle.depthA * centerX + triangle.depthB * centerY + triangle.depthC);
+        }
+      }
+    }
+#endif
+  }
+
+  for (int blockY = tileMinY / BLOCK_SIZE; blockY <= tileMaxY / BLOCK_SIZE; blockY++)
+  {
+    for (int blockX = tileMinX / BLOCK_SIZE; blockX <= tileMaxX / BLOCK_SIZE; blockX++)
+    {
+      float farthest {0.f};
+      for (int y = blockY * BLOCK_SIZE; y < (blockY + 1) * BLOCK_SIZE; y++)
+      {
+        const float* rowPixels = depth + y * WIDTH + blockX * BLOCK_SIZE;
+        farthest = std::max(farthest, *std::max_element(rowPixels, rowPixels + BLOCK_SIZE));
+      }
+      this->blockDepth[blockY * BLOCKS_X + blockX] = farthest;
+    }
+  }
+}
+
+void kdr::OcclusionQueries::beginFrame()
+{
+  this->frame++;
+  this->queryCount = 0;
+  this->occludedCount = 0;
+
+  for (auto it = this->entries.begin(); it != this->entries.end();)
+  {
+    if (this->frame - it->second.lastFrame > UNUSED_FRAMES)
+    {
+      glDeleteQueries(FRAME_COUNT, it->second.queries);
+      it = this->entries.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+bool kdr::OcclusionQueries::begin(const uint64_t key, const kdr::Bounds::AABB& box, const kdr::Camera& camera)
+{
+  // The near plane reaches past the camera position, so the box is grown by twice its distance.
+  const kdr::Space::Vec3 position = camera.getPosition();
+  const float margin = 2.f * camera.getZNear();
+  if (
+    position.x >= box.min.x - margin && position.x <= box.max.x + margin &&
+    position.y >= box.min.y - margin && position.y <= box.max.y + margin &&
+    position.z >= box.min.z - margin && position.z <= box.max.z + margin
+  )
+  {
+    return false;
+  }
+  if (!this->_initialize())
+  {
+    return false;
+  }
+
+  Entry& entry = this->entries[key];
+  if (entry.queries[0] == 0)
+  {
+    glGenQueries(FRAME_COUNT, entry.queries);
+  }
+  entry.lastFrame = this->frame;
+
+  // Results of earlier frames are read oldest first, stopping at the first one not ready.
+  for (size_t age = FRAME_COUNT - 1; age > 0; age--)
+  {
+    const size_t slot = (this->frame + FRAME_COUNT - age) % FRAME_COUNT;
+    if (!entry.pending[slot])
+    {
+      continue;
+    }
+    GLuint available {GL_FALSE};
+    glGetQueryObjectuiv(entry.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE)
+    {
+      break;
+    }
+    GLuint samples {0};
+    glGetQueryObjectuiv(entry.queries[slot], GL_QUERY_RESULT, &samples);
+    entry.occluded = samples == 0;
+    entry.pending[slot] = false;
+  }
+
+  const size_t slot = this->frame % FRAME_COUNT;
+  const GLboolean culling = glIsEnabled(GL_CULL_FACE);
+  glUseProgram(this->boxShader->getID());
+  glUniformMatrix4fv(this->cameraLocation, 1, GL_FALSE, kdr::Space::valuePointer(camera.getMatrix()));
+  glUniform3f(this->boxMinLocation, box.min.x, box.min.y, box.min.z);
+  glUniform3f(this->boxMaxLocation, box.max.x, box.max.y, box.max.z);
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  glDepthMask(GL_FALSE);
+  glDisable(GL_CULL_FACE);
+
+  glBeginQuery(this->target, entry.queries[slot]);
+  glBindVertexArray(this->boxVertexArray);
+  glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, (const void*)0);
+  glEndQuery(this->target);
+  entry.pending[slot] = true;
+
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glDepthMask(GL_TRUE);
+  if (culling)
+  {
+    glEnable(GL_CULL_FACE);
+  }
+
+  this->queryCount++;
+  if (entry.occluded)
+  {
+    this->occludedCount++;
+  }
+  glBeginConditionalRender(entry.queries[slot], entry.occluded ? GL_QUERY_WAIT : GL_QUERY_NO_WAIT);
+  return true;
+}
+
+void kdr::OcclusionQueries::Delete()
+{
+  for (auto& [key, entry] : this->entries)
+  {
+    glDeleteQueries(FRAME_COUNT, entry.queries);
+  }
+  this->entries.clear();
+  this->boxShader.reset();
+  if (this->boxVertexArray != 0)
+  {
+    glDeleteVertexArrays(1, &this->boxVertexArray);
+    glDeleteBuffers(1, &this->boxVertexBuffer);
+    glDeleteBuffers(1, &this->boxIndexBuffer);
+  }
+  this->boxVertexArray = 0;
+  this->boxVertexBuffer = 0;
+  this->boxIndexBuffer = 0;
+}
+
+bool kdr::OcclusionQueries::_initialize()
+{
+  if (this->boxShader)
+  {
+    return this->boxShader->getID() != 0;
+  }
+
+  static const std::string vertexSource {
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aCorner;\n"
+    "uniform mat4 cameraMatrix;\n"
+    "uniform vec3 boxMin;\n"
+    "uniform vec3 boxMax;\n"
+    "void main()\n"
+    "{\n"
+    "  gl_Position = cameraMatrix * vec4(mix(boxMin, boxMax, aCorner), 1.f);\n"
+    "}\n"
+  };
+  static const std::string fragmentSource {
+    "#version 330 core\n"
+    "out vec4 fragColor;\n"
+    "void main()\n"
+    "{\n"
+    "  fragColor = vec4(1.f);\n"
+    "}\n"
+  };
+  this->boxShader = std::make_unique<kdr::Graphics::Shader>(kdr::Graphics::Shader::fromSources(vertexSource, fragmentSource, "occlusion.vert", "occlusion.frag"));
+  if (!this->boxShader->finalize())
+  {
+    std::cerr << "Failed to create the occlusion query program, queries are disabled.\n";
+    return false;
+  }
+
+  const GLuint program = this->boxShader->getID();
+  this->cameraLocation = glGetUniformLocation(program, "cameraMatrix");
+  this->boxMinLocation = glGetUniformLocation(program, "boxMin");
+  this->boxMaxLocation = glGetUniformLocation(program, "boxMax");
+  this->target = (GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility) ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+  // Corner i has its X, Y and Z at the maximum when bits 0, 1 and 2 of i are set.
+  static const GLfloat corners[] = {
+    0.f, 0.f, 0.f,  1.f, 0.f, 0.f,  0.f, 1.f, 0.f,  1.f, 1.f, 0.f,
+    0.f, 0.f, 1.f,  1.f, 0.f, 1.f,  0.f, 1.f, 1.f,  1.f, 1.f, 1.f,
+  };
+  static const GLubyte faces[] = {
+    0, 2, 1,  1, 2, 3, // Back
+    4, 5, 6,  5, 7, 6, // Front
+    0, 1, 4,  1, 5, 4, // Bottom
+    2, 6, 3,  3, 6, 7, // Top
+    0, 4, 2,  2, 4, 6, // Left
+    1, 3, 5,  3, 7, 5, // Right
+  };
+  glGenVertexArrays(1, &this->boxVertexArray);
+  glGenBuffers(1, &this->boxVertexBuffer);
+  glGenBuffers(1, &this->boxIndexBuffer);
+  glBindVertexArray(this->boxVertexArray);
+  glBindBuffer(GL_ARRAY_BUFFER, this->boxVertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->boxIndexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+  glEnableVertexAttribArray(0);
+  glBindVertexArray(0);
+  return true;
+}
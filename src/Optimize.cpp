@@ -0,0 +1,837 @@
+#include "Kedarium/Optimize.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <numeric>
+#include <unordered_set>
+
+namespace
+{
+  constexpr int   FORSYTH_CACHE_SIZE  {32};
+  constexpr float CACHE_DECAY_POWER   {1.5f};
+  constexpr float LAST_TRIANGLE_SCORE {0.75f};
+  constexpr float VALENCE_BOOST_SCALE {2.f};
+  constexpr float VALENCE_BOOST_POWER {0.5f};
+
+  constexpr GLuint INVALID_VERTEX {0xFFFFFFFF};
+
+  constexpr double BORDER_WEIGHT {10.0};
+
+  /**
+   * @brief Struct holding a symmetric 4x4 error quadric and the weight of its planes.
+   */
+  struct Quadric
+  {
+    double a2     {0.0};
+    double b2     {0.0};
+    double c2     {0.0};
+    double d2     {0.0};
+    double ab     {0.0};
+    double ac     {0.0};
+    double ad     {0.0};
+    double bc     {0.0};
+    double bd     {0.0};
+    double cd     {0.0};
+    double weight {0.0};
+  };
+
+  /**
+   * @brief Scores a vertex for Forsyth's algorithm.
+   *
+   * @param cachePosition The position of the vertex in the simulated LRU cache, or -1 if not cached.
+   * @param remainingTriangles The number of triangles using the vertex that are not emitted yet.
+   * @return The score, or -1 if the vertex has no triangles left.
+   */
+  float scoreVertex(const int cachePosition, const GLuint remainingTriangles)
+  {
+    if (remainingTriangles == 0)
+    {
+      return -1.f;
+    }
+
+    float score {0.f};
+    if (cachePosition >= 0)
+    {
+      // The vertices of the last triangle get a fixed score, so the next triangle does not
+      // simply reuse the same edge and strip along.
+      if (cachePosition < 3)
+      {
+        score = LAST_TRIANGLE_SCORE;
+      }
+      else
+      {
+        score = powf(1.f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+      }
+    }
+    // Vertices with few triangles left are finished first to avoid leaving lone triangles behind.
+    return score + VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+  }
+
+  /**
+   * @brief Adds the squared distance to a plane to a quadric.
+   *
+   * @param ioQuadric The quadric to add to.
+   * @param normal The unit normal of the plane.
+   * @param point A point on the plane.
+   * @param weight The weight of the plane.
+   */
+  void addPlane(Quadric& ioQuadric, const double normal[3], const GLfloat* point, const double weight)
+  {
+    const double a = normal[0];
+    const double b = normal[1];
+    const double c = normal[2];
+    const double d = -(a * point[0] + b * point[1] + c * point[2]);
+    ioQuadric.a2 += a * a * weight;
+    ioQuadric.b2 += b * b * weight;
+    ioQuadric.c2 += c * c * weight;
+    ioQuadric.d2 += d * d * weight;
+    ioQuadric.ab += a * b * weight;
+    ioQuadric.ac += a * c * weight;
+    ioQuadric.ad += a * d * weight;
+    ioQuadric.bc += b * c * weight;
+    ioQuadric.bd += b * d * weight;
+    ioQuadric.cd += c * d * weight;
+    ioQuadric.weight += weight;
+  }
+
+  /**
+   * @brief Adds one quadric to another.
+   *
+   * @param ioQuadric The quadric to add to.
+   * @param other The quadric to add.
+   */
+  void addQuadric(Quadric& ioQuadric, const Quadric& other)
+  {
+    ioQuadric.a2 += other.a2;
+    ioQuadric.b2 += other.b2;
+    ioQuadric.c2 += other.c2;
+    ioQuadric.d2 += other.d2;
+    ioQuadric.ab += other.ab;
+    ioQuadric.ac += other.ac;
+    ioQuadric.ad += other.ad;
+    ioQuadric.bc += other.bc;
+    ioQuadric.bd += other.bd;
+    ioQuadric.cd += other.cd;
+    ioQuadric.weight += other.weight;
+  }
+
+  /**
+   * @brief Evaluates a quadric at a point.
+   *
+   * @param quadric The quadric.
+   * @param point The point.
+   * @return The weighted mean squared distance of the point to the planes of the quadric.
+   */
+  double evaluateQuadric(const Quadric& quadric, const GLfloat* point)
+  {
+    if (quadric.weight <= 0.0)
+    {
+      return 0.0;
+    }
+    const double x = point[0];
+    const double y = point[1];
+    const double z = point[2];
+    const double error =
+      quadric.a2 * x * x + quadric.b2 * y * y + quadric.c2 * z * z + quadric.d2
+      + 2.0 * (quadric.ab * x * y + quadric.ac * x * z + quadric.ad * x + quadric.bc * y * z + quadric.bd * y + quadric.cd * z);
+    return fabs(error) / quadric.weight;
+  }
+
+  /**
+   * @brief Computes the unnormalized normal of a triangle.
+   *
+   * @param p0 The first corner.
+   * @param p1 The second corner.
+   * @param p2 The third corner.
+   * @param oNormal Output parameter receiving the cross product of the edges from p0.
+   */
+  void triangleNormal(const GLfloat* p0, const GLfloat* p1, const GLfloat* p2, double oNormal[3])
+  {
+    const double ab[3] {(double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2]};
+    const double ac[3] {(double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2]};
+    oNormal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    oNormal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    oNormal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+  }
+
+  /**
+   * @brief Packs a directed edge between two vertices into a key.
+   *
+   * @param from The start vertex.
+   * @param to The end vertex.
+   * @return The key of the edge.
+   */
+  uint64_t edgeKey(const GLuint from, const GLuint to)
+  {
+    return ((uint64_t)from << 32) | to;
+  }
+
+  /**
+   * @brief Class simulating a FIFO post-transform cache.
+   */
+  class FifoCache
+  {
+    public:
+      /**
+       * @brief Constructs an empty cache.
+       *
+       * @param vertexCount The number of vertices that can be referenced.
+       * @param cacheSize The number of cache entries.
+       */
+      FifoCache(const size_t vertexCount, const unsigned int cacheSize)
+      : cacheSize(cacheSize), timestamps(vertexCount, 0), time(cacheSize + 1)
+      {}
+
+      /**
+       * @brief References a vertex, inserting it if it is not cached.
+       *
+       * @param vertex The index of the vertex.
+       * @return True on a cache miss, false on a hit.
+       */
+      bool reference(const GLuint vertex)
+      {
+        // A vertex is cached if fewer than cacheSize vertices were inserted after it.
+        if (this->time - this->timestamps[vertex] > this->cacheSize)
+        {
+          this->timestamps[vertex] = this->time++;
+          return true;
+        }
+        return false;
+      }
+      /**
+       * @brief Empties the cache.
+       */
+      void flush()
+      { this->time += this->cacheSize + 1; }
+
+    private:
+      unsigned int        cacheSize {0};
+      std::vector<size_t> timestamps;
+      size_t              time      {0};
+  };
+}
+
+kdr::Optimize::CacheStats kdr::Optimize::analyzeVertexCache(const std::vector<GLuint>& indices, const size_t vertexCount, const unsigned int cacheSize)
+{
+  kdr::Optimize::CacheStats stats;
+  if (indices.size() < 3)
+  {
+    return stats;
+  }
+
+  FifoCache cache(vertexCount, cacheSize);
+  std::vector<bool> referenced(vertexCount, false);
+  size_t misses {0};
+  size_t uniqueVertices {0};
+  for (const GLuint index : indices)
+  {
+    misses += cache.reference(index);
+    if (!referenced[index])
+    {
+      referenced[index] = true;
+      uniqueVertices++;
+    }
+  }
+
+  stats.acmr = (float)misses / (indices.size() / 3);
+  stats.atvr = (float)misses / uniqueVertices;
+  return stats;
+}
+
+void kdr::Optimize::optimizeVertexCache(std::vector<GLuint>& ioIndices, const size_t vertexCount)
+{
+  const size_t triangleCount = ioIndices.size() / 3;
+  if (triangleCount == 0)
+  {
+    return;
+  }
+
+  // Triangles of each vertex. The live ones of vertex v are the first remaining[v] entries
+  // starting at adjacencyOffsets[v], and emitted triangles are swapped out of that range.
+  std::vector<GLuint> adjacencyOffsets(vertexCount + 1, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++)
+  {
+    adjacencyOffsets[ioIndices[i] + 1]++;
+  }
+  std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+  std::vector<GLuint> remaining(vertexCount, 0);
+  std::vector<GLuint> adjacency(triangleCount * 3);
+  for (size_t i = 0; i < triangleCount * 3; i++)
+  {
+    const GLuint vertex = ioIndices[i];
+    adjacency[adjacencyOffsets[vertex] + remaining[vertex]++] = i / 3;
+  }
+
+  std::vector<int>   cachePositions(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    vertexScores[i] = scoreVertex(-1, remaining[i]);
+  }
+
+  std::vector<bool>   emitted(triangleCount, false);
+  std::vector<GLuint> result;
+  std::vector<GLuint> cache;
+  std::vector<GLuint> nextCache;
+  result.reserve(triangleCount * 3);
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+  size_t deadEndCursor {0};
+  long   bestTriangle  {-1};
+  while (result.size() < triangleCount * 3)
+  {
+    // Nothing in the cache has triangles left, so continue with the next one in input order.
+    if (bestTriangle < 0)
+    {
+      while (emitted[deadEndCursor])
+      {
+        deadEndCursor++;
+      }
+      bestTriangle = deadEndCursor;
+    }
+
+    const GLuint* triangle = &ioIndices[bestTriangle * 3];
+    result.insert(result.end(), triangle, triangle + 3);
+    emitted[bestTriangle] = true;
+
+    for (int corner = 0; corner < 3; corner++)
+    {
+      const GLuint vertex = triangle[corner];
+      GLuint* begin = &adjacency[adjacencyOffsets[vertex]];
+      GLuint* end = begin + remaining[vertex];
+      GLuint* found = std::find(begin, end, (GLuint)bestTriangle);
+      if (found != end)
+      {
+        *found = *(end - 1);
+        remaining[vertex]--;
+      }
+    }
+
+    nextCache.clear();
+    for (int corner = 0; corner < 3; corner++)
+    {
+      if (std::find(nextCache.begin(), nextCache.end(), triangle[corner]) == nextCache.end())
+      {
+        nextCache.push_back(triangle[corner]);
+      }
+    }
+    for (const GLuint vertex : cache)
+    {
+      if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+      {
+        nextCache.push_back(vertex);
+      }
+    }
+
+    for (size_t i = 0; i < nextCache.size(); i++)
+    {
+      const GLuint vertex = nextCache[i];
+      cachePositions[vertex] = i < (size_t)FORSYTH_CACHE_SIZE ? (int)i : -1;
+      vertexScores[vertex] = scoreVertex(cachePositions[vertex], remaining[vertex]);
+    }
+    nextCache.resize(std::min<size_t>(nextCache.size(), FORSYTH_CACHE_SIZE));
+    cache.swap(nextCache);
+
+    // Only triangles touching the cache can be the next best one.
+    bestTriangle = -1;
+    float bestScore {0.f};
+    for (const GLuint vertex : cache)
+    {
+      for (GLuint i = 0; i < remaining[vertex]; i++)
+      {
+        const GLuint candidate = adjacency[adjacencyOffsets[vertex] + i];
+        const GLuint* corners = &ioIndices[candidate * 3];
+        const float score = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+        if (score > bestScore)
+        {
+          bestScore = score;
+          bestTriangle = candidate;
+        }
+      }
+    }
+  }
+
+  ioIndices.swap(result);
+}
+
+void kdr::Optimize::optimizeOverdraw(std::vector<GLuint>& ioIndices, const GLfloat* vertices, const size_t vertexCount, const size_t stride, const float threshold)
+{
+  const size_t triangleCount = ioIndices.size() / 3;
+  if (triangleCount < 2)
+  {
+    return;
+  }
+
+  FifoCache cache(vertexCount, kdr::Optimize::SIMULATED_CACHE_SIZE);
+  auto countMisses = [&](const size_t triangle)
+  {
+    return cache.reference(ioIndices[triangle * 3])
+      + cache.reference(ioIndices[triangle * 3 + 1])
+      + cache.reference(ioIndices[triangle * 3 + 2]);
+  };
+
+  // Hard boundaries are triangles where every vertex misses, so the cache is cold anyway.
+  std::vector<size_t> hardBoundaries {0};
+  for (size_t i = 0; i < triangleCount; i++)
+  {
+    if (countMisses(i) == 3 && i > 0)
+    {
+      hardBoundaries.push_back(i);
+    }
+  }
+  hardBoundaries.push_back(triangleCount);
+
+  // Soft boundaries split a hard cluster wherever the ACMR so far stays within the threshold
+  // of the whole cluster, starting each piece with a cold cache.
+  std::vector<size_t> clusters;
+  for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+  {
+    const size_t begin = hardBoundaries[h];
+    const size_t end = hardBoundaries[h + 1];
+
+    cache.flush();
+    size_t clusterMisses {0};
+    for (size_t i = begin; i < end; i++)
+    {
+      clusterMisses += countMisses(i);
+    }
+    const float limit = threshold * clusterMisses / (end - begin);
+
+    cache.flush();
+    clusters.push_back(begin);
+    size_t start {begin};
+    size_t misses {0};
+    for (size_t i = begin; i < end; i++)
+    {
+      misses += countMisses(i);
+      if (i + 1 < end && (float)misses / (i + 1 - start) <= limit)
+      {
+        cache.flush();
+        clusters.push_back(i + 1);
+        start = i + 1;
+        misses = 0;
+      }
+    }
+  }
+  clusters.push_back(triangleCount);
+
+  // Area weighted centroids and normals. The cross product is twice the area times the normal.
+  const size_t clusterCount = clusters.size() - 1;
+  std::vector<float> clusterData(clusterCount * 7, 0.f);
+  float meshCentroid[3] {0.f, 0.f, 0.f};
+  float meshArea {0.f};
+  for (size_t c = 0; c < clusterCount; c++)
+  {
+    float* data = &clusterData[c * 7];
+    for (size_t i = clusters[c]; i < clusters[c + 1]; i++)
+    {
+      const GLfloat* p0 = vertices + ioIndices[i * 3] * stride;
+      const GLfloat* p1 = vertices + ioIndices[i * 3 + 1] * stride;
+      const GLfloat* p2 = vertices + ioIndices[i * 3 + 2] * stride;
+      const float ab[3] {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      const float ac[3] {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      const float cross[3] {
+        ab[1] * ac[2] - ab[2] * ac[1],
+        ab[2] * ac[0] - ab[0] * ac[2],
+        ab[0] * ac[1] - ab[1] * ac[0]
+      };
+      const float area = sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+      for (int axis = 0; axis < 3; axis++)
+      {
+        data[axis] += (p0[axis] + p1[axis] + p2[axis]) / 3.f * area;
+        data[3 + axis] += cross[axis];
+      }
+      data[6] += area;
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+      meshCentroid[axis] += data[axis];
+    }
+    meshArea += data[6];
+  }
+  if (meshArea <= 0.f)
+  {
+    return;
+  }
+  for (int axis = 0; axis < 3; axis++)
+  {
+    meshCentroid[axis] /= meshArea;
+  }
+
+  std::vector<float> sortKeys(clusterCount, 0.f);
+  for (size_t c = 0; c < clusterCount; c++)
+  {
+    const float* data = &clusterData[c * 7];
+    const float normalLength = sqrtf(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+    if (data[6] <= 0.f || normalLength <= 0.f)
+    {
+      continue;
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+      sortKeys[c] += (data[axis] / data[6] - meshCentroid[axis]) * data[3 + axis] / normalLength;
+    }
+  }
+
+  std::vector<size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b)
+  {
+    return sortKeys[a] > sortKeys[b];
+  });
+
+  std::vector<GLuint> result;
+  result.reserve(ioIndices.size());
+  for (const size_t c : order)
+  {
+    result.insert(result.end(), ioIndices.begin() + clusters[c] * 3, ioIndices.begin() + clusters[c + 1] * 3);
+  }
+  ioIndices.swap(result);
+}
+
+void kdr::Optimize::optimizeVertexFetch(std::vector<GLfloat>& ioVertices, const size_t stride, std::vector<GLuint>& ioIndices)
+{
+  std::vector<GLuint>  remap(ioVertices.size() / stride, INVALID_VERTEX);
+  std::vector<GLfloat> result;
+  result.reserve(ioVertices.size());
+
+  GLuint nextVertex {0};
+  for (GLuint& index : ioIndices)
+  {
+    if (remap[index] == INVALID_VERTEX)
+    {
+      remap[index] = nextVertex++;
+      result.insert(result.end(), ioVertices.begin() + index * stride, ioVertices.begin() + (index + 1) * stride);
+    }
+    index = remap[index];
+  }
+  ioVertices.swap(result);
+}
+
+float kdr::Optimize::simplify(const GLfloat* vertices, const size_t vertexCount, const size_t stride, const std::vector<GLuint>& indices, const size_t targetIndexCount, const float maxError, std::vector<GLuint>& oIndices)
+{
+  oIndices = indices;
+  if (indices.size() <= targetIndexCount)
+  {
+    return 0.f;
+  }
+
+  // Vertices sharing a position, such as both sides of a texture seam, move together. Each
+  // position is represented by its first vertex, and wedges links the vertices of a
+  // position into a ring.
+  std::vector<GLuint> positionRemap(vertexCount);
+  std::vector<GLuint> wedges(vertexCount);
+  std::map<std::array<GLfloat, 3>, GLuint> positions;
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    const GLfloat* position = vertices + i * stride;
+    const GLuint representative = positions.insert({{position[0], position[1], position[2]}, (GLuint)i}).first->second;
+    positionRemap[i] = representative;
+    wedges[i] = i;
+    if (representative != i)
+    {
+      wedges[i] = wedges[representative];
+      wedges[representative] = i;
+    }
+  }
+  auto positionOf = [&](const GLuint vertex)
+  {
+    return vertices + positionRemap[vertex] * stride;
+  };
+
+  std::unordered_set<uint64_t> edges;
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i < indices.size(); i += 3)
+  {
+    const GLuint corners[3] {positionRemap[indices[i]], positionRemap[indices[i + 1]], positionRemap[indices[i + 2]]};
+    double normal[3];
+    triangleNormal(positionOf(corners[0]), positionOf(corners[1]), positionOf(corners[2]), normal);
+    const double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (length <= 0.0)
+    {
+      continue;
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+      normal[axis] /= length;
+    }
+    for (int corner = 0; corner < 3; corner++)
+    {
+      addPlane(quadrics[corners[corner]], normal, positionOf(corners[0]), length * 0.5);
+      edges.insert(edgeKey(corners[corner], corners[(corner + 1) % 3]));
+    }
+  }
+
+  // Open borders get planes perpendicular to their triangles, so they keep their outline.
+  for (size_t i = 0; i < indices.size(); i += 3)
+  {
+    const GLuint corners[3] {positionRemap[indices[i]], positionRemap[indices[i + 1]], positionRemap[indices[i + 2]]};
+    double normal[3];
+    triangleNormal(positionOf(corners[0]), positionOf(corners[1]), positionOf(corners[2]), normal);
+    for (int corner = 0; corner < 3; corner++)
+    {
+      const GLuint from = corners[corner];
+      const GLuint to = corners[(corner + 1) % 3];
+      if (from == to || edges.count(edgeKey(to, from)))
+      {
+        continue;
+      }
+      const GLfloat* a = positionOf(from);
+      const GLfloat* b = positionOf(to);
+      const double edge[3] {(double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2]};
+      double plane[3] {
+        edge[1] * normal[2] - edge[2] * normal[1],
+        edge[2] * normal[0] - edge[0] * normal[2],
+        edge[0] * normal[1] - edge[1] * normal[0]
+      };
+      const double length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+      if (length <= 0.0)
+      {
+        continue;
+      }
+      for (int axis = 0; axis < 3; axis++)
+      {
+        plane[axis] /= length;
+      }
+      const double weight = (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]) * BORDER_WEIGHT;
+      addPlane(quadrics[from], plane, a, weight);
+      addPlane(quadrics[to], plane, a, weight);
+    }
+  }
+
+  /**
+   * @brief Struct describing a candidate collapse of one position onto another.
+   */
+  struct Collapse
+  {
+    GLuint from  {0};
+    GLuint to    {0};
+    double error {0.0};
+  };
+
+  const double errorLimit = (double)maxError * maxError;
+  double resultError {0.0};
+
+  std::vector<GLuint>   adjacencyOffsets;
+  std::vector<GLuint>   adjacency;
+  std::vector<GLuint>   filled;
+  std::vector<bool>     border;
+  std::vector<bool>     locked;
+  std::vector<GLuint>   collapseRemap(vertexCount);
+  std::vector<Collapse> candidates;
+  std::vector<GLuint>   result;
+
+  // Every pass collapses the cheapest edges whose neighbourhoods do not overlap, so the
+  // checks of one collapse are not invalidated by another in the same pass.
+  while (oIndices.size() > targetIndexCount)
+  {
+    adjacencyOffsets.assign(vertexCount + 1, 0);
+    for (const GLuint index : oIndices)
+    {
+      adjacencyOffsets[positionRemap[index] + 1]++;
+    }
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+    adjacency.resize(oIndices.size());
+    filled.assign(vertexCount, 0);
+    for (size_t i = 0; i < oIndices.size(); i++)
+    {
+      const GLuint position = positionRemap[oIndices[i]];
+      adjacency[adjacencyOffsets[position] + filled[position]++] = i / 3;
+    }
+
+    edges.clear();
+    for (size_t i = 0; i < oIndices.size(); i += 3)
+    {
+      for (int corner = 0; corner < 3; corner++)
+      {
+        edges.insert(edgeKey(positionRemap[oIndices[i + corner]], positionRemap[oIndices[i + (corner + 1) % 3]]));
+      }
+    }
+    auto isBorderEdge = [&](const GLuint a, const GLuint b)
+    {
+      return edges.count(edgeKey(a, b)) != edges.count(edgeKey(b, a));
+    };
+
+    border.assign(vertexCount, false);
+    candidates.clear();
+    for (size_t i = 0; i < oIndices.size(); i += 3)
+    {
+      for (int corner = 0; corner < 3; corner++)
+      {
+        const GLuint a = positionRemap[oIndices[i + corner]];
+        const GLuint b = positionRemap[oIndices[i + (corner + 1) % 3]];
+        if (a != b && isBorderEdge(a, b))
+        {
+          border[a] = true;
+          border[b] = true;
+        }
+      }
+    }
+    for (size_t i = 0; i < oIndices.size(); i += 3)
+    {
+      for (int corner = 0; corner < 3; corner++)
+      {
+        const GLuint a = positionRemap[oIndices[i + corner]];
+        const GLuint b = positionRemap[oIndices[i + (corner + 1) % 3]];
+        if (a == b)
+        {
+          continue;
+        }
+        // Border positions only slide along the border, or the outline would shrink.
+        const bool borderEdge = isBorderEdge(a, b);
+        if (!border[a] || borderEdge)
+        {
+          candidates.push_back({a, b, evaluateQuadric(quadrics[a], vertices + b * stride)});
+        }
+        if (!border[b] || borderEdge)
+        {
+          candidates.push_back({b, a, evaluateQuadric(quadrics[b], vertices + a * stride)});
+        }
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b)
+    {
+      return a.error < b.error;
+    });
+
+    // A collapse removes about two triangles.
+    const size_t collapseGoal = std::max<size_t>(1, (oIndices.size() - targetIndexCount) / 6);
+    size_t collapses {0};
+    locked.assign(vertexCount, false);
+    std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+
+    for (const Collapse& collapse : candidates)
+    {
+      if (collapses >= collapseGoal || collapse.error > errorLimit)
+      {
+        break;
+      }
+      if (locked[collapse.from] || locked[collapse.to])
+      {
+        continue;
+      }
+
+      const GLuint* begin = &adjacency[adjacencyOffsets[collapse.from]];
+      const GLuint* end = &adjacency[adjacencyOffsets[collapse.from + 1]];
+
+      // Every vertex of the position must share a triangle with a vertex of the target, which
+      // becomes its replacement. Otherwise the collapse would cross a seam.
+      bool valid {true};
+      GLuint wedge = collapse.from;
+      do
+      {
+        GLuint replacement {INVALID_VERTEX};
+        bool used {false};
+        for (const GLuint* triangle = begin; triangle != end && replacement == INVALID_VERTEX; triangle++)
+        {
+          const GLuint* corners = &oIndices[*triangle * 3];
+          if (corners[0] != wedge && corners[1] != wedge && corners[2] != wedge)
+          {
+            continue;
+          }
+          used = true;
+          for (int corner = 0; corner < 3; corner++)
+          {
+            if (positionRemap[corners[corner]] == collapse.to)
+            {
+              replacement = corners[corner];
+            }
+          }
+        }
+        if (used && replacement == INVALID_VERTEX)
+        {
+          valid = false;
+          break;
+        }
+        collapseRemap[wedge] = used ? replacement : collapse.to;
+        wedge = wedges[wedge];
+      } while (wedge != collapse.from);
+
+      // Triangles that stay must not flip when the position moves.
+      for (const GLuint* triangle = begin; triangle != end && valid; triangle++)
+      {
+        const GLuint corners[3] {
+          positionRemap[oIndices[*triangle * 3]],
+          positionRemap[oIndices[*triangle * 3 + 1]],
+          positionRemap[oIndices[*triangle * 3 + 2]]
+        };
+        if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+        {
+          continue;
+        }
+        const GLfloat* moved[3];
+        for (int corner = 0; corner < 3; corner++)
+        {
+          moved[corner] = vertices + (corners[corner] == collapse.from ? collapse.to : corners[corner]) * stride;
+        }
+        double before[3];
+        double after[3];
+        triangleNormal(positionOf(corners[0]), positionOf(corners[1]), positionOf(corners[2]), before);
+        triangleNormal(moved[0], moved[1], moved[2], after);
+        const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        const double lengths = sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2])
+          * sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+        if (dot <= 1e-2 * lengths)
+        {
+          valid = false;
+        }
+      }
+
+      if (!valid)
+      {
+        wedge = collapse.from;
+        do
+        {
+          collapseRemap[wedge] = wedge;
+          wedge = wedges[wedge];
+        } while (wedge != collapse.from);
+        continue;
+      }
+
+      addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+      resultError = std::max(resultError, collapse.error);
+      for (const GLuint* triangle = begin; triangle != end; triangle++)
+      {
+        for (int corner = 0; corner < 3; corner++)
+        {
+          locked[positionRemap[oIndices[*triangle * 3 + corner]]] = true;
+        }
+      }
+      collapses++;
+    }
+
+    if (collapses == 0)
+    {
+      break;
+    }
+
+    result.clear();
+    for (size_t i = 0; i < oIndices.size(); i += 3)
+    {
+      const GLuint corners[3] {collapseRemap[oIndices[i]], collapseRemap[oIndices[i + 1]], collapseRemap[oIndices[i + 2]]};
+      const GLuint p0 = positionRemap[corners[0]];
+      const GLuint p1 = positionRemap[corners[1]];
+      const GLuint p2 = positionRemap[corners[2]];
+      if (p0 != p1 && p1 != p2 && p0 != p2)
+      {
+        result.insert(result.end(), corners, corners + 3);
+      }
+    }
+    oIndices.swap(result);
+  }
+
+  return (float)sqrt(resultError);
+}
+
+void kdr::Optimize::optimizeMesh(std::vector<GLfloat>& ioVertices, const size_t stride, std::vector<GLuint>& ioIndices)
+{
+  const size_t vertexCount = ioVertices.size() / stride;
+  kdr::Optimize::optimizeVertexCache(ioIndices, vertexCount);
+  kdr::Optimize::optimizeOverdraw(ioIndices, ioVertices.data(), vertexCount, stride);
+  kdr::Optimize::optimizeVertexFetch(ioVertices, stride, ioIndices);
+}
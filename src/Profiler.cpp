@@ -0,0 +1,254 @@
+#include "Kedarium/Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void kdr::Profiler::beginFrame()
+{
+  this->gpuFrameIndex = (this->gpuFrameIndex + 1) % GPU_FRAME_COUNT;
+  GpuFrame& frame = this->gpuFrames[this->gpuFrameIndex];
+  this->resolveGpuFrame(frame);
+  frame.used = 0;
+
+  this->frameScopes.clear();
+  this->frameStart = this->now();
+}
+
+void kdr::Profiler::endFrame()
+{
+  const double end = this->now();
+  const double milliseconds = (end - this->frameStart) / 1000.0;
+
+  if (this->frameTimes.size() < this->historySize)
+  {
+    this->frameTimes.push_back(milliseconds);
+  }
+  else if (this->historySize > 0)
+  {
+    this->frameTimes[this->frameCursor] = milliseconds;
+    this->frameCursor = (this->frameCursor + 1) % this->historySize;
+  }
+
+  if (this->capturing)
+  {
+    Event frameEvent;
+    frameEvent.name = "Frame";
+    frameEvent.start = this->frameStart;
+    frameEvent.duration = end - this->frameStart;
+    this->events.push_back(frameEvent);
+  }
+  std::swap(this->frameScopes, this->lastFrameScopes);
+}
+
+void kdr::Profiler::beginScope(const std::string& name)
+{
+  if (!this->isOwnerThread())
+  {
+    return;
+  }
+  Event scope;
+  scope.name = name;
+  scope.start = this->now();
+  scope.depth = (int)this->openScopes.size() + 1;
+  this->openScopes.push_back(scope);
+}
+
+void kdr::Profiler::endScope()
+{
+  if (!this->isOwnerThread())
+  {
+    return;
+  }
+  if (this->openScopes.empty())
+  {
+    std::cerr << "Profiler scope ended without a matching begin!" << std::endl;
+    return;
+  }
+  Event scope = this->openScopes.back();
+  this->openScopes.pop_back();
+  scope.duration = this->now() - scope.start;
+
+  if (this->capturing)
+  {
+    this->events.push_back(scope);
+  }
+  this->frameScopes.push_back(scope);
+}
+
+void kdr::Profiler::beginGpuScope(const std::string& name)
+{
+  if (!this->isOwnerThread())
+  {
+    return;
+  }
+  GpuFrame& frame = this->gpuFrames[this->gpuFrameIndex];
+  if (frame.used == frame.queries.size())
+  {
+    GpuQuery query;
+    glGenQueries(1, &query.beginID);
+    glGenQueries(1, &query.endID);
+    frame.queries.push_back(query);
+  }
+  GpuQuery& query = frame.queries[frame.used];
+  query.name = name;
+  query.start = this->now();
+  query.depth = (int)this->openGpuScopes.size() + 1;
+  query.ended = false;
+
+  // Timestamps, unlike elapsed time queries, may overlap, so scopes nest.
+  glQueryCounter(query.beginID, GL_TIMESTAMP);
+  frame.lastID = query.beginID;
+  this->openGpuScopes.push_back(frame.used++);
+}
+
+void kdr::Profiler::endGpuScope()
+{
+  if (!this->isOwnerThread())
+  {
+    return;
+  }
+  if (this->openGpuScopes.empty())
+  {
+    std::cerr << "Profiler GPU scope ended without a matching begin!" << std::endl;
+    return;
+  }
+  GpuFrame& frame = this->gpuFrames[this->gpuFrameIndex];
+  GpuQuery& query = frame.queries[this->openGpuScopes.back()];
+  this->openGpuScopes.pop_back();
+  glQueryCounter(query.endID, GL_TIMESTAMP);
+  frame.lastID = query.endID;
+  query.ended = true;
+}
+
+kdr::FrameStats kdr::Profiler::getFrameStats() const
+{
+  kdr::FrameStats stats;
+  stats.frameCount = this->frameTimes.size();
+  if (stats.frameCount == 0) return stats;
+
+  std::vector<double> sorted = this->frameTimes;
+  std::sort(sorted.begin(), sorted.end());
+
+  double sum = 0.0;
+  for (const double time : sorted)
+  {
+    sum += time;
+  }
+  const auto percentile = [&sorted](const double fraction)
+  {
+    const size_t rank = (size_t)std::ceil(fraction * sorted.size());
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+  };
+
+  stats.average = sum / sorted.size();
+  stats.minimum = sorted.front();
+  stats.maximum = sorted.back();
+  stats.p50 = percentile(0.50);
+  stats.p95 = percentile(0.95);
+  stats.p99 = percentile(0.99);
+  return stats;
+}
+
+double kdr::Profiler::getScopeMilliseconds(const std::string& name) const
+{
+  double total = 0.0;
+  for (const Event& scope : this->lastFrameScopes)
+  {
+    if (scope.name == name) total += scope.duration;
+  }
+  return total / 1000.0;
+}
+
+double kdr::Profiler::getGpuScopeMilliseconds(const std::string& name) const
+{
+  for (const Event& result : this->gpuResults)
+  {
+    if (result.name == name) return result.duration / 1000.0;
+  }
+  return 0.0;
+}
+
+bool kdr::Profiler::exportChromeTrace(const std::string& path) const
+{
+  std::ofstream file(path);
+  if (!file.is_open())
+  {
+    std::cerr << "Failed to open trace file: " << path << std::endl;
+    return false;
+  }
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+  file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+  for (const Event& event : this->events)
+  {
+    std::string name;
+    for (const char character : event.name)
+    {
+      if (character == '"' || character == '\\') name += '\\';
+      name += character;
+    }
+    file << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+         << "\",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration
+         << ",\"pid\":0,\"tid\":" << (event.gpu ? 1 : 0) << "}";
+  }
+  file << "\n]}\n";
+
+  if (!file.good())
+  {
+    std::cerr << "Failed to write trace file: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void kdr::Profiler::Delete()
+{
+  this->openGpuScopes.clear();
+  for (GpuFrame& frame : this->gpuFrames)
+  {
+    for (const GpuQuery& query : frame.queries)
+    {
+      glDeleteQueries(1, &query.beginID);
+      glDeleteQueries(1, &query.endID);
+    }
+    frame.queries.clear();
+    frame.used = 0;
+  }
+}
+
+void kdr::Profiler::resolveGpuFrame(GpuFrame& frame)
+{
+  if (frame.used == 0) return;
+
+  // The slot was issued GPU_FRAME_COUNT - 1 frames ago; if the GPU is still further
+  // behind, its results are dropped instead of stalling the pipeline. Timestamps complete
+  // in order, so the last one issued decides for all of them.
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(frame.lastID, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available == GL_FALSE) return;
+
+  this->gpuResults.clear();
+  for (size_t i = 0; i < frame.used; i++)
+  {
+    const GpuQuery& query = frame.queries[i];
+    if (!query.ended) continue;
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(query.beginID, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(query.endID, GL_QUERY_RESULT, &end);
+
+    Event result;
+    result.name = query.name;
+    result.start = query.start;
+    result.duration = (end - begin) / 1000.0;
+    result.depth = query.depth;
+    result.gpu = true;
+    this->gpuResults.push_back(result);
+
+    if (this->capturing)
+    {
+      this->events.push_back(result);
+    }
+  }
+}
@@ -0,0 +1,279 @@
+#include "Kedarium/Raycast.hpp"
+
+#include <algorithm>
+
+namespace
+{
+  constexpr int   BIN_COUNT        {12};
+  constexpr float HIT_EPSILON      {1e-7f};
+  constexpr float DISTANCE_EPSILON {1e-5f};
+
+  float getAxis(const kdr::Space::Vec3& vec, const int axis)
+  {
+    return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+  }
+}
+
+void kdr::Raycast::TriangleBVH::build(const float* vertices, const size_t stride, const unsigned int* indices, const size_t indexCount)
+{
+  this->nodes.clear();
+  this->packets.clear();
+  this->triangleCount = indexCount / 3;
+  if (this->triangleCount == 0) return;
+
+  std::vector<Reference> references(this->triangleCount);
+  for (size_t i = 0; i < this->triangleCount; i++)
+  {
+    Reference& reference = references[i];
+    for (int corner = 0; corner < 3; corner++)
+    {
+      const float* vertex = vertices + indices[i * 3 + corner] * stride;
+      reference.box.expand({vertex[0], vertex[1], vertex[2]});
+    }
+    reference.centroid = reference.box.getCenter();
+    reference.triangle = (unsigned int)i;
+  }
+
+  this->nodes.reserve(this->triangleCount / 2 + 1);
+  this->packets.reserve(this->triangleCount / 2 + 1);
+  this->nodes.emplace_back();
+  this->buildNode(0, references, 0, references.size(), vertices, stride, indices);
+}
+
+bool kdr::Raycast::TriangleBVH::intersect(const kdr::Bounds::Ray& ray, const float maxDistance, float& oDistance, unsigned int& oTriangle) const
+{
+  float closest {maxDistance};
+  float entry   {0.f};
+  bool  hit     {false};
+  if (this->nodes.empty() || !kdr::Bounds::intersectRay(ray, this->nodes[0].box, closest, entry)) return false;
+
+  kdr::Bounds::TraversalStack<std::pair<unsigned int, float>> stack;
+  stack.push({0, entry});
+  while (!stack.empty())
+  {
+    const auto [index, distance] = stack.pop();
+    if (distance > closest) continue;
+
+    const Node& node = this->nodes[index];
+    if (node.leaf)
+    {
+      hit |= intersectPacket(this->packets[node.first], ray, closest, oTriangle);
+      continue;
+    }
+
+    float distance1 {0.f};
+    float distance2 {0.f};
+    const bool hit1 = kdr::Bounds::intersectRay(ray, this->nodes[node.first].box, closest, distance1);
+    const bool hit2 = kdr::Bounds::intersectRay(ray, this->nodes[node.first + 1].box, closest, distance2);
+
+    if (hit1 && hit2)
+    {
+      const bool firstNearer = distance1 <= distance2;
+      stack.push(firstNearer ? std::make_pair(node.first + 1, distance2) : std::make_pair(node.first, distance1));
+      stack.push(firstNearer ? std::make_pair(node.first, distance1) : std::make_pair(node.first + 1, distance2));
+    }
+    else if (hit1)
+    {
+      stack.push({node.first, distance1});
+    }
+    else if (hit2)
+    {
+      stack.push({node.first + 1, distance2});
+    }
+  }
+
+  if (hit) oDistance = closest;
+  return hit;
+}
+
+void kdr::Raycast::TriangleBVH::buildNode(const unsigned int nodeIndex, std::vector<Reference>& references, const size_t begin, const size_t end, const float* vertices, const size_t stride, const unsigned int* indices)
+{
+  kdr::Bounds::AABB box;
+  kdr::Bounds::AABB centroidBounds;
+  for (size_t i = begin; i < end; i++)
+  {
+    box.expand(references[i].box);
+    centroidBounds.expand(references[i].centroid);
+  }
+
+  if (end - begin <= kdr::SIMD::WIDTH)
+  {
+    Packet packet {};
+    for (size_t i = begin; i < end; i++)
+    {
+      const size_t       lane     = i - begin;
+      const unsigned int triangle = references[i].triangle;
+      const float* p0 = vertices + indices[triangle * 3] * stride;
+      const float* p1 = vertices + indices[triangle * 3 + 1] * stride;
+      const float* p2 = vertices + indices[triangle * 3 + 2] * stride;
+      for (int axis = 0; axis < 3; axis++)
+      {
+        packet.v0[axis][lane] = p0[axis];
+        packet.edge1[axis][lane] = p1[axis] - p0[axis];
+        packet.edge2[axis][lane] = p2[axis] - p0[axis];
+      }
+      packet.triangles[lane] = triangle;
+    }
+
+    this->nodes[nodeIndex].box = box;
+    this->nodes[nodeIndex].first = (unsigned int)this->packets.size();
+    this->nodes[nodeIndex].leaf = true;
+    this->packets.push_back(packet);
+    return;
+  }
+
+  int   bestAxis  {-1};
+  int   bestSplit {0};
+  float bestCost  {FLT_MAX};
+  for (int axis = 0; axis < 3; axis++)
+  {
+    const float axisMin = getAxis(centroidBounds.min, axis);
+    const float axisExtent = getAxis(centroidBounds.max, axis) - axisMin;
+    if (axisExtent <= 0.f) continue;
+
+    kdr::Bounds::AABB binBounds[BIN_COUNT];
+    size_t            binCounts[BIN_COUNT] {};
+    for (size_t i = begin; i < end; i++)
+    {
+      const int bin = std::min(BIN_COUNT - 1, (int)((getAxis(references[i].centroid, axis) - axisMin) * BIN_COUNT / axisExtent));
+      binBounds[bin].expand(references[i].box);
+      binCounts[bin]++;
+    }
+
+    float             rightAreas[BIN_COUNT];
+    size_t            rightCounts[BIN_COUNT];
+    kdr::Bounds::AABB rightBounds;
+    size_t            rightCount {0};
+    for (int bin = BIN_COUNT - 1; bin > 0; bin--)
+    {
+      rightBounds.expand(binBounds[bin]);
+      rightCount += binCounts[bin];
+      rightAreas[bin] = rightBounds.getSurfaceArea();
+      rightCounts[bin] = rightCount;
+    }
+
+    kdr::Bounds::AABB leftBounds;
+    size_t            leftCount {0};
+    for (int bin = 0; bin < BIN_COUNT - 1; bin++)
+    {
+      leftBounds.expand(binBounds[bin]);
+      leftCount += binCounts[bin];
+      if (leftCount == 0 || rightCounts[bin + 1] == 0) continue;
+
+      const float cost = leftCount * leftBounds.getSurfaceArea() + rightCounts[bin + 1] * rightAreas[bin + 1];
+      if (cost < bestCost)
+      {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = bin;
+      }
+    }
+  }
+
+  size_t middle = (begin + end) / 2;
+  if (bestAxis >= 0)
+  {
+    const float axisMin = getAxis(centroidBounds.min, bestAxis);
+    const float axisExtent = getAxis(centroidBounds.max, bestAxis) - axisMin;
+    auto split = std::partition(references.begin() + begin, references.begin() + end, [&](const Reference& reference) {
+      return std::min(BIN_COUNT - 1, (int)((getAxis(reference.centroid, bestAxis) - axisMin) * BIN_COUNT / axisExtent)) <= bestSplit;
+    });
+    middle = split - references.begin();
+  }
+  if (middle == begin || middle == end)
+  {
+    middle = (begin + end) / 2;
+  }
+
+  const unsigned int left = (unsigned int)this->nodes.size();
+  this->nodes.emplace_back();
+  this->nodes.emplace_back();
+  this->nodes[nodeIndex].box = box;
+  this->nodes[nodeIndex].first = left;
+  this->nodes[nodeIndex].leaf = false;
+
+  this->buildNode(left, references, begin, middle, vertices, stride, indices);
+  this->buildNode(left + 1, references, middle, end, vertices, stride, indices);
+}
+
+bool kdr::Raycast::TriangleBVH::intersectPacket(const Packet& packet, const kdr::Bounds::Ray& ray, float& ioDistance, unsigned int& oTriangle)
+{
+  // Möller-Trumbore, evaluated for all lanes of the packet at once.
+#ifdef KDR_SIMD_SSE
+  const __m128 dirX = _mm_set1_ps(ray.direction.x);
+  const __m128 dirY = _mm_set1_ps(ray.direction.y);
+  const __m128 dirZ = _mm_set1_ps(ray.direction.z);
+  const __m128 edge1X = _mm_load_ps(packet.edge1[0]);
+  const __m128 edge1Y = _mm_load_ps(packet.edge1[1]);
+  const __m128 edge1Z = _mm_load_ps(packet.edge1[2]);
+  const __m128 edge2X = _mm_load_ps(packet.edge2[0]);
+  const __m128 edge2Y = _mm_load_ps(packet.edge2[1]);
+  const __m128 edge2Z = _mm_load_ps(packet.edge2[2]);
+
+  const __m128 pX = _mm_sub_ps(_mm_mul_ps(dirY, edge2Z), _mm_mul_ps(dirZ, edge2Y));
+  const __m128 pY = _mm_sub_ps(_mm_mul_ps(dirZ, edge2X), _mm_mul_ps(dirX, edge2Z));
+  const __m128 pZ = _mm_sub_ps(_mm_mul_ps(dirX, edge2Y), _mm_mul_ps(dirY, edge2X));
+  const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ));
+  const __m128 absDeterminant = _mm_and_ps(determinant, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+  const __m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.f), determinant);
+
+  const __m128 tX = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_load_ps(packet.v0[0]));
+  const __m128 tY = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_load_ps(packet.v0[1]));
+  const __m128 tZ = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_load_ps(packet.v0[2]));
+  const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tX, pX), _mm_mul_ps(tY, pY)), _mm_mul_ps(tZ, pZ)), inverseDeterminant);
+
+  const __m128 qX = _mm_sub_ps(_mm_mul_ps(tY, edge1Z), _mm_mul_ps(tZ, edge1Y));
+  const __m128 qY = _mm_sub_ps(_mm_mul_ps(tZ, edge1X), _mm_mul_ps(tX, edge1Z));
+  const __m128 qZ = _mm_sub_ps(_mm_mul_ps(tX, edge1Y), _mm_mul_ps(tY, edge1X));
+  const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dirX, qX), _mm_mul_ps(dirY, qY)), _mm_mul_ps(dirZ, qZ)), inverseDeterminant);
+  const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), inverseDeterminant);
+
+  const __m128 zero = _mm_setzero_ps();
+  __m128 mask = _mm_cmpgt_ps(absDeterminant, _mm_set1_ps(HIT_EPSILON));
+  mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+  mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+  mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.f)));
+  mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, _mm_set1_ps(DISTANCE_EPSILON)));
+  mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(ioDistance)));
+
+  const int hitMask = _mm_movemask_ps(mask);
+  if (hitMask == 0) return false;
+
+  alignas(16) float distances[kdr::SIMD::WIDTH];
+  _mm_store_ps(distances, t);
+  for (unsigned int lane = 0; lane < kdr::SIMD::WIDTH; lane++)
+  {
+    if ((hitMask & (1 << lane)) == 0 || distances[lane] >= ioDistance) continue;
+    ioDistance = distances[lane];
+    oTriangle = packet.triangles[lane];
+  }
+  return true;
+#else
+  bool hit {false};
+  for (unsigned int lane = 0; lane < kdr::SIMD::WIDTH; lane++)
+  {
+    const kdr::Space::Vec3 edge1 {packet.edge1[0][lane], packet.edge1[1][lane], packet.edge1[2][lane]};
+    const kdr::Space::Vec3 edge2 {packet.edge2[0][lane], packet.edge2[1][lane], packet.edge2[2][lane]};
+    const kdr::Space::Vec3 p = kdr::Space::cross(ray.direction, edge2);
+    const float determinant = kdr::Space::dot(edge1, p);
+    if (fabsf(determinant) <= HIT_EPSILON) continue;
+
+    const float inverseDeterminant = 1.f / determinant;
+    const kdr::Space::Vec3 toOrigin = ray.origin - kdr::Space::Vec3 {packet.v0[0][lane], packet.v0[1][lane], packet.v0[2][lane]};
+    const float u = kdr::Space::dot(toOrigin, p) * inverseDeterminant;
+    if (u < 0.f || u > 1.f) continue;
+
+    const kdr::Space::Vec3 q = kdr::Space::cross(toOrigin, edge1);
+    const float v = kdr::Space::dot(ray.direction, q) * inverseDeterminant;
+    if (v < 0.f || u + v > 1.f) continue;
+
+    const float t = kdr::Space::dot(edge2, q) * inverseDeterminant;
+    if (t <= DISTANCE_EPSILON || t >= ioDistance) continue;
+
+    ioDistance = t;
+    oTriangle = packet.triangles[lane];
+    hit = true;
+  }
+  return hit;
+#endif
+}
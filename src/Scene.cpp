@@ -0,0 +1,362 @@
+#include "Kedarium/Scene.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Kedarium/Jobs.hpp"
+
+namespace
+{
+  /**
+   * @brief The number of boxes culled per job.
+   */
+  constexpr size_t PARALLEL_GRAIN {8192};
+
+  /**
+   * @brief Collects the entities with a mesh whose world bounds intersect a frustum.
+   *
+   * @param worldBounds The world bounds to cull, tested in place.
+   * @param meshes The meshes of the entities.
+   * @param frustum The frustum to test against, or NULL to collect every entity with a mesh.
+   * @param ioVisibility Scratch buffer receiving the result of each box.
+   * @param oVisible Output vector receiving the visible entities, cleared first.
+   */
+  void cullEntities(const kdr::ComponentPool<kdr::Components::WorldBounds>& worldBounds, const kdr::ComponentPool<kdr::Components::Mesh>& meshes, const kdr::Bounds::Frustum* frustum, std::vector<unsigned char>& ioVisibility, std::vector<kdr::Entity>& oVisible)
+  {
+    oVisible.clear();
+    if (frustum == NULL)
+    {
+      oVisible = meshes.getEntities();
+      return;
+    }
+
+    // The world boxes are dense on their own, so each chunk is culled in place.
+    const std::vector<kdr::Entity>& entities = worldBounds.getEntities();
+    const std::vector<kdr::Components::WorldBounds>& boxes = worldBounds.getComponents();
+    ioVisibility.resize(boxes.size());
+    kdr::Core::getJobSystem().parallelFor(boxes.size(), PARALLEL_GRAIN, [&](const size_t begin, const size_t end)
+    {
+      kdr::Bounds::cullAABBs(*frustum, boxes.data() + begin, end - begin, ioVisibility.data() + begin);
+    });
+
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+      if (ioVisibility[i] && meshes.has(entities[i]))
+      {
+        oVisible.push_back(entities[i]);
+      }
+    }
+  }
+
+  /**
+   * @brief Multiplies two row-major 3x3 matrices.
+   *
+   * @param a The left matrix.
+   * @param b The right matrix.
+   * @param oResult Output matrix receiving a times b.
+   */
+  void multiply3(const float a[3][3], const float b[3][3], float oResult[3][3])
+  {
+    for (int row = 0; row < 3; row++)
+    {
+      for (int column = 0; column < 3; column++)
+      {
+        oResult[row][column] = a[row][0] * b[0][column] + a[row][1] * b[1][column] + a[row][2] * b[2][column];
+      }
+    }
+  }
+
+  /**
+   * @brief Builds the world matrix of a transform.
+   *
+   * @param transform The transform.
+   * @return Translation times rotation around Y, X and Z times scale.
+   */
+  kdr::Space::Mat4 composeTransform(const kdr::Components::Transform& transform)
+  {
+    const float x = kdr::Space::radians(transform.rotation.x);
+    const float y = kdr::Space::radians(transform.rotation.y);
+    const float z = kdr::Space::radians(transform.rotation.z);
+    const float rotationX[3][3] = {{1.f, 0.f, 0.f}, {0.f, cosf(x), -sinf(x)}, {0.f, sinf(x), cosf(x)}};
+    const float rotationY[3][3] = {{cosf(y), 0.f, sinf(y)}, {0.f, 1.f, 0.f}, {-sinf(y), 0.f, cosf(y)}};
+    const float rotationZ[3][3] = {{cosf(z), -sinf(z), 0.f}, {sinf(z), cosf(z), 0.f}, {0.f, 0.f, 1.f}};
+    float rotationYX[3][3];
+    float rotation[3][3];
+    multiply3(rotationY, rotationX, rotationYX);
+    multiply3(rotationYX, rotationZ, rotation);
+
+    const float scale[3] = {transform.scale.x, transform.scale.y, transform.scale.z};
+    const float position[3] = {transform.position.x, transform.position.y, transform.position.z};
+    kdr::Space::Mat4 world {1.f};
+    for (int column = 0; column < 3; column++)
+    {
+      for (int row = 0; row < 3; row++)
+      {
+        world[column][row] = rotation[row][column] * scale[column];
+      }
+      world[3][column] = position[column];
+    }
+    return world;
+  }
+
+  /**
+   * @brief Splits a matrix built like composeTransform() back into a transform.
+   *
+   * Shear, which a product of transforms has when a rotated child sits under a non-uniformly
+   * scaled parent, cannot be represented and is dropped.
+   *
+   * @param mat The matrix.
+   * @param ioTransform The transform whose position, rotation and scale are replaced.
+   */
+  void decomposeTransform(const kdr::Space::Mat4& mat, kdr::Components::Transform& ioTransform)
+  {
+    float scale[3];
+    float rotation[3][3];
+    for (int column = 0; column < 3; column++)
+    {
+      scale[column] = sqrtf(mat[column][0] * mat[column][0] + mat[column][1] * mat[column][1] + mat[column][2] * mat[column][2]);
+      for (int row = 0; row < 3; row++)
+      {
+        rotation[row][column] = scale[column] > 0.f ? mat[column][row] / scale[column] : (float)(row == column);
+      }
+    }
+
+    // Rotation around Y, X and Z has -sin(x) in row 1, column 2.
+    const float degrees = 180.f / kdr::Space::PI;
+    const float x = asinf(std::clamp(-rotation[1][2], -1.f, 1.f));
+    float y;
+    float z;
+    if (fabsf(rotation[1][2]) < 0.9999f)
+    {
+      y = atan2f(rotation[0][2], rotation[2][2]);
+      z = atan2f(rotation[1][0], rotation[1][1]);
+    }
+    else
+    {
+      // At x = +-90 degrees only y -+ z is defined, so z is taken as zero.
+      y = atan2f(-rotation[2][0], rotation[0][0]);
+      z = 0.f;
+    }
+
+    ioTransform.position = {mat[3][0], mat[3][1], mat[3][2]};
+    ioTransform.rotation = {x * degrees, y * degrees, z * degrees};
+    ioTransform.scale = {scale[0], scale[1], scale[2]};
+  }
+}
+
+kdr::Entity kdr::Scene::create()
+{
+  uint32_t slot;
+  if (this->freeSlots.empty())
+  {
+    slot = this->slots.size();
+    this->slots.push_back(0);
+  }
+  else
+  {
+    slot = this->freeSlots.back();
+    this->freeSlots.pop_back();
+  }
+  return (this->slots[slot] << kdr::ENTITY_SLOT_BITS) | slot;
+}
+
+kdr::Entity kdr::Scene::createMesh(const kdr::Solids::Solid& prototype, const kdr::Space::Vec3& position, const kdr::Graphics::Texture* texture)
+{
+  const kdr::Entity entity = this->create();
+
+  kdr::Components::Transform transform;
+  transform.position = position;
+  this->transforms.add(entity, transform);
+
+  kdr::Components::Bounds bounds;
+  bounds.local = prototype.getLocalBounds();
+  this->bounds.add(entity, bounds);
+
+  kdr::Components::Mesh mesh;
+  mesh.mesh = prototype.getMesh();
+  mesh.firstIndex = prototype.getLods()[0].firstIndex;
+  mesh.indexCount = prototype.getLods()[0].indexCount;
+  mesh.positionOffset = prototype.getPositionOffset();
+  mesh.positionScale = prototype.getPositionScale();
+  this->meshes.add(entity, mesh);
+
+  this->materials.add(entity, {texture});
+  return entity;
+}
+
+void kdr::Scene::destroy(const kdr::Entity entity)
+{
+  if (!this->isAlive(entity))
+  {
+    return;
+  }
+
+  // The hierarchy moves the children to the parent of the entity, so their transforms take
+  // over its own to stay in place instead of jumping on their next update.
+  const kdr::Components::Transform* transform = this->transforms.get(entity);
+  if (transform != NULL && this->hierarchy.find(entity) != kdr::Hierarchy::INVALID_NODE)
+  {
+    const kdr::Space::Mat4 local = composeTransform(*transform);
+    for (uint32_t node = 0; node < this->hierarchy.getCount(); node++)
+    {
+      const kdr::Entity child = this->hierarchy.getEntity(node);
+      kdr::Components::Transform* childTransform = this->transforms.get(child);
+      if (childTransform != NULL && this->hierarchy.getParent(child) == entity)
+      {
+        decomposeTransform(local * composeTransform(*childTransform), *childTransform);
+        childTransform->dirty = true;
+      }
+    }
+  }
+  this->transforms.remove(entity);
+  this->bounds.remove(entity);
+  this->worldBounds.remove(entity);
+  this->meshes.remove(entity);
+  this->materials.remove(entity);
+  this->lights.remove(entity);
+  this->hierarchy.remove(entity);
+
+  // The generation wraps around within the bits left by the slot.
+  const uint32_t slot = entity & kdr::ENTITY_SLOT_MASK;
+  this->slots[slot] = (this->slots[slot] + 1) & (UINT32_MAX >> kdr::ENTITY_SLOT_BITS);
+  this->freeSlots.push_back(slot);
+}
+
+bool kdr::Scene::isAlive(const kdr::Entity entity) const
+{
+  const uint32_t slot = entity & kdr::ENTITY_SLOT_MASK;
+  return entity != kdr::NULL_ENTITY && slot < this->slots.size() && this->slots[slot] == entity >> kdr::ENTITY_SLOT_BITS;
+}
+
+bool kdr::Scene::setParent(const kdr::Entity child, const kdr::Entity parent)
+{
+  kdr::Components::Transform* transform = this->transforms.get(child);
+  if (transform == NULL || (parent != kdr::NULL_ENTITY && !this->isAlive(parent)))
+  {
+    return false;
+  }
+  if (!this->hierarchy.attach(child, parent))
+  {
+    return false;
+  }
+  // The hierarchy needs the local matrices of nodes it may have just added.
+  transform->dirty = true;
+  kdr::Components::Transform* parentTransform = this->transforms.get(parent);
+  if (parentTransform != NULL)
+  {
+    parentTransform->dirty = true;
+  }
+  return true;
+}
+
+void kdr::Scene::updateTransforms()
+{
+  const std::vector<kdr::Entity>& entities = this->transforms.getEntities();
+  std::vector<kdr::Components::Transform>& components = this->transforms.getComponents();
+  for (size_t i = 0; i < components.size(); i++)
+  {
+    kdr::Components::Transform& transform = components[i];
+    if (!transform.dirty)
+    {
+      continue;
+    }
+    transform.dirty = false;
+    if (this->hierarchy.find(entities[i]) != kdr::Hierarchy::INVALID_NODE)
+    {
+      this->hierarchy.setLocal(entities[i], composeTransform(transform));
+      continue;
+    }
+    transform.world = composeTransform(transform);
+
+    const kdr::Components::Bounds* bounds = this->bounds.get(entities[i]);
+    if (bounds != NULL)
+    {
+      this->worldBounds.add(entities[i], kdr::Bounds::transform(bounds->local, transform.world));
+    }
+  }
+
+  if (this->hierarchy.update() == 0)
+  {
+    return;
+  }
+  for (uint32_t node = 0; node < this->hierarchy.getCount(); node++)
+  {
+    if (!this->hierarchy.wasUpdated(node))
+    {
+      continue;
+    }
+    const kdr::Entity entity = this->hierarchy.getEntity(node);
+    kdr::Components::Transform* transform = this->transforms.get(entity);
+    if (transform == NULL)
+    {
+      continue;
+    }
+    transform->world = this->hierarchy.getWorld(node);
+
+    const kdr::Components::Bounds* bounds = this->bounds.get(entity);
+    if (bounds != NULL)
+    {
+      this->worldBounds.add(entity, kdr::Bounds::transform(bounds->local, transform->world));
+    }
+  }
+}
+
+void kdr::Scene::cull(const kdr::Bounds::Frustum* frustum, std::vector<kdr::Entity>& oVisible) const
+{
+  cullEntities(this->worldBounds, this->meshes, frustum, this->cullVisibility, oVisible);
+}
+
+void kdr::Scene::sortDraws(std::vector<kdr::Entity>& ioEntities) const
+{
+  std::sort(ioEntities.begin(), ioEntities.end(), [this](const kdr::Entity a, const kdr::Entity b)
+  {
+    const kdr::Components::Material* materialA = this->materials.get(a);
+    const kdr::Components::Material* materialB = this->materials.get(b);
+    const kdr::Graphics::Texture* textureA = materialA != NULL ? materialA->texture : NULL;
+    const kdr::Graphics::Texture* textureB = materialB != NULL ? materialB->texture : NULL;
+    if (textureA != textureB)
+    {
+      return std::less<const kdr::Graphics::Texture*>()(textureA, textureB);
+    }
+    return this->meshes.get(a)->mesh < this->meshes.get(b)->mesh;
+  });
+}
+
+void kdr::SceneSnapshot::capture(const kdr::Scene& scene)
+{
+  this->scene = &scene;
+  this->worlds.clear();
+  this->worldBounds.clear();
+  for (const kdr::Entity entity : scene.getMeshes().getEntities())
+  {
+    const kdr::Components::Transform* transform = scene.getTransforms().get(entity);
+    if (transform != NULL)
+    {
+      this->worlds.add(entity, transform->world);
+    }
+    const kdr::Components::WorldBounds* bounds = scene.getWorldBounds().get(entity);
+    if (bounds != NULL)
+    {
+      this->worldBounds.add(entity, *bounds);
+    }
+  }
+  this->lights = scene.getLights();
+}
+
+void kdr::SceneSnapshot::clear()
+{
+  this->scene = NULL;
+  this->worlds.clear();
+  this->worldBounds.clear();
+  this->lights.clear();
+}
+
+void kdr::SceneSnapshot::cull(const kdr::Bounds::Frustum* frustum, std::vector<kdr::Entity>& oVisible) const
+{
+  if (this->scene == NULL)
+  {
+    oVisible.clear();
+    return;
+  }
+  cullEntities(this->worldBounds, this->scene->getMeshes(), frustum, this->cullVisibility, oVisible);
+}
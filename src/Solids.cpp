@@ -1,25 +1,175 @@
 #include "Kedarium/Solids.hpp"
 
+#include <atomic>
+#include <cstdint>
+
 constexpr float CUBE_NORMAL_FACTOR = 0.57735f;
+constexpr GLuint MIN_CLUSTERED_TRIANGLES = 4 * kdr::Meshlet::MAX_TRIANGLES;
+constexpr GLuint MAX_OCCLUDER_TRIANGLES = 4096;
+
+uint64_t kdr::Solids::Solid::_nextSerial()
+{
+  static std::atomic<uint64_t> nextSerial {1};
+  return nextSerial.fetch_add(1, std::memory_order_relaxed);
+}
+
+void kdr::Solids::Solid::updateWorldBounds()
+{
+  const kdr::Space::Mat4 modelMatrix = this->getModelMatrix();
+  this->worldBounds = kdr::Bounds::transform(this->localBounds, modelMatrix);
+  this->worldSphere = kdr::Bounds::transform(this->localSphere, modelMatrix);
+}
+
+bool kdr::Solids::Solid::intersectRay(const kdr::Bounds::Ray& ray, const float maxDistance, kdr::Raycast::Hit& oHit) const
+{
+  float entry {0.f};
+  if (!kdr::Bounds::intersectRay(ray, this->worldBounds, maxDistance, entry))
+  {
+    return false;
+  }
+
+  // The ray is moved into model space; distances are rescaled in case the model matrix scales.
+  const kdr::Space::Mat4 inverseModel = kdr::Space::inverse(this->getModelMatrix());
+  const kdr::Space::Vec3& origin = ray.origin;
+  const kdr::Space::Vec3& direction = ray.direction;
+  const kdr::Space::Vec3 localOrigin {
+    inverseModel[0][0] * origin.x + inverseModel[1][0] * origin.y + inverseModel[2][0] * origin.z + inverseModel[3][0],
+    inverseModel[0][1] * origin.x + inverseModel[1][1] * origin.y + inverseModel[2][1] * origin.z + inverseModel[3][1],
+    inverseModel[0][2] * origin.x + inverseModel[1][2] * origin.y + inverseModel[2][2] * origin.z + inverseModel[3][2]
+  };
+  const kdr::Space::Vec3 localDirection {
+    inverseModel[0][0] * direction.x + inverseModel[1][0] * direction.y + inverseModel[2][0] * direction.z,
+    inverseModel[0][1] * direction.x + inverseModel[1][1] * direction.y + inverseModel[2][1] * direction.z,
+    inverseModel[0][2] * direction.x + inverseModel[1][2] * direction.y + inverseModel[2][2] * direction.z
+  };
+  const float scale = sqrtf(kdr::Space::dot(localDirection, localDirection));
+  if (scale == 0.f)
+  {
+    return false;
+  }
 
-void kdr::Solids::Solid::initializeMembers(GLfloat* vertices, GLsizeiptr verticesSize, GLuint* indices, GLsizeiptr indicesSize)
+  float        distance {0.f};
+  unsigned int triangle {0};
+  if (!this->triangles.intersect({localOrigin, localDirection}, maxDistance * scale, distance, triangle))
+  {
+    return false;
+  }
+
+  oHit.solid = this;
+  oHit.triangle = triangle;
+  oHit.distance = distance / scale;
+  return true;
+}
+
+// Scene casts live with the solids rather than the triangle hierarchy, which has no GL dependency.
+bool kdr::Raycast::castRay(const kdr::BVH& scene, const kdr::Bounds::Ray& ray, const float maxDistance, kdr::Raycast::Hit& oHit)
 {
-  this->VAO = new kdr::Graphics::VAO();
-  this->VBO = new kdr::Graphics::VBO(vertices, verticesSize);
-  this->EBO = new kdr::Graphics::EBO(indices, indicesSize);
+  kdr::Raycast::Hit closest;
+  scene.queryRay(ray, maxDistance, [&closest](void* userData, const kdr::Bounds::Ray& sceneRay, float distance) {
+    const kdr::Solids::Solid* solid = (const kdr::Solids::Solid*)userData;
+    kdr::Raycast::Hit hit;
+    if (!solid->intersectRay(sceneRay, distance, hit)) return distance;
+    closest = hit;
+    return hit.distance;
+  });
+
+  if (closest.solid == NULL) return false;
+  oHit = closest;
+  return true;
+}
+
+bool kdr::Raycast::castRay(const std::vector<const kdr::Solids::Solid*>& solids, const kdr::Bounds::Ray& ray, const float maxDistance, kdr::Raycast::Hit& oHit)
+{
+  kdr::Raycast::Hit closest;
+  float distance {maxDistance};
+  for (const kdr::Solids::Solid* solid : solids)
+  {
+    kdr::Raycast::Hit hit;
+    if (!solid->intersectRay(ray, distance, hit)) continue;
+    closest = hit;
+    distance = hit.distance;
+  }
+
+  if (closest.solid == NULL) return false;
+  oHit = closest;
+  return true;
+}
+
+GLuint kdr::Solids::Solid::selectLod(const kdr::Space::Vec3& viewPosition, const float pixelsPerUnit, const float maxPixelError) const
+{
+  this->selectedLod = 0;
+  if (this->lods.size() < 2 || pixelsPerUnit <= 0.f || maxPixelError <= 0.f)
+  {
+    return this->selectedLod;
+  }
+
+  const kdr::Space::Vec3 offset = this->worldSphere.center - viewPosition;
+  const float distance = sqrtf(kdr::Space::dot(offset, offset)) - this->worldSphere.radius;
+  if (distance <= 0.f)
+  {
+    return this->selectedLod;
+  }
+
+  const float maxError = maxPixelError * distance / pixelsPerUnit;
+  for (GLuint i = this->lods.size() - 1; i > 0; i--)
+  {
+    if (this->lods[i].error <= maxError)
+    {
+      this->selectedLod = i;
+      break;
+    }
+  }
+  return this->selectedLod;
+}
+
+void kdr::Solids::Solid::initializeMembers(GLfloat* vertices, GLsizeiptr verticesSize, GLuint* indices, GLsizeiptr indicesSize, const std::vector<kdr::Object::Lod>& lods)
+{
+  const GLuint indexCount = indicesSize / sizeof(GLuint);
+  this->lods = lods.empty() ? std::vector<kdr::Object::Lod> {{0, indexCount, 0.f}} : lods;
+  this->selectedLod = 0;
+
+  const size_t vertexCount = verticesSize / (11 * sizeof(GLfloat));
+  this->localBounds = kdr::Bounds::fromVertices(vertices, vertexCount, 11);
+  this->localSphere = kdr::Bounds::sphereFromVertices(vertices, vertexCount, 11, this->localBounds);
+  this->updateWorldBounds();
+
+  // Small meshes would spend more on culling their clusters than on drawing them. Clustering
+  // reorders the full detail triangles, so it happens before they are uploaded.
+  this->clusters.clear();
+  if (this->lods[0].indexCount >= MIN_CLUSTERED_TRIANGLES * 3)
+  {
+    this->clusters.build(vertices, 11, indices + this->lods[0].firstIndex, this->lods[0].indexCount);
+  }
+  this->triangles.build(vertices, 11, indices + this->lods[0].firstIndex, this->lods[0].indexCount);
 
-  this->VAO->Bind();
-  this->VBO->Bind();
-  this->EBO->Bind();
+  // Occluders are rasterized on the CPU every frame, so only light meshes keep a copy of
+  // their full detail positions, without the vertices they do not use.
+  this->occluderPositions.clear();
+  this->occluderIndices.clear();
+  if (this->lods[0].indexCount <= MAX_OCCLUDER_TRIANGLES * 3)
+  {
+    std::vector<GLuint> remap(vertexCount, UINT32_MAX);
+    for (GLuint i = 0; i < this->lods[0].indexCount; i++)
+    {
+      const GLuint vertex = indices[this->lods[0].firstIndex + i];
+      if (remap[vertex] == UINT32_MAX)
+      {
+        remap[vertex] = this->occluderPositions.size() / 3;
+        this->occluderPositions.insert(this->occluderPositions.end(), vertices + vertex * 11, vertices + vertex * 11 + 3);
+      }
+      this->occluderIndices.push_back(remap[vertex]);
+    }
+  }
 
-  this->VAO->LinkAttrib(*VBO, 0, 3, GL_FLOAT, 11 * sizeof(GLfloat), (void*)0);
-  this->VAO->LinkAttrib(*VBO, 1, 3, GL_FLOAT, 11 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-  this->VAO->LinkAttrib(*VBO, 2, 2, GL_FLOAT, 11 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
-  this->VAO->LinkAttrib(*VBO, 3, 3, GL_FLOAT, 11 * sizeof(GLfloat), (void*)(8 * sizeof(GLfloat)));
+  const kdr::Vertex::Format& format = kdr::Vertex::getSolidFormat();
+  std::vector<GLubyte> encoded;
+  kdr::Vertex::encode(format, vertices, vertexCount, this->localBounds, encoded);
+  this->positionOffset = format.quantizedPositions ? this->localBounds.min : kdr::Space::Vec3 {0.f};
+  this->positionScale = format.quantizedPositions ? this->localBounds.max - this->localBounds.min : kdr::Space::Vec3 {1.f};
 
-  this->VAO->Unbind();
-  this->VBO->Unbind();
-  this->EBO->Unbind();
+  kdr::MeshArena& arena = kdr::MeshArena::getSolidArena();
+  arena.remove(this->mesh);
+  this->mesh = arena.add(encoded.data(), vertexCount, indices, indicesSize / sizeof(GLuint));
 }
 
 GLuint cuboidIndices[] = {
@@ -70,9 +220,7 @@ kdr::Solids::Cube::Cube(const kdr::Space::Vec3& position, const float edgeLength
 
 void kdr::Solids::Cube::render() const
 {
-  this->VAO->Bind();
-  glDrawElements(GL_TRIANGLES, sizeof(cuboidIndices) / sizeof(GLuint), GL_UNSIGNED_INT, NULL);
-  this->VAO->Unbind();
+  this->drawMesh();
 }
 
 kdr::Solids::Cuboid::Cuboid(const kdr::Space::Vec3& position, const float length, const float height, const float width) : kdr::Solids::Solid(position)
@@ -108,9 +256,7 @@ kdr::Solids::Cuboid::Cuboid(const kdr::Space::Vec3& position, const float length
 
 void kdr::Solids::Cuboid::render() const
 {
-  this->VAO->Bind();
-  glDrawElements(GL_TRIANGLES, sizeof(cuboidIndices) / sizeof(GLuint), GL_UNSIGNED_INT, NULL);
-  this->VAO->Unbind();
+  this->drawMesh();
 }
 
 GLuint planeIndices[] = {
@@ -137,9 +283,7 @@ kdr::Solids::Plane::Plane(const kdr::Space::Vec3& position, const float length,
 
 void kdr::Solids::Plane::render() const
 {
-  this->VAO->Bind();
-  glDrawElements(GL_TRIANGLES, sizeof(planeIndices) / sizeof(GLuint), GL_UNSIGNED_INT, NULL);
-  this->VAO->Unbind();
+  this->drawMesh();
 }
 
 GLuint pyramidIndices[] = {
@@ -191,26 +335,20 @@ kdr::Solids::Pyramid::Pyramid(const kdr::Space::Vec3& position, const float edge
 
 void kdr::Solids::Pyramid::render() const
 {
-  this->VAO->Bind();
-  glDrawElements(GL_TRIANGLES, sizeof(pyramidIndices) / sizeof(GLuint), GL_UNSIGNED_INT, NULL);
-  this->VAO->Unbind();
+  this->drawMesh();
 }
 
 kdr::Solids::Mesh::Mesh(const kdr::Space::Vec3& position, const std::string objPath, const kdr::Space::Vec3& dimensions) : kdr::Solids::Solid(position)
 {
-  std::vector<GLfloat> vertices;
-  std::vector<GLuint>  indices;
-  GLsizeiptr verticesSize {0};
-  GLsizeiptr indicesSize  {0};
+  std::vector<GLfloat>          vertices;
+  std::vector<GLuint>           indices;
+  std::vector<kdr::Object::Lod> lods;
 
-  kdr::Object::loadFromObj(objPath, vertices, verticesSize, indices, indicesSize, dimensions);
-  this->initializeMembers(&vertices[0], verticesSize, &indices[0], indicesSize);
-  this->indexCount = indices.size();
+  kdr::Object::loadMesh(objPath, vertices, indices, lods, dimensions);
+  this->initializeMembers(vertices.data(), vertices.size() * sizeof(GLfloat), indices.data(), indices.size() * sizeof(GLuint), lods);
 }
 
 void kdr::Solids::Mesh::render() const
 {
-  this->VAO->Bind();
-  glDrawElements(GL_TRIANGLES, this->indexCount * sizeof(GLuint), GL_UNSIGNED_INT, NULL);
-  this->VAO->Unbind();
+  this->drawMesh();
 }
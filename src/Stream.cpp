@@ -0,0 +1,170 @@
+#include "Kedarium/Stream.hpp"
+
+#include <algorithm>
+
+bool kdr::StreamBuffer::isPersistentSupported()
+{
+  return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+void kdr::StreamBuffer::beginFrame()
+{
+  if (this->required > this->frameSize)
+  {
+    while (this->frameSize < this->required)
+    {
+      this->frameSize *= 2;
+    }
+    this->Delete();
+  }
+  if (this->ID == 0)
+  {
+    this->_create();
+  }
+
+  this->frame = (this->frame + 1) % this->frameCount;
+  this->head = 0;
+  this->flushed = 0;
+  this->required = 0;
+
+  if (!this->persistent)
+  {
+    // Respecifying the store detaches it from the draws still in flight.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->ID);
+    glBufferData(GL_COPY_WRITE_BUFFER, this->frameSize, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return;
+  }
+
+  GLsync& fence = this->fences[this->frame];
+  if (fence == NULL)
+  {
+    return;
+  }
+  if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+  {
+    this->waitCount++;
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+    {}
+  }
+  glDeleteSync(fence);
+  fence = NULL;
+}
+
+bool kdr::StreamBuffer::allocate(const GLsizeiptr size, const GLsizeiptr alignment, Allocation& oAllocation)
+{
+  if (this->ID == 0)
+  {
+    std::cerr << "Stream buffer allocations need a frame started by beginFrame()!\n";
+    return false;
+  }
+
+  const GLsizeiptr align = alignment > 0 ? alignment : 1;
+  const GLsizeiptr start = (this->head + align - 1) / align * align;
+  if (start + size > this->frameSize)
+  {
+    if (this->required <= this->frameSize)
+    {
+      std::cerr << "Stream buffer frame of " << this->frameSize << " bytes is full, growing it for the next frame.\n";
+    }
+    this->required = std::max(this->required, start + size);
+    return false;
+  }
+
+  this->head = start + size;
+  this->required = std::max(this->required, this->head);
+
+  oAllocation.offset = this->_regionOffset() + start;
+  oAllocation.size = size;
+  oAllocation.data = this->persistent ? this->mapped + oAllocation.offset : this->staging.data() + start;
+  return true;
+}
+
+void kdr::StreamBuffer::flush()
+{
+  if (this->persistent || this->head == this->flushed)
+  {
+    return;
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, this->ID);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, this->flushed, this->head - this->flushed, this->staging.data() + this->flushed);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  this->flushed = this->head;
+}
+
+void kdr::StreamBuffer::endFrame()
+{
+  if (this->ID == 0)
+  {
+    return;
+  }
+  this->flush();
+  if (this->persistent)
+  {
+    this->fences[this->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+}
+
+void kdr::StreamBuffer::Delete()
+{
+  for (GLsync& fence : this->fences)
+  {
+    if (fence == NULL) continue;
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(fence);
+  }
+  this->fences.clear();
+
+  if (this->ID != 0)
+  {
+    if (this->mapped != NULL)
+    {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, this->ID);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &this->ID);
+  }
+  this->ID = 0;
+  this->mapped = NULL;
+  this->persistent = false;
+  this->staging.clear();
+  this->head = 0;
+  this->flushed = 0;
+}
+
+void kdr::StreamBuffer::_create()
+{
+  // Regions start at multiples of 256 bytes, the largest binding offset alignment in practice,
+  // so offsets aligned within a region are aligned within the buffer as well.
+  this->frameSize = (this->frameSize + 255) / 256 * 256;
+
+  glGenBuffers(1, &this->ID);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, this->ID);
+
+  if (isPersistentSupported())
+  {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr size = this->frameSize * this->frameCount;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+    this->mapped = (GLubyte*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+    if (this->mapped != NULL)
+    {
+      this->persistent = true;
+      this->fences.assign(this->frameCount, NULL);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      return;
+    }
+
+    // Storage is immutable, so a failed mapping needs a new buffer for the fallback.
+    std::cerr << "Failed to map the stream buffer, falling back to orphaning!\n";
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &this->ID);
+    glGenBuffers(1, &this->ID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->ID);
+  }
+
+  glBufferData(GL_COPY_WRITE_BUFFER, this->frameSize, NULL, GL_STREAM_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  this->staging.resize(this->frameSize);
+}
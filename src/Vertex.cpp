@@ -0,0 +1,266 @@
+#include "Kedarium/Vertex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+  kdr::Vertex::Format solidFormat;
+
+  /**
+   * @brief Appends the bytes of a value to a vertex.
+   *
+   * @param value The value to append.
+   * @param ioCursor The write position, advanced past the value.
+   */
+  template <typename T>
+  void write(const T& value, GLubyte*& ioCursor)
+  {
+    memcpy(ioCursor, &value, sizeof(T));
+    ioCursor += sizeof(T);
+  }
+
+  /**
+   * @brief Converts a value in [-1, 1] to a signed normalized integer.
+   *
+   * @param value The value to convert.
+   * @param maximum The largest integer, such as 511 for 10 bits.
+   * @return The rounded integer.
+   */
+  int toSnorm(const float value, const int maximum)
+  {
+    return (int)roundf(std::max(-1.f, std::min(1.f, value)) * maximum);
+  }
+}
+
+GLuint kdr::Vertex::getStride(const kdr::Vertex::Format& format)
+{
+  GLuint stride {0};
+  stride += format.quantizedPositions ? 4 * sizeof(uint16_t) : 3 * sizeof(GLfloat);
+  stride += format.color ? 3 * sizeof(GLfloat) : 0;
+  stride += format.halfTexCoords ? 2 * sizeof(uint16_t) : 2 * sizeof(GLfloat);
+  stride += format.normals == kdr::Vertex::NormalEncoding::Float ? 3 * sizeof(GLfloat) : 4;
+  return stride;
+}
+
+std::vector<kdr::MeshArena::Attribute> kdr::Vertex::getAttributes(const kdr::Vertex::Format& format)
+{
+  std::vector<kdr::MeshArena::Attribute> attributes;
+  GLuint offset {0};
+
+  // Quantized positions carry a padding component to keep the next attribute 4-byte aligned.
+  if (format.quantizedPositions)
+  {
+    attributes.push_back({0, 4, GL_UNSIGNED_SHORT, GL_TRUE, offset});
+    offset += 4 * sizeof(uint16_t);
+  }
+  else
+  {
+    attributes.push_back({0, 3, GL_FLOAT, GL_FALSE, offset});
+    offset += 3 * sizeof(GLfloat);
+  }
+  if (format.color)
+  {
+    attributes.push_back({1, 3, GL_FLOAT, GL_FALSE, offset});
+    offset += 3 * sizeof(GLfloat);
+  }
+  if (format.halfTexCoords)
+  {
+    attributes.push_back({2, 2, GL_HALF_FLOAT, GL_FALSE, offset});
+    offset += 2 * sizeof(uint16_t);
+  }
+  else
+  {
+    attributes.push_back({2, 2, GL_FLOAT, GL_FALSE, offset});
+    offset += 2 * sizeof(GLfloat);
+  }
+  switch (format.normals)
+  {
+    case kdr::Vertex::NormalEncoding::Float:
+      attributes.push_back({3, 3, GL_FLOAT, GL_FALSE, offset});
+      break;
+    case kdr::Vertex::NormalEncoding::Octahedral:
+      attributes.push_back({3, 2, GL_SHORT, GL_TRUE, offset});
+      break;
+    case kdr::Vertex::NormalEncoding::Packed:
+      attributes.push_back({3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offset});
+      break;
+  }
+  return attributes;
+}
+
+std::vector<std::string> kdr::Vertex::getDefines(const kdr::Vertex::Format& format)
+{
+  std::vector<std::string> defines;
+  if (format.quantizedPositions)
+  {
+    defines.push_back("QUANTIZED_POSITIONS");
+  }
+  if (!format.color)
+  {
+    defines.push_back("NO_VERTEX_COLOR");
+  }
+  if (format.normals == kdr::Vertex::NormalEncoding::Octahedral)
+  {
+    defines.push_back("OCTAHEDRAL_NORMALS");
+  }
+  return defines;
+}
+
+void kdr::Vertex::encode(const kdr::Vertex::Format& format, const GLfloat* vertices, const size_t vertexCount, const kdr::Bounds::AABB& bounds, std::vector<GLubyte>& oData)
+{
+  const GLuint stride = kdr::Vertex::getStride(format);
+  oData.resize(vertexCount * stride);
+
+  const kdr::Space::Vec3 size = bounds.max - bounds.min;
+  const float scale[3] {
+    size.x > 0.f ? 1.f / size.x : 0.f,
+    size.y > 0.f ? 1.f / size.y : 0.f,
+    size.z > 0.f ? 1.f / size.z : 0.f
+  };
+
+  GLubyte* cursor = oData.data();
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    const GLfloat* vertex = vertices + i * SOURCE_STRIDE;
+    if (format.quantizedPositions)
+    {
+      const float minimum[3] {bounds.min.x, bounds.min.y, bounds.min.z};
+      for (int axis = 0; axis < 3; axis++)
+      {
+        const float fraction = (vertex[axis] - minimum[axis]) * scale[axis];
+        write<uint16_t>((uint16_t)roundf(std::max(0.f, std::min(1.f, fraction)) * 65535.f), cursor);
+      }
+      write<uint16_t>(0, cursor);
+    }
+    else
+    {
+      write(vertex[0], cursor);
+      write(vertex[1], cursor);
+      write(vertex[2], cursor);
+    }
+
+    if (format.color)
+    {
+      write(vertex[3], cursor);
+      write(vertex[4], cursor);
+      write(vertex[5], cursor);
+    }
+
+    if (format.halfTexCoords)
+    {
+      write(kdr::Vertex::toHalf(vertex[6]), cursor);
+      write(kdr::Vertex::toHalf(vertex[7]), cursor);
+    }
+    else
+    {
+      write(vertex[6], cursor);
+      write(vertex[7], cursor);
+    }
+
+    const kdr::Space::Vec3 normal {vertex[8], vertex[9], vertex[10]};
+    switch (format.normals)
+    {
+      case kdr::Vertex::NormalEncoding::Float:
+        write(normal.x, cursor);
+        write(normal.y, cursor);
+        write(normal.z, cursor);
+        break;
+      case kdr::Vertex::NormalEncoding::Octahedral:
+      {
+        int16_t encoded[2];
+        kdr::Vertex::encodeOctahedral(normal, encoded);
+        write(encoded[0], cursor);
+        write(encoded[1], cursor);
+        break;
+      }
+      case kdr::Vertex::NormalEncoding::Packed:
+        write(kdr::Vertex::packNormal(normal), cursor);
+        break;
+    }
+  }
+}
+
+uint16_t kdr::Vertex::toHalf(const float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+  uint32_t mantissa = bits & 0x7FFFFF;
+
+  if (((bits >> 23) & 0xFF) == 0xFF)
+  {
+    return sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0);
+  }
+  if (exponent >= 31)
+  {
+    return sign | 0x7C00;
+  }
+  if (exponent <= 0)
+  {
+    if (exponent < -10)
+    {
+      return sign;
+    }
+    // Subnormal half: shift the mantissa with its implicit leading one into place.
+    mantissa |= 0x800000;
+    const int shift = 14 - exponent;
+    uint32_t half = mantissa >> shift;
+    if ((mantissa >> (shift - 1)) & 1)
+    {
+      half++;
+    }
+    return sign | half;
+  }
+
+  uint16_t half = sign | (exponent << 10) | (mantissa >> 13);
+  // Rounding may carry into the exponent, which correctly yields the next power of two.
+  if (mantissa & 0x1000)
+  {
+    half++;
+  }
+  return half;
+}
+
+uint32_t kdr::Vertex::packNormal(const kdr::Space::Vec3& normal)
+{
+  const uint32_t x = toSnorm(normal.x, 511) & 0x3FF;
+  const uint32_t y = toSnorm(normal.y, 511) & 0x3FF;
+  const uint32_t z = toSnorm(normal.z, 511) & 0x3FF;
+  return x | (y << 10) | (z << 20);
+}
+
+void kdr::Vertex::encodeOctahedral(const kdr::Space::Vec3& normal, int16_t oEncoded[2])
+{
+  const float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+  float x = length > 0.f ? normal.x / length : 0.f;
+  float y = length > 0.f ? normal.y / length : 0.f;
+
+  // The lower hemisphere is folded over the diagonals onto the outer triangles of the square.
+  if (normal.z < 0.f)
+  {
+    const float foldedX = (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+    const float foldedY = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+    x = foldedX;
+    y = foldedY;
+  }
+  oEncoded[0] = (int16_t)toSnorm(x, 32767);
+  oEncoded[1] = (int16_t)toSnorm(y, 32767);
+}
+
+bool kdr::Vertex::setSolidFormat(const kdr::Vertex::Format& format)
+{
+  if (!kdr::MeshArena::getSolidArena().setLayout(kdr::Vertex::getStride(format), kdr::Vertex::getAttributes(format)))
+  {
+    return false;
+  }
+  solidFormat = format;
+  return true;
+}
+
+const kdr::Vertex::Format& kdr::Vertex::getSolidFormat()
+{
+  return solidFormat;
+}
@@ -1,5 +1,10 @@
 #include "Kedarium/Window.hpp"
 
+#include <algorithm>
+#include <cmath>
+
+#include "Kedarium/Jobs.hpp"
+
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
   kdr::Window* windowInstance = (kdr::Window*)glfwGetWindowUserPointer(window);
@@ -23,11 +28,221 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 
 void kdr::Window::loop()
 {
+  this->finishShaders();
+  if (this->pipelined)
+  {
+    this->_loopPipelined();
+    return;
+  }
   while (!glfwWindowShouldClose(this->glfwWindow))
   {
+    this->profiler.beginFrame();
     this->_update();
     this->_render();
+    this->profiler.endFrame();
+  }
+}
+
+kdr::FrameStats kdr::Window::benchmark(const unsigned int frameCount, const kdr::CameraPath* cameraPath, const std::string& screenshotPath)
+{
+  this->finishShaders();
+  this->profiler.reset();
+  for (unsigned int frame = 0; frame < frameCount; frame++)
+  {
+    this->profiler.beginFrame();
+    {
+      kdr::Profiler::Scope scope {this->profiler, "Update"};
+      glfwPollEvents();
+      this->_advanceClock(BENCHMARK_TIMESTEP);
+      if (cameraPath != NULL && this->boundCamera != NULL)
+      {
+        cameraPath->apply(*this->boundCamera, frame * BENCHMARK_TIMESTEP);
+      }
+      this->_updateState();
+      this->_captureFrame(this->renderedScene);
+    }
+    this->_renderFrame();
+    if (frame + 1 == frameCount && !screenshotPath.empty())
+    {
+      this->saveScreenshot(screenshotPath);
+    }
+    this->_present();
+    this->profiler.endFrame();
   }
+  this->lastTime = glfwGetTime();
+  return this->profiler.getFrameStats();
+}
+
+bool kdr::Window::saveScreenshot(const std::string& path)
+{
+  int bufferWidth = this->width;
+  int bufferHeight = this->height;
+  if (!this->headless)
+  {
+    glfwGetFramebufferSize(this->glfwWindow, &bufferWidth, &bufferHeight);
+  }
+
+  std::vector<GLubyte> pixels((size_t)bufferWidth * bufferHeight * 4);
+  glReadBuffer(this->headless ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, bufferWidth, bufferHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+  return kdr::Image::saveToPNG(path, pixels.data(), bufferWidth, bufferHeight, true);
+}
+
+bool kdr::Window::startCapture(const std::string& pathPrefix)
+{
+  int bufferWidth = this->width;
+  int bufferHeight = this->height;
+  if (!this->headless)
+  {
+    glfwGetFramebufferSize(this->glfwWindow, &bufferWidth, &bufferHeight);
+  }
+  return this->frameCapture.start(pathPrefix, bufferWidth, bufferHeight);
+}
+
+void kdr::Window::renderSolids(const std::vector<const kdr::Solids::Solid*>& solids)
+{
+  if (this->boundShader == NULL)
+  {
+    return;
+  }
+
+  const bool cull = this->frustumCulling && this->boundCamera != NULL;
+  if (cull)
+  {
+    this->cullBounds.resize(solids.size());
+    this->cullVisibility.resize(solids.size());
+    for (size_t i = 0; i < solids.size(); i++)
+    {
+      this->cullBounds[i] = solids[i]->getWorldBounds();
+    }
+    kdr::Bounds::cullAABBs(
+      this->boundCamera->getFrustum(),
+      this->cullBounds.data(),
+      solids.size(),
+      this->cullVisibility.data()
+    );
+  }
+
+  for (size_t i = 0; i < solids.size(); i++)
+  {
+    if (cull && !this->cullVisibility[i])
+    {
+      this->frameStats.culled++;
+      continue;
+    }
+    if (this->_isOccluded(*solids[i]))
+    {
+      this->frameStats.occluded++;
+      continue;
+    }
+    this->_selectLod(*solids[i]);
+    if (this->multiDrawEnabled)
+    {
+      this->multiDraw.add(*solids[i]);
+    }
+    else
+    {
+      this->_drawSolid(*solids[i]);
+    }
+    this->frameStats.drawn++;
+  }
+  this->multiDraw.submit(this->streamBuffer);
+}
+
+void kdr::Window::renderSolids(const kdr::BVH& bvh)
+{
+  if (this->boundShader == NULL)
+  {
+    return;
+  }
+  this->cullResults.clear();
+  if (!this->frustumCulling || this->boundCamera == NULL)
+  {
+    bvh.queryOverlap({kdr::Space::Vec3 {-FLT_MAX}, kdr::Space::Vec3 {FLT_MAX}}, this->cullResults);
+  }
+  else
+  {
+    bvh.queryFrustum(this->boundCamera->getFrustum(), this->cullResults);
+  }
+
+  for (void* userData : this->cullResults)
+  {
+    const kdr::Solids::Solid* solid = (const kdr::Solids::Solid*)userData;
+    if (this->_isOccluded(*solid))
+    {
+      this->frameStats.occluded++;
+      continue;
+    }
+    this->_selectLod(*solid);
+    this->frameStats.drawn++;
+    if (this->multiDrawEnabled)
+    {
+      this->multiDraw.add(*solid);
+      continue;
+    }
+    this->_drawSolid(*solid);
+  }
+  this->multiDraw.submit(this->streamBuffer);
+  this->frameStats.culled += bvh.getProxyCount() - this->cullResults.size();
+}
+
+void kdr::Window::renderScene(const kdr::Scene& scene)
+{
+  if (this->boundShader == NULL)
+  {
+    return;
+  }
+
+  const bool cull = this->frustumCulling && this->boundCamera != NULL;
+  scene.cull(cull ? &this->boundCamera->getFrustum() : NULL, this->sceneDraws);
+  this->frameStats.culled += scene.getMeshes().getCount() - this->sceneDraws.size();
+  this->_drawScene(scene, scene.getWorldBounds(), NULL);
+}
+
+void kdr::Window::renderScene(const kdr::SceneSnapshot& snapshot)
+{
+  if (this->boundShader == NULL || snapshot.getScene() == NULL)
+  {
+    return;
+  }
+
+  const bool cull = this->frustumCulling && this->boundCamera != NULL;
+  snapshot.cull(cull ? &this->boundCamera->getFrustum() : NULL, this->sceneDraws);
+  this->frameStats.culled += snapshot.getScene()->getMeshes().getCount() - this->sceneDraws.size();
+  this->_drawScene(*snapshot.getScene(), snapshot.getWorldBounds(), &snapshot.getWorlds());
+}
+
+void kdr::Window::renderBoundScene()
+{
+  if (this->pipelined)
+  {
+    this->renderScene(this->frameScenes[this->renderedScene]);
+  }
+  else if (this->boundScene != NULL)
+  {
+    this->renderScene(*this->boundScene);
+  }
+}
+
+bool kdr::Window::addOccluder(const kdr::Solids::Solid& solid)
+{
+  if (solid.getOccluderIndices().empty())
+  {
+    std::cerr << "Solid is too dense to be an occluder.\n";
+    return false;
+  }
+  if (std::find(this->occluders.begin(), this->occluders.end(), &solid) == this->occluders.end())
+  {
+    this->occluders.push_back(&solid);
+  }
+  return true;
+}
+
+void kdr::Window::removeOccluder(const kdr::Solids::Solid& solid)
+{
+  this->occluders.erase(std::remove(this->occluders.begin(), this->occluders.end(), &solid), this->occluders.end());
 }
 
 void kdr::Window::maximize()
@@ -104,22 +319,80 @@ bool kdr::Window::_initializeOpenGLSettings()
   return true;
 }
 
+bool kdr::Window::_initializeFramebuffer()
+{
+  glGenFramebuffers(1, &this->framebuffer);
+  glGenRenderbuffers(1, &this->colorRenderbuffer);
+  glGenRenderbuffers(1, &this->depthRenderbuffer);
+
+  glBindRenderbuffer(GL_RENDERBUFFER, this->colorRenderbuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, this->width, this->height);
+  glBindRenderbuffer(GL_RENDERBUFFER, this->depthRenderbuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, this->width, this->height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorRenderbuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depthRenderbuffer);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cerr << "Failed to create the offscreen framebuffer!\n";
+    return false;
+  }
+  glViewport(
+    0,
+    0,
+    this->width,
+    this->height
+  );
+  return true;
+}
+
 bool kdr::Window::_initialize()
 {
   if (!this->_initializeWindow()) return false;
   if (!kdr::Core::initializeGlew()) return false;
   if (!this->_initializeOpenGLSettings()) return false;
+  if (this->headless && !this->_initializeFramebuffer()) return false;
 
+  // The job system is owned by the thread creating it, which has to be the main thread.
+  kdr::Core::getJobSystem();
   return true;
 }
 
 void kdr::Window::_updateDeltaTime()
 {
-  float currentTime = (float)glfwGetTime();
-  this->deltaTime = currentTime - lastTime;
+  const double currentTime = glfwGetTime();
+  this->_advanceClock(currentTime - this->lastTime);
   this->lastTime = currentTime;
 }
 
+void kdr::Window::_advanceClock(const double elapsed)
+{
+  this->frameTime = (float)elapsed;
+  if (this->tickRate <= 0.0)
+  {
+    this->deltaTime = this->frameTime;
+    this->pendingTicks = 1;
+    this->interpolationAlpha = 1.f;
+    return;
+  }
+
+  const double tick = 1.0 / this->tickRate;
+  this->tickAccumulator += elapsed;
+  double ticks = std::floor(this->tickAccumulator / tick);
+  if (ticks > this->maxTicksPerFrame)
+  {
+    // Time beyond the tick limit is dropped, so a slow frame does not make the next one slower.
+    this->tickAccumulator -= (ticks - this->maxTicksPerFrame) * tick;
+    ticks = this->maxTicksPerFrame;
+  }
+  this->tickAccumulator = std::max(0.0, this->tickAccumulator - ticks * tick);
+  this->deltaTime = (float)tick;
+  this->pendingTicks = (unsigned int)ticks;
+  this->interpolationAlpha = (float)std::min(1.0, this->tickAccumulator / tick);
+}
+
 void kdr::Window::_updateCamera()
 {
   if (this->boundShader == NULL || this->boundCamera == NULL) {
@@ -152,21 +425,313 @@ void kdr::Window::_updateCamera()
   }
 
   this->boundCamera->handleMouse(this->glfwWindow);
-  this->boundCamera->handleKeyboard(this->glfwWindow, this->deltaTime);
+  this->boundCamera->handleKeyboard(this->glfwWindow, this->frameTime);
 }
 
 void kdr::Window::_update()
+{
+  kdr::Profiler::Scope scope {this->profiler, "Update"};
+  this->_updateInput();
+  this->_updateState();
+  this->_captureFrame(this->renderedScene);
+}
+
+void kdr::Window::_updateInput()
 {
   glfwPollEvents();
+  if (this->hotReloader.getActive() && this->hotReloader.apply(this->shaders, this->textures) > 0 && this->boundShader != NULL)
+  {
+    this->boundShader->Use();
+  }
   this->_updateDeltaTime();
   this->_updateCamera();
-  this->update();
+}
+
+void kdr::Window::_updateState()
+{
+  for (unsigned int tick = 0; tick < this->pendingTicks; tick++)
+  {
+    this->update();
+  }
+  if (this->boundScene != NULL)
+  {
+    this->boundScene->updateTransforms();
+  }
+}
+
+void kdr::Window::_captureFrame(const unsigned int index)
+{
+  if (this->pipelined && this->boundScene != NULL)
+  {
+    this->frameScenes[index].capture(*this->boundScene);
+  }
+  else if (this->pipelined)
+  {
+    this->frameScenes[index].clear();
+  }
+  std::vector<OccluderState>& states = this->occluderStates[index];
+  states.clear();
+  for (const kdr::Solids::Solid* occluder : this->occluders)
+  {
+    states.push_back({occluder, occluder->getModelMatrix(), occluder->getWorldBounds()});
+  }
+}
+
+void kdr::Window::_loopPipelined()
+{
+  kdr::Core::JobSystem& jobSystem = kdr::Core::getJobSystem();
+
+  // The first update has no frame to overlap with.
+  this->_update();
+
+  while (!glfwWindowShouldClose(this->glfwWindow))
+  {
+    this->profiler.beginFrame();
+    {
+      kdr::Profiler::Scope scope {this->profiler, "Update"};
+      this->_updateInput();
+    }
+
+    kdr::Core::JobCounter updated;
+    jobSystem.runOnWorker([this]()
+    {
+      this->_updateState();
+      this->_captureFrame(this->renderedScene ^ 1);
+    }, &updated);
+    this->_render();
+    {
+      kdr::Profiler::Scope scope {this->profiler, "Wait"};
+      jobSystem.wait(updated);
+    }
+    this->renderedScene ^= 1;
+    this->profiler.endFrame();
+  }
 }
 
 void kdr::Window::_render()
 {
+  this->_renderFrame();
+  this->_present();
+}
+
+void kdr::Window::_renderFrame()
+{
+  kdr::Profiler::Scope scope {this->profiler, "Render", true};
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  this->frameStats = {};
+  this->streamBuffer.beginFrame();
+  this->occlusionQueries.beginFrame();
   this->use3D();
+  this->_renderOccluders();
   this->render();
+  this->streamBuffer.endFrame();
+  this->frameStats.queried = this->occlusionQueries.getQueryCount();
+  this->frameStats.queryOccluded = this->occlusionQueries.getOccludedCount();
+  this->renderStats = this->frameStats;
+  this->frameCapture.capture(this->headless ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+}
+
+void kdr::Window::_present()
+{
+  kdr::Profiler::Scope scope {this->profiler, "Swap"};
+  if (this->headless)
+  {
+    glFinish();
+    return;
+  }
   glfwSwapBuffers(this->glfwWindow);
 }
+
+void kdr::Window::_applySolid(const kdr::Solids::Solid& solid)
+{
+  solid.applyModelMatrix(this->boundShader->getID(), "model");
+  if (kdr::Vertex::getSolidFormat().quantizedPositions)
+  {
+    solid.applyPositionDecoding(this->boundShader->getID(), "positionOffset", "positionScale");
+  }
+}
+
+void kdr::Window::_drawSolid(const kdr::Solids::Solid& solid)
+{
+  this->_applySolid(solid);
+
+  // Queries bind their own program, whose uniforms do not disturb those just applied.
+  bool queried {false};
+  const GLuint lod = solid.getSelectedLod();
+  if (
+    this->occlusionQueriesEnabled &&
+    this->boundCamera != NULL &&
+    lod < solid.getLods().size() &&
+    solid.getLods()[lod].indexCount >= kdr::OcclusionQueries::MIN_TRIANGLES * 3
+  )
+  {
+    queried = this->occlusionQueries.begin(solid.getSerial(), solid.getWorldBounds(), *this->boundCamera);
+    if (queried)
+    {
+      glUseProgram(this->boundShader->getID());
+    }
+  }
+
+  if (!this->_renderClusters(solid))
+  {
+    solid.render();
+  }
+  if (queried)
+  {
+    this->occlusionQueries.end();
+  }
+}
+
+void kdr::Window::_selectLod(const kdr::Solids::Solid& solid)
+{
+  float pixelsPerUnit {0.f};
+  kdr::Space::Vec3 viewPosition {0.f};
+  if (this->boundCamera != NULL)
+  {
+    pixelsPerUnit = this->boundCamera->getBufferHeight() / (2.f * tanf(kdr::Space::radians(this->boundCamera->getFov()) * 0.5f));
+    viewPosition = this->boundCamera->getPosition();
+  }
+  const GLuint lod = solid.selectLod(viewPosition, pixelsPerUnit, this->lodThreshold);
+  if (lod < solid.getLods().size())
+  {
+    this->frameStats.triangles += solid.getLods()[lod].indexCount / 3;
+  }
+}
+
+void kdr::Window::_renderOccluders()
+{
+  this->occlusionReady = false;
+  const std::vector<OccluderState>& states = this->occluderStates[this->renderedScene];
+  if (!this->occlusionCulling || this->boundCamera == NULL || states.empty())
+  {
+    return;
+  }
+
+  // Occluders are drawn as placed by the last update(), which may be moving them in pipelined mode.
+  kdr::Profiler::Scope scope {this->profiler, "Occlusion"};
+  this->occlusionBuffer.clear(this->boundCamera->getMatrix());
+  for (const OccluderState& state : states)
+  {
+    if (!kdr::Bounds::testAABB(this->boundCamera->getFrustum(), state.bounds))
+    {
+      continue;
+    }
+    const std::vector<GLfloat>& positions = state.solid->getOccluderPositions();
+    const std::vector<GLuint>& indices = state.solid->getOccluderIndices();
+    this->occlusionBuffer.addOccluder(positions.data(), positions.size() / 3, indices.data(), indices.size(), state.model);
+  }
+  this->occlusionBuffer.render();
+  this->occlusionReady = this->occlusionBuffer.getTriangleCount() > 0;
+}
+
+void kdr::Window::_drawScene(const kdr::Scene& scene, const kdr::ComponentPool<kdr::Components::WorldBounds>& worldBounds, const kdr::ComponentPool<kdr::Space::Mat4>* worlds)
+{
+  if (this->occlusionReady)
+  {
+    size_t keptCount {0};
+    for (const kdr::Entity entity : this->sceneDraws)
+    {
+      const kdr::Components::WorldBounds* bounds = worldBounds.get(entity);
+      if (bounds != NULL && !this->occlusionBuffer.testAABB(*bounds))
+      {
+        this->frameStats.occluded++;
+        continue;
+      }
+      this->sceneDraws[keptCount++] = entity;
+    }
+    this->sceneDraws.resize(keptCount);
+  }
+  scene.sortDraws(this->sceneDraws);
+
+  const GLuint program = this->boundShader->getID();
+  const GLint modelLocation = glGetUniformLocation(program, "model");
+  const GLint offsetLocation = glGetUniformLocation(program, "positionOffset");
+  const GLint scaleLocation = glGetUniformLocation(program, "positionScale");
+  const bool quantized = kdr::Vertex::getSolidFormat().quantizedPositions;
+  const kdr::MeshArena& arena = kdr::MeshArena::getSolidArena();
+  const kdr::Graphics::Texture* boundTexture {NULL};
+
+  for (const kdr::Entity entity : this->sceneDraws)
+  {
+    const kdr::Components::Mesh& mesh = *scene.getMeshes().get(entity);
+    const kdr::Components::Material* material = scene.getMaterials().get(entity);
+    // Snapshots are drawn without touching the transforms, which update() may be changing.
+    const kdr::Space::Mat4* world = worlds != NULL ? worlds->get(entity) : NULL;
+    const kdr::Components::Transform* transform = worlds == NULL ? scene.getTransforms().get(entity) : NULL;
+    const kdr::Space::Mat4 model = world != NULL ? *world : (transform != NULL ? transform->world : kdr::Space::Mat4 {1.f});
+
+    if (material != NULL && material->texture != NULL && material->texture != boundTexture)
+    {
+      // Queued multi-draws use the texture bound when they are submitted.
+      this->multiDraw.submit(this->streamBuffer);
+      material->texture->TextureUnit(program, "tex0", 0);
+      material->texture->Bind();
+      boundTexture = material->texture;
+    }
+    this->frameStats.drawn++;
+    this->frameStats.triangles += mesh.indexCount / 3;
+
+    if (this->multiDrawEnabled)
+    {
+      this->multiDraw.add(mesh.mesh, mesh.firstIndex, mesh.indexCount, model, mesh.positionOffset, mesh.positionScale);
+      continue;
+    }
+    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, kdr::Space::valuePointer(model));
+    if (quantized)
+    {
+      glUniform3f(offsetLocation, mesh.positionOffset.x, mesh.positionOffset.y, mesh.positionOffset.z);
+      glUniform3f(scaleLocation, mesh.positionScale.x, mesh.positionScale.y, mesh.positionScale.z);
+    }
+    arena.draw(mesh.mesh, mesh.firstIndex, mesh.indexCount);
+  }
+  this->multiDraw.submit(this->streamBuffer);
+}
+
+bool kdr::Window::_renderClusters(const kdr::Solids::Solid& solid)
+{
+  const kdr::Meshlet::ClusterSet& clusters = solid.getClusters();
+  if (!this->clusterCulling || this->boundCamera == NULL || solid.getSelectedLod() != 0 || clusters.getCount() == 0)
+  {
+    return false;
+  }
+
+  const kdr::Space::Mat4 model = solid.getModelMatrix();
+  const kdr::Space::Mat4 inverseModel = kdr::Space::inverse(model);
+  const kdr::Space::Vec3 camera = this->boundCamera->getPosition();
+  const kdr::Space::Vec3 localCamera {
+    inverseModel[0][0] * camera.x + inverseModel[1][0] * camera.y + inverseModel[2][0] * camera.z + inverseModel[3][0],
+    inverseModel[0][1] * camera.x + inverseModel[1][1] * camera.y + inverseModel[2][1] * camera.z + inverseModel[3][1],
+    inverseModel[0][2] * camera.x + inverseModel[1][2] * camera.y + inverseModel[2][2] * camera.z + inverseModel[3][2]
+  };
+
+  this->clusterVisibility.resize(clusters.getCount());
+  const size_t visibleCount = clusters.cull(kdr::Bounds::toModelSpace(this->boundCamera->getFrustum(), model), localCamera, this->clusterVisibility.data());
+  if (visibleCount == clusters.getCount())
+  {
+    return false;
+  }
+
+  const size_t indexCount = clusters.countIndices(this->clusterVisibility.data());
+  this->frameStats.triangles -= (solid.getLods()[0].indexCount - indexCount) / 3;
+  if (indexCount == 0)
+  {
+    return true;
+  }
+
+  kdr::StreamBuffer::Allocation allocation;
+  if (!this->streamBuffer.allocate(indexCount * sizeof(GLuint), sizeof(GLuint), allocation))
+  {
+    this->frameStats.triangles += (solid.getLods()[0].indexCount - indexCount) / 3;
+    return false;
+  }
+  clusters.compact(this->clusterVisibility.data(), (GLuint*)allocation.data);
+  this->streamBuffer.flush();
+
+  // The compacted indices replace the arena's index buffer on the shared VAO for this draw.
+  const kdr::MeshArena& arena = kdr::MeshArena::getSolidArena();
+  arena.Bind();
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->streamBuffer.getID());
+  glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (const void*)allocation.offset, (GLint)arena.getRange(solid.getMesh()).firstVertex);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.getIndexBufferID());
+  return true;
+}
@@ -0,0 +1,228 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Kedarium/BVH.hpp"
+
+/**
+ * @brief Struct holding the timings of one query kind.
+ */
+struct QueryTimes
+{
+  double linear  {0.0};
+  double bvh     {0.0};
+  size_t matches {0};
+};
+
+/**
+ * @brief Gets the time since a point in microseconds.
+ *
+ * @param start The time the measurement started.
+ * @return The elapsed time in microseconds.
+ */
+double elapsedMicroseconds(const std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Prints the time per query of both methods and the speedup of the hierarchy.
+ *
+ * @param name The name of the query.
+ * @param queryCount The number of queries run.
+ * @param times The total times of the queries.
+ */
+void printTimes(const char* name, const size_t queryCount, const QueryTimes& times)
+{
+  printf(
+    "  %-8s linear %10.2f us  BVH %8.2f us  %7.1fx  (%zu matches)\n",
+    name,
+    times.linear / queryCount,
+    times.bvh / queryCount,
+    times.linear / times.bvh,
+    times.matches
+  );
+}
+
+/**
+ * @brief Runs the queries against a linear loop and the hierarchy for a scene of random boxes.
+ *
+ * The boxes are spread through a cube growing with their count, so the density, and the
+ * number of objects a query touches, stays the same at every size.
+ *
+ * @param objectCount The number of boxes.
+ * @return True if both methods found the same objects, false otherwise.
+ */
+bool runBenchmark(const size_t objectCount)
+{
+  constexpr size_t frustumCount {100};
+  constexpr size_t overlapCount {1000};
+  constexpr size_t rayCount     {1000};
+
+  std::mt19937 random {1234};
+  const float worldSize = 4.f * std::cbrt((float)objectCount);
+  std::uniform_real_distribution<float> position {-worldSize * 0.5f, worldSize * 0.5f};
+  std::uniform_real_distribution<float> size {0.25f, 1.f};
+  std::uniform_real_distribution<float> unit {-1.f, 1.f};
+
+  std::vector<kdr::Bounds::AABB> boxes(objectCount);
+  for (kdr::Bounds::AABB& box : boxes)
+  {
+    const kdr::Space::Vec3 center {position(random), position(random), position(random)};
+    const kdr::Space::Vec3 extents {size(random), size(random), size(random)};
+    box = kdr::Bounds::AABB {center - extents, center + extents};
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  kdr::BVH bvh;
+  for (kdr::Bounds::AABB& box : boxes)
+  {
+    bvh.insert(box, &box);
+  }
+  bvh.rebuild();
+  printf("%zu objects, built in %.2f ms, height %d\n", objectCount, elapsedMicroseconds(start) / 1000.0, bvh.getHeight());
+
+  bool matching {true};
+  std::vector<void*> results;
+
+  // Frusta look from random points in random directions, reaching a tenth of the world.
+  std::vector<kdr::Bounds::Frustum> frusta;
+  for (size_t i = 0; i < frustumCount; i++)
+  {
+    const kdr::Space::Vec3 eye {position(random), position(random), position(random)};
+    const kdr::Space::Vec3 direction {unit(random), unit(random), unit(random)};
+    const kdr::Space::Mat4 view = kdr::Space::lookAt(eye, eye + direction, {0.f, 1.f, 0.f});
+    const kdr::Space::Mat4 projection = kdr::Space::perspective(60.f, 16.f / 9.f, 0.1f, worldSize * 0.1f + 10.f);
+    frusta.push_back(kdr::Bounds::extractFrustum(projection * view));
+  }
+  QueryTimes frustumTimes;
+  size_t linearMatches {0};
+  start = std::chrono::steady_clock::now();
+  for (const kdr::Bounds::Frustum& frustum : frusta)
+  {
+    for (const kdr::Bounds::AABB& box : boxes)
+    {
+      linearMatches += kdr::Bounds::testAABB(frustum, box);
+    }
+  }
+  frustumTimes.linear = elapsedMicroseconds(start);
+  start = std::chrono::steady_clock::now();
+  for (const kdr::Bounds::Frustum& frustum : frusta)
+  {
+    results.clear();
+    bvh.queryFrustum(frustum, results);
+    frustumTimes.matches += results.size();
+  }
+  frustumTimes.bvh = elapsedMicroseconds(start);
+  // The hierarchy tests enlarged boxes, so it may report a few more objects than the exact loop.
+  matching = matching && frustumTimes.matches >= linearMatches;
+  printTimes("frustum", frustumCount, frustumTimes);
+
+  std::vector<kdr::Bounds::AABB> regions(overlapCount);
+  for (kdr::Bounds::AABB& region : regions)
+  {
+    const kdr::Space::Vec3 center {position(random), position(random), position(random)};
+    const kdr::Space::Vec3 extents {2.f, 2.f, 2.f};
+    region = kdr::Bounds::AABB {center - extents, center + extents};
+  }
+  QueryTimes overlapTimes;
+  linearMatches = 0;
+  start = std::chrono::steady_clock::now();
+  for (const kdr::Bounds::AABB& region : regions)
+  {
+    for (const kdr::Bounds::AABB& box : boxes)
+    {
+      linearMatches += region.overlaps(box);
+    }
+  }
+  overlapTimes.linear = elapsedMicroseconds(start);
+  start = std::chrono::steady_clock::now();
+  for (const kdr::Bounds::AABB& region : regions)
+  {
+    results.clear();
+    bvh.queryOverlap(region, results);
+    overlapTimes.matches += results.size();
+  }
+  overlapTimes.bvh = elapsedMicroseconds(start);
+  matching = matching && overlapTimes.matches >= linearMatches;
+  printTimes("overlap", overlapCount, overlapTimes);
+
+  // Rays find the nearest box, the exact test of the callback being the box itself.
+  std::vector<kdr::Bounds::Ray> rays;
+  for (size_t i = 0; i < rayCount; i++)
+  {
+    rays.emplace_back(kdr::Space::Vec3 {position(random), position(random), position(random)}, kdr::Space::Vec3 {unit(random), unit(random), unit(random)});
+  }
+  const float maxDistance = worldSize;
+  const auto hitBox = [](void* userData, const kdr::Bounds::Ray& ray, float distance)
+  {
+    float hit {0.f};
+    if (kdr::Bounds::intersectRay(ray, *(const kdr::Bounds::AABB*)userData, distance, hit))
+    {
+      return hit;
+    }
+    return distance;
+  };
+  QueryTimes rayTimes;
+  std::vector<float> linearHits(rayCount);
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rayCount; i++)
+  {
+    float nearest = maxDistance;
+    for (const kdr::Bounds::AABB& box : boxes)
+    {
+      float hit {0.f};
+      if (kdr::Bounds::intersectRay(rays[i], box, nearest, hit))
+      {
+        nearest = hit;
+      }
+    }
+    linearHits[i] = nearest;
+  }
+  rayTimes.linear = elapsedMicroseconds(start);
+  std::vector<float> bvhHits(rayCount);
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rayCount; i++)
+  {
+    bvhHits[i] = bvh.queryRay(rays[i], maxDistance, hitBox);
+  }
+  rayTimes.bvh = elapsedMicroseconds(start);
+  for (size_t i = 0; i < rayCount; i++)
+  {
+    rayTimes.matches += bvhHits[i] < maxDistance;
+    matching = matching && std::abs(bvhHits[i] - linearHits[i]) < 1e-4f;
+  }
+  printTimes("ray", rayCount, rayTimes);
+
+  if (!matching)
+  {
+    printf("  Results of the hierarchy differ from the linear loop!\n");
+  }
+  return matching;
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<size_t> objectCounts;
+  for (int i = 1; i < argc; i++)
+  {
+    objectCounts.push_back(std::strtoul(argv[i], NULL, 10));
+  }
+  if (objectCounts.empty())
+  {
+    objectCounts = {1000, 10000, 100000};
+  }
+
+  int result {0};
+  for (const size_t objectCount : objectCounts)
+  {
+    if (!runBenchmark(objectCount))
+    {
+      result = 1;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Kedarium/Jobs.hpp"
+
+/**
+ * @brief Prints the time per job of a benchmark run.
+ *
+ * @param name The name of the benchmark.
+ * @param jobCount The number of jobs run.
+ * @param start The time the run started.
+ */
+void printTime(const char* name, const size_t jobCount, const std::chrono::steady_clock::time_point start)
+{
+  const double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  printf("  %-20s %9.1f ns/job\n", name, nanoseconds / jobCount);
+}
+
+int main(int argc, char* argv[])
+{
+  const unsigned int workerCount = argc > 1 ? std::atoi(argv[1]) : kdr::Core::JobSystem::getDefaultWorkerCount();
+  constexpr size_t jobCount {1 << 20};
+  constexpr size_t batchSize {1024};
+
+  kdr::Core::JobSystem jobSystem {workerCount};
+  printf("%u workers, %zu empty jobs\n", jobSystem.getWorkerCount(), jobCount);
+
+  // Jobs are started in batches, so the storage ring of the main thread never runs out.
+  auto start = std::chrono::steady_clock::now();
+  for (size_t batch = 0; batch < jobCount / batchSize; batch++)
+  {
+    kdr::Core::JobCounter counter;
+    for (size_t i = 0; i < batchSize; i++)
+    {
+      jobSystem.run([]() {}, &counter);
+    }
+    jobSystem.wait(counter);
+  }
+  printTime("run and wait", jobCount, start);
+
+  start = std::chrono::steady_clock::now();
+  for (size_t batch = 0; batch < jobCount / batchSize; batch++)
+  {
+    jobSystem.parallelFor(batchSize, 1, [](const size_t, const size_t) {});
+  }
+  printTime("parallel for", jobCount, start);
+
+  // Every job depends on the one before, so each is released by the worker finishing it.
+  start = std::chrono::steady_clock::now();
+  std::vector<kdr::Core::JobCounter> counters(batchSize);
+  for (size_t batch = 0; batch < jobCount / batchSize / 16; batch++)
+  {
+    for (size_t i = 0; i < batchSize; i++)
+    {
+      jobSystem.run([]() {}, &counters[i], i > 0 ? &counters[i - 1] : NULL);
+    }
+    jobSystem.wait(counters.back());
+  }
+  printTime("dependency chain", jobCount / 16, start);
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Kedarium/Object.hpp"
+#include "Kedarium/Optimize.hpp"
+
+// The default meshes are read from the source tree, wherever the tool is run from.
+#ifndef KDR_ASSETS_DIR
+  #define KDR_ASSETS_DIR "assets"
+#endif
+
+/**
+ * @brief Prints the vertex cache efficiency of an index buffer.
+ *
+ * @param stage The name of the optimization stage.
+ * @param indices The triangle list.
+ * @param vertexCount The number of vertices.
+ */
+void printStats(const char* stage, const std::vector<GLuint>& indices, const size_t vertexCount)
+{
+  const kdr::Optimize::CacheStats stats = kdr::Optimize::analyzeVertexCache(indices, vertexCount);
+  printf("  %-14s ACMR %.3f  ATVR %.3f\n", stage, stats.acmr, stats.atvr);
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++)
+  {
+    paths.push_back(argv[i]);
+  }
+  if (paths.empty())
+  {
+    paths = {KDR_ASSETS_DIR "/Objects/nathan.obj", KDR_ASSETS_DIR "/Objects/sphere.obj", KDR_ASSETS_DIR "/Objects/stove.obj"};
+  }
+
+  printf("Simulated FIFO cache of %u entries\n", kdr::Optimize::SIMULATED_CACHE_SIZE);
+  int result {0};
+  for (const std::string& path : paths)
+  {
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint>  indices;
+    GLsizeiptr verticesSize {0};
+    GLsizeiptr indicesSize  {0};
+    if (!kdr::Object::loadFromObj(path, vertices, verticesSize, indices, indicesSize))
+    {
+      result = 1;
+      continue;
+    }
+
+    const size_t vertexCount = vertices.size() / 11;
+    printf("%s: %zu vertices, %zu triangles\n", path.c_str(), vertexCount, indices.size() / 3);
+    printStats("source", indices, vertexCount);
+    kdr::Optimize::optimizeVertexCache(indices, vertexCount);
+    printStats("vertex cache", indices, vertexCount);
+    kdr::Optimize::optimizeOverdraw(indices, vertices.data(), vertexCount, 11);
+    printStats("overdraw", indices, vertexCount);
+    kdr::Optimize::optimizeVertexFetch(vertices, 11, indices);
+    printStats("vertex fetch", indices, vertices.size() / 11);
+
+    std::vector<kdr::Object::Lod> lods;
+    if (kdr::Object::loadMesh(path, vertices, indices, lods))
+    {
+      for (size_t i = 1; i < lods.size(); i++)
+      {
+        printf("  LOD %zu          %u triangles, error %.4f\n", i, lods[i].indexCount / 3, lods[i].error);
+      }
+    }
+  }
+  return result;
+}
@@ -0,0 +1,171 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Kedarium/Object.hpp"
+#include "Kedarium/Raycast.hpp"
+
+// Set by CMake to the assets of the source tree, which builds do not copy.
+#ifndef KDR_ASSETS_DIR
+  #define KDR_ASSETS_DIR "assets"
+#endif
+
+/**
+ * @brief Gets the time since a point in seconds.
+ *
+ * @param start The time the measurement started.
+ * @return The elapsed time in seconds.
+ */
+double elapsedSeconds(const std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Finds the closest triangle hit by a ray by testing every triangle.
+ *
+ * @param ray The ray to cast.
+ * @param vertices The interleaved vertex data, 11 floats per vertex.
+ * @param indices The triangle indices.
+ * @param indexCount The number of indices.
+ * @param maxDistance The maximum distance along the ray.
+ * @return The distance of the closest hit, or maxDistance if nothing was hit.
+ */
+float intersectAll(const kdr::Bounds::Ray& ray, const std::vector<GLfloat>& vertices, const GLuint* indices, const size_t indexCount, const float maxDistance)
+{
+  float nearest = maxDistance;
+  for (size_t i = 0; i < indexCount; i += 3)
+  {
+    const float* a = &vertices[indices[i] * 11];
+    const float* b = &vertices[indices[i + 1] * 11];
+    const float* c = &vertices[indices[i + 2] * 11];
+    const kdr::Space::Vec3 v0 {a[0], a[1], a[2]};
+    const kdr::Space::Vec3 edge1 = kdr::Space::Vec3 {b[0], b[1], b[2]} - v0;
+    const kdr::Space::Vec3 edge2 = kdr::Space::Vec3 {c[0], c[1], c[2]} - v0;
+
+    // Moller-Trumbore, the test the hierarchy runs on each packet lane.
+    const kdr::Space::Vec3 p = kdr::Space::cross(ray.direction, edge2);
+    const float determinant = kdr::Space::dot(edge1, p);
+    if (std::abs(determinant) < 1e-8f)
+    {
+      continue;
+    }
+    const float inverse = 1.f / determinant;
+    const kdr::Space::Vec3 s = ray.origin - v0;
+    const float u = kdr::Space::dot(s, p) * inverse;
+    if (u < 0.f || u > 1.f)
+    {
+      continue;
+    }
+    const kdr::Space::Vec3 q = kdr::Space::cross(s, edge1);
+    const float v = kdr::Space::dot(ray.direction, q) * inverse;
+    if (v < 0.f || u + v > 1.f)
+    {
+      continue;
+    }
+    const float distance = kdr::Space::dot(edge2, q) * inverse;
+    if (distance > 0.f && distance < nearest)
+    {
+      nearest = distance;
+    }
+  }
+  return nearest;
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++)
+  {
+    paths.push_back(argv[i]);
+  }
+  if (paths.empty())
+  {
+    paths = {KDR_ASSETS_DIR "/Objects/nathan.obj", KDR_ASSETS_DIR "/Objects/stove.obj"};
+  }
+
+  constexpr size_t rayCount       {1 << 20};
+  constexpr size_t referenceCount {1000};
+
+  int result {0};
+  for (const std::string& path : paths)
+  {
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint>  indices;
+    std::vector<kdr::Object::Lod> lods;
+    if (!kdr::Object::loadMesh(path, vertices, indices, lods))
+    {
+      result = 1;
+      continue;
+    }
+    const GLuint* fullIndices = indices.data() + lods[0].firstIndex;
+    const size_t indexCount = lods[0].indexCount;
+
+    auto start = std::chrono::steady_clock::now();
+    kdr::Raycast::TriangleBVH bvh;
+    bvh.build(vertices.data(), 11, fullIndices, indexCount);
+    printf(
+      "%s: %zu triangles, %zu nodes, built in %.2f ms\n",
+      path.c_str(),
+      bvh.getTriangleCount(),
+      bvh.getNodeCount(),
+      elapsedSeconds(start) * 1000.0
+    );
+
+    // Rays start on a sphere around the mesh and aim at random points inside its bounds.
+    const kdr::Bounds::AABB box = kdr::Bounds::fromVertices(vertices.data(), vertices.size() / 11, 11);
+    const kdr::Space::Vec3 center = box.getCenter();
+    const kdr::Space::Vec3 extents = box.getExtents();
+    const float radius = 2.f * std::sqrt(kdr::Space::dot(extents, extents));
+    const float maxDistance = 2.f * radius;
+    std::mt19937 random {1234};
+    std::uniform_real_distribution<float> unit {-1.f, 1.f};
+    std::vector<kdr::Bounds::Ray> rays;
+    rays.reserve(rayCount);
+    for (size_t i = 0; i < rayCount; i++)
+    {
+      const kdr::Space::Vec3 origin = center + kdr::Space::normalize(kdr::Space::Vec3 {unit(random), unit(random), unit(random)}) * radius;
+      const kdr::Space::Vec3 target {
+        center.x + unit(random) * extents.x,
+        center.y + unit(random) * extents.y,
+        center.z + unit(random) * extents.z
+      };
+      rays.emplace_back(origin, target - origin);
+    }
+
+    size_t hitCount {0};
+    start = std::chrono::steady_clock::now();
+    for (const kdr::Bounds::Ray& ray : rays)
+    {
+      float distance {0.f};
+      unsigned int triangle {0};
+      hitCount += bvh.intersect(ray, maxDistance, distance, triangle);
+    }
+    const double seconds = elapsedSeconds(start);
+    printf("  BVH          %8.2f Mrays/s  (%.1f%% hit)\n", rayCount / seconds / 1e6, 100.0 * hitCount / rayCount);
+
+    size_t mismatches {0};
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < referenceCount; i++)
+    {
+      const float reference = intersectAll(rays[i], vertices, fullIndices, indexCount, maxDistance);
+      float distance {maxDistance};
+      unsigned int triangle {0};
+      if (!bvh.intersect(rays[i], maxDistance, distance, triangle))
+      {
+        distance = maxDistance;
+      }
+      mismatches += std::abs(distance - reference) > 1e-3f * maxDistance;
+    }
+    printf("  brute force  %8.4f Mrays/s\n", referenceCount / elapsedSeconds(start) / 1e6);
+    if (mismatches > 0)
+    {
+      printf("  %zu of %zu rays differ from testing every triangle!\n", mismatches, referenceCount);
+      result = 1;
+    }
+  }
+  return result;
+}